@@ -0,0 +1,229 @@
+/**
+ * @file
+ * Cache for the machine code of queries on disk that is reused across restarts.
+ * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/archives/binary.hpp>
+
+#include "flounder/flounder.h"
+#include "flounder/asm_emitter.h"
+#include "asmjit/asmjit.h"
+
+
+/* Version of the file format and of the code that the cache holds */
+const uint32_t CodeCacheVersion = 1;
+
+
+/* Flounder IR of a query with the addresses of runtime state replaced by  *
+ * their index. Queries with equal text compile to the same machine code   *
+ * apart from the addresses, which are patched into the cached code.       */
+struct CodeFingerprint {
+
+    std::string text;
+
+    /* distinct addresses in the order of their first occurrence */
+    std::vector < void* > addresses;
+    std::unordered_map < void*, uint32_t > addressIndex;
+};
+
+
+static void fingerprintNode ( ir_node* node, CodeFingerprint& fingerprint ) {
+    std::string& text = fingerprint.text;
+    text += std::to_string ( node->nodeType );
+    text += ':';
+    switch ( node->nodeType ) {
+        case CONSTANT_ADDRESS: {
+            if ( node->addressData == nullptr ) {
+                text += "null";
+                break;
+            }
+            auto it = fingerprint.addressIndex.find ( node->addressData );
+            if ( it == fingerprint.addressIndex.end() ) {
+                uint32_t index = fingerprint.addresses.size();
+                it = fingerprint.addressIndex.emplace ( node->addressData, index ).first;
+                fingerprint.addresses.push_back ( node->addressData );
+            }
+            text += '@' + std::to_string ( it->second );
+            break;
+        }
+        case CONSTANT_INT64:
+        case CONSTANT_INT32:
+        case CONSTANT_INT8:
+        case CONSTANT_DOUBLE:
+            text += std::to_string ( node->int64Data & ( ~0ULL >> ( 64 - 8 * constByteSize ( node ) ) ) );
+            break;
+        default:
+            if ( node->ident != nullptr ) text += node->ident;
+            if ( node->ident2 != nullptr ) text += node->ident2;
+            text += '#' + std::to_string ( node->id );
+    }
+    if ( node->firstChild != nullptr ) {
+        text += '(';
+        for ( ir_node* child = node->firstChild; child != nullptr; child = child->next ) {
+            fingerprintNode ( child, fingerprint );
+            text += ',';
+        }
+        text += ')';
+    }
+}
+
+
+/* Fingerprint of finished Flounder IR before its translation */
+static CodeFingerprint fingerprintFlounder ( ir_node* codeTree, bool optimizeFlounder ) {
+    CodeFingerprint fingerprint;
+    fingerprint.text = optimizeFlounder ? "optimized\n" : "unoptimized\n";
+    for ( ir_node* line = codeTree->firstChild; line != nullptr; line = line->next ) {
+        fingerprintNode ( line, fingerprint );
+        fingerprint.text += '\n';
+    }
+    return fingerprint;
+}
+
+
+/* Machine code of one function with the positions of the 64 bit *
+ * address immediates and the index of the address they hold.    */
+struct CachedFunction {
+    std::vector < uint8_t >   code;
+    std::vector < uint32_t >  relocationOffsets;
+    std::vector < uint32_t >  relocationAddresses;
+
+    template < class Archive >
+    void serialize ( Archive& ar ) {
+        ar ( code, relocationOffsets, relocationAddresses );
+    }
+};
+
+
+struct CachedQueryCode {
+    std::string                     fingerprint;
+    std::vector < CachedFunction >  functions;
+    uint64_t                        checksum = 0;
+
+    template < class Archive >
+    void serialize ( Archive& ar ) {
+        ar ( fingerprint, functions, checksum );
+    }
+};
+
+
+/* FNV-1a hash of the code and relocations that detects damaged files */
+static uint64_t codeChecksum ( const CachedQueryCode& cached ) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&] ( const void* data, size_t size ) {
+        for ( size_t i = 0; i < size; i++ ) {
+            hash = ( hash ^ ( (const uint8_t*) data ) [ i ] ) * 1099511628211ULL;
+        }
+    };
+    for ( auto& f : cached.functions ) {
+        add ( f.code.data(), f.code.size() );
+        add ( f.relocationOffsets.data(), f.relocationOffsets.size() * sizeof ( uint32_t ) );
+        add ( f.relocationAddresses.data(), f.relocationAddresses.size() * sizeof ( uint32_t ) );
+    }
+    return hash;
+}
+
+
+/* Copies emitted code for the cache. Returns false when the code holds *
+ * addresses that cannot be relocated, e.g. in immediates of other      *
+ * instructions or addresses that are not part of the fingerprint.      */
+static bool cacheFunction ( Emitter&                emitter,
+                            void*                   function,
+                            const CodeFingerprint&  fingerprint,
+                            CachedFunction&         cached ) {
+    if ( function == nullptr || emitter.numUnrelocatedAddresses() > 0 ) {
+        return false;
+    }
+    uint8_t* code = (uint8_t*) function;
+    cached.code.assign ( code, code + emitter.codeSize() );
+    for ( auto& relocation : emitter.relocations() ) {
+        auto it = fingerprint.addressIndex.find ( relocation.second );
+        if ( it == fingerprint.addressIndex.end() ) {
+            return false;
+        }
+        /* the immediate has to be encoded with its full width */
+        if ( relocation.first + sizeof ( void* ) > cached.code.size() 
+             || memcmp ( &cached.code [ relocation.first ], &relocation.second, sizeof ( void* ) ) != 0 ) {
+            return false;
+        }
+        cached.relocationOffsets.push_back ( relocation.first );
+        cached.relocationAddresses.push_back ( it->second );
+    }
+    return true;
+}
+
+
+/* Files of the cache are named by the CPU features that the code *
+ * may use and by the hash of the fingerprint.                    */
+static std::string codeCacheFile ( const std::string&  directory,
+                                   const std::string&  fingerprint ) {
+    const asmjit::BaseFeatures& features = asmjit::CpuInfo::host().features();
+    size_t cpuHash = CodeCacheVersion;
+    for ( size_t i = 0; i < asmjit::BaseFeatures::kNumBitWords; i++ ) {
+        cpuHash = cpuHash * 31 + std::hash < size_t > () ( features.bits() [ i ] );
+    }
+    char name [ 64 ];
+    snprintf ( name, sizeof ( name ), "/%016zx-%016zx.qcode", cpuHash, std::hash < std::string > () ( fingerprint ) );
+    return directory + name;
+}
+
+
+static bool loadCachedCode ( const std::string&      directory,
+                             const CodeFingerprint&  fingerprint,
+                             CachedQueryCode&        cached ) {
+    std::ifstream file ( codeCacheFile ( directory, fingerprint.text ), std::ios::binary );
+    if ( !file ) {
+        return false;
+    }
+    try {
+        cereal::BinaryInputArchive archive ( file );
+        archive ( cached );
+    }
+    catch ( std::exception& ) {
+        /* truncated files or damaged sizes */
+        return false;
+    }
+    if ( cached.checksum != codeChecksum ( cached ) ) {
+        return false;
+    }
+    for ( auto& f : cached.functions ) {
+        for ( size_t i = 0; i < f.relocationOffsets.size(); i++ ) {
+            if ( f.relocationAddresses [ i ] >= fingerprint.addresses.size() ) return false;
+            if ( f.relocationOffsets [ i ] + sizeof ( void* ) > f.code.size() ) return false;
+        }
+    }
+    /* the file name hash may collide */
+    return cached.fingerprint == fingerprint.text && !cached.functions.empty();
+}
+
+
+/* Writes to a temporary file first such that concurrent *
+ * compilations never read partially written code.       */
+static void storeCachedCode ( const std::string&  directory,
+                              CachedQueryCode&    cached ) {
+    cached.checksum = codeChecksum ( cached );
+    std::string filename = codeCacheFile ( directory, cached.fingerprint );
+    std::string tempname = filename + ".tmp" + std::to_string ( getpid() ) 
+                         + "-" + std::to_string ( std::hash < std::thread::id > () ( std::this_thread::get_id() ) );
+    {
+        std::ofstream file ( tempname, std::ios::binary );
+        if ( !file ) return;
+        cereal::BinaryOutputArchive archive ( file );
+        archive ( cached );
+    }
+    if ( rename ( tempname.c_str(), filename.c_str() ) != 0 ) {
+        unlink ( tempname.c_str() );
+    }
+}
@@ -293,6 +293,39 @@ ir_node* emitConstant ( JitContextFlounder& ctx, Expr* expr ) {
 
 
 
+/***  Parameter  ***/
+
+ir_node* emitParameter ( JitContextFlounder& ctx, Expr* expr ) {
+
+    ParameterBlock* params = ctx.rel.parameters;
+    size_t index = expr->value.bigintData;
+    if ( params == nullptr || index >= params->values.size() ) {
+        throw ResqlError ( "Parameter " + expr->symbol + " is only allowed in prepared statements." );
+    }
+    if ( expr->type.tag == SqlType::NT ) {
+        throw ResqlError ( "Could not derive the type of parameter " + expr->symbol + "." );
+    }
+    params->types [ index ] = expr->type;
+
+    /* load the value from the parameter block on each execution */
+    ir_node* slot = memAt ( constLoad ( constAddress ( &params->values [ index ] ) ) );
+    ir_node* res = nullptr;
+    if ( expr->type.tag == SqlType::CHAR && expr->type.charSpec().num == 1 ) {
+        ir_node* address = ctx.request ( vreg64 ( "char1_parameter_address" ) );
+        ctx.yield ( mov ( address, slot ) );
+        res = ctx.request ( vreg8 ( "char1_parameter" ) );
+        ctx.yield ( mov ( res, memAt ( address ) ) );
+        ctx.clear ( address );
+    }
+    else {
+        res = ctx.vregForType ( expr->type );
+        ctx.yield ( mov ( res, slot ) );
+    }
+    return res;
+}
+
+
+
 /***  Add  ***/
 
 ir_node* emitAddDECIMALxBIGINT ( JitContextFlounder&  ctx, 
@@ -819,7 +852,7 @@ ir_node* emitTypecastINTToBIGINT ( JitContextFlounder&  ctx,
                                    ir_node*             child ) {
 
     ir_node* res = ctx.request ( vreg64 ( "typecast_bigint" ) );
-    ctx.yield ( movsx ( res, child ) );
+    ctx.yield ( movsxd ( res, child ) );
     return res;
 }
 
@@ -911,6 +944,9 @@ ir_node* emitExpressionLiteral ( JitContextFlounder&  ctx,
 
         case Expr::CONSTANT:
             return emitConstant ( ctx, expr );
+
+        case Expr::PARAMETER:
+            return emitParameter ( ctx, expr );
         
         case Expr::STAR:
             return nullptr;
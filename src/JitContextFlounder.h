@@ -15,12 +15,15 @@
 #include <cstring>
 #include <sys/wait.h>
 #include <thread>
-#include <latch>
+#include <atomic>
+#include <barrier>
 
 #include "flounder/flounder.h"
 #include "flounder/translate.h"
 #include "flounder/asm_emitter.h"
+#include "flounder/interpreter.h"
 #include "asmjit/asmjit.h"
+#include "CodeCache.h"
 
 #include "util/Timer.h"
 #include "qlib/qlib.h"
@@ -45,11 +48,11 @@ struct SingleThreadGuard {
 
     std::atomic<bool> singleThreadFlag = true;
 
-    std::latch latchSyncAfter;
+    std::barrier<> barrierSyncAfter;
 
     ir_node* endSingleThreadLabel = nullptr;
 
-    SingleThreadGuard ( size_t numThreads ) : latchSyncAfter ( numThreads ) {} 
+    SingleThreadGuard ( size_t numThreads ) : barrierSyncAfter ( numThreads ) {} 
 
     static bool getSingleThreadFlag ( SingleThreadGuard* state ) {
         bool expected = true;
@@ -58,7 +61,12 @@ struct SingleThreadGuard {
     }
 
     static void syncAfter ( SingleThreadGuard* state ) {
-        state->latchSyncAfter.arrive_and_wait();
+        state->barrierSyncAfter.arrive_and_wait();
+    }
+
+    /* prepare the guard for another execution of the query */
+    void reset () {
+        singleThreadFlag = true;
     }
 
     void open ( ir_node* root ) {
@@ -99,12 +107,37 @@ struct JitConfig {
      * assembler (false).                                */
     bool emitMachineCode = false;
     
-    /* Apply optimzations to Flounder IR (currently unavailable) */
-    bool optimizeFlounder = false;
+    /* Apply optimzations to Flounder IR before register allocation */
+    bool optimizeFlounder = true;
+    
+    /* Prefilter scans below selections with vectorized comparisons */
+    bool simdSelection = true;
+    
+    /* Start small queries in the Flounder interpreter and compile *
+     * their machine code in the background                        */
+    bool tieredExecution = true;
+    
+    /* Run queries only in the Flounder interpreter and compile no  *
+     * machine code unless the interpreter does not support the IR */
+    bool forceInterpreter = false;
+    
+    /* Compile pipelines as separate functions and start executing *
+     * the first pipeline while the others are compiled            */
+    bool pipelinedCompilation = true;
+    
+    /* Compile in the background only when a core is not used by *
+     * the query threads (false: also when all cores are used)   */
+    bool requireSpareCore = true;
+    
+    /* Memory budget in MB for order by. With a budget, sorted  *
+     * runs are spilled to temporary files (0: sort in memory). */
+    uint16_t sortMemoryMB = 0U;
     
     template < class Archive >
     void serialize ( Archive& ar ) {
-        ar ( printAssembly, printFlounder, printPerformance, numThreads, emitMachineCode, optimizeFlounder );
+        ar ( printAssembly, printFlounder, printPerformance, numThreads, emitMachineCode, optimizeFlounder,
+             simdSelection, tieredExecution, forceInterpreter, pipelinedCompilation, requireSpareCore, 
+             sortMemoryMB );
     } 
 };
 
@@ -121,10 +154,34 @@ struct JitExecutionReport {
     double             compilationTime = 0.0;
     double             executionTime = 0.0;
     double             nasmTime = 0.0;
+    double             comparatorCompilationTime = 0.0;
+
+    /* compile phases */
+    double             codegenTime = 0.0;
+    double             optimizationTime = 0.0;
+    double             registerAllocationTime = 0.0;
+    double             callPlacementTime = 0.0;
+    double             emitTime = 0.0;
+
+    /* the query ran in the interpreter */
+    bool               interpreted = false;
+
+    /* the machine code was loaded from the code cache */
+    bool               loadedFromCache = false;
+
+    /* number of separately compiled pipeline functions (0: one function) */
+    uint32_t           numPipelineFunctions = 0U;
+
+    /* register allocation */
+    int                numSpilledVregs = 0;
+    int                numSpillAccesses = 0;
     
     template < class Archive >
     void serialize ( Archive& ar ) {
-        ar ( config, printCode, numMachineInstructions, compilationTime, executionTime, nasmTime );
+        ar ( config, printCode, numMachineInstructions, compilationTime, executionTime, nasmTime, 
+             comparatorCompilationTime, codegenTime, optimizationTime, registerAllocationTime, 
+             callPlacementTime, emitTime, interpreted, loadedFromCache, numPipelineFunctions, numSpilledVregs, 
+             numSpillAccesses );
     } 
 };
 
@@ -140,16 +197,187 @@ void showReport ( JitExecutionReport& report ) {
             std::cout << "Emitted " << report.numMachineInstructions 
                       << " machine instructions. " << std::endl;
         }
+        std::cout << "Spilled " << report.numSpilledVregs << " vregs with "
+                  << report.numSpillAccesses << " spill accesses." << std::endl;
         std::cout << std::fixed << std::setprecision(3);
-        std::cout << "compile: " << report.compilationTime << " ms" << std::endl;
+        std::cout << "codegen: " << report.codegenTime << " ms" << std::endl;
+        if ( report.interpreted ) {
+            std::cout << "compile: " << report.compilationTime << " ms" 
+                      << ( config.forceInterpreter ? " (interpreter)" 
+                                                   : " (interpreter, machine code in background)" ) << std::endl;
+        }
+        else if ( report.loadedFromCache ) {
+            std::cout << "compile: " << report.compilationTime << " ms" 
+                      << " (machine code from cache)" << std::endl;
+        }
+        else {
+            std::cout << "compile: " << report.compilationTime << " ms" 
+                      << " (optimize " << report.optimizationTime
+                      << ", regalloc " << report.registerAllocationTime 
+                      << ", calls " << report.callPlacementTime
+                      << ", emit " << report.emitTime << ")" << std::endl;
+        }
+        if ( report.numPipelineFunctions > 0 ) {
+            std::cout << "pipelines: " << report.numPipelineFunctions << " functions,"
+                      << " first one compiled before execution" << std::endl;
+        }
         if ( !config.emitMachineCode ) {
             std::cout << "nasm:    " << report.nasmTime << " ms" << std::endl;
         }
+        if ( report.comparatorCompilationTime > 0.0 ) {
+            std::cout << "compile comparator: " << report.comparatorCompilationTime << " ms" << std::endl;
+        }
         std::cout << "execute: " << report.executionTime << " ms" << std::endl;
     }
 }
 
 
+/* Machine code of a query. The code outlives the    *
+ * Flounder IR of its context such that a compiled   *
+ * query can be executed again.                      */
+struct QueryFunction {
+
+    /* emitter that owns the code with asmjit */
+    std::unique_ptr < Emitter > emitter;
+
+    /* entry point of the code */
+    void (*func)() = nullptr;
+
+    /* mapping that holds the code from nasm or from the code cache */
+    void* mappedCode = nullptr;
+    size_t mappedSize = 0;
+
+    /* Decoded IR that is interpreted until the machine code *
+     * from the background compilation is ready.             */
+    std::unique_ptr < InterpretedCode > interpreted;
+    std::thread compileThread;
+    std::atomic < bool > compiled = false;
+
+    /* Machine code of pipelines that are compiled as separate functions. *
+     * The query threads run them in order and wait for pipelines that    *
+     * are still compiled in the background. A function that stays null  *
+     * after the count of compiled pipelines passed it failed to compile. */
+    std::vector < std::unique_ptr < Emitter > > pipelineEmitters;
+    std::vector < void (*)() > pipelineFuncs;
+    std::atomic < size_t > numCompiledPipelines = 0;
+
+
+    ~QueryFunction() {
+        if ( compileThread.joinable() ) {
+            compileThread.join();
+        }
+        if ( mappedCode != nullptr ) {
+            munmap ( mappedCode, mappedSize );
+        }
+    }
+
+
+    /* Maps the functions of cached code and patches the addresses of *
+     * the current runtime state into their address immediates.       *
+     * Returns false when the code could not be made executable.      */
+    bool loadCached ( CachedQueryCode& cached, const CodeFingerprint& fingerprint ) {
+        std::vector < size_t > offsets;
+        for ( auto& f : cached.functions ) {
+            offsets.push_back ( mappedSize );
+            mappedSize += ( f.code.size() + 15 ) & ~(size_t) 15;
+        }
+        void* buf = mmap ( NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+        if ( buf == MAP_FAILED ) {
+            mappedSize = 0;
+            return false;
+        }
+        mappedCode = buf;
+        std::vector < void (*)() > funcs;
+        for ( size_t i = 0; i < cached.functions.size(); i++ ) {
+            CachedFunction& f = cached.functions [ i ];
+            uint8_t* code = (uint8_t*) buf + offsets [ i ];
+            memcpy ( code, f.code.data(), f.code.size() );
+            for ( size_t r = 0; r < f.relocationOffsets.size(); r++ ) {
+                void* address = fingerprint.addresses [ f.relocationAddresses [ r ] ];
+                memcpy ( code + f.relocationOffsets [ r ], &address, sizeof ( void* ) );
+            }
+            funcs.push_back ( (void (*)()) code );
+        }
+        if ( mprotect ( buf, mappedSize, PROT_READ | PROT_EXEC ) != 0 ) {
+            munmap ( mappedCode, mappedSize );
+            mappedCode = nullptr;
+            mappedSize = 0;
+            return false;
+        }
+        if ( funcs.size() == 1 ) {
+            func = funcs [ 0 ];
+        }
+        else {
+            pipelineFuncs = funcs;
+            numCompiledPipelines = funcs.size();
+        }
+        compiled.store ( true, std::memory_order_release );
+        return true;
+    }
+
+
+    bool usesInterpreter () {
+        return interpreted != nullptr && !compiled.load ( std::memory_order_acquire );
+    }
+
+
+    void setPipelineCompiled ( size_t pipeline ) {
+        numCompiledPipelines.store ( pipeline + 1, std::memory_order_release );
+        numCompiledPipelines.notify_all();
+    }
+
+
+    /* Releases the waiting query threads when compilation failed */
+    void abortPipelines () {
+        numCompiledPipelines.store ( pipelineFuncs.size(), std::memory_order_release );
+        numCompiledPipelines.notify_all();
+    }
+
+
+    void runPipelines () {
+        for ( size_t i = 0; i < pipelineFuncs.size(); i++ ) {
+            size_t numCompiled = numCompiledPipelines.load ( std::memory_order_acquire );
+            while ( numCompiled <= i ) {
+                numCompiledPipelines.wait ( numCompiled, std::memory_order_acquire );
+                numCompiled = numCompiledPipelines.load ( std::memory_order_acquire );
+            }
+            if ( pipelineFuncs [ i ] == nullptr ) return;
+            pipelineFuncs [ i ] ();
+        }
+    }
+
+
+    /* Returns true when the query ran in the interpreter */
+    bool execute ( size_t numThreads ) {
+        if ( usesInterpreter() ) {
+            interpretFlounder ( *interpreted, numThreads );
+            return true;
+        }
+        auto threads = std::vector<std::thread>{};
+        threads.resize(numThreads);
+        for (auto thread_id = 0U; thread_id < numThreads; ++thread_id) {
+            if ( pipelineFuncs.empty() ) {
+                threads[thread_id] = std::thread ( func );
+            }
+            else {
+                threads[thread_id] = std::thread ( &QueryFunction::runPipelines, this );
+            }
+        }
+
+        /* wait for threads to finish */
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for ( auto f : pipelineFuncs ) {
+            if ( f == nullptr ) {
+                throw ResqlError ( "Compilation of a pipeline failed." );
+            }
+        }
+        return false;
+    }
+};
+
+
 /* Contextual information for Flounder IR-based code *
  * generation. The class holds the generated code,   * 
  * Insertion points, symbol table, and more.         *
@@ -208,18 +436,31 @@ public:
     std::set < int > vregSymbols;
             
     
-    /* Emits binary representation of assembly via       *
-     * asmjit.                                           */
-    Emitter mCodeEmitter;
-    
+    /* Machine code emitted via asmjit or loaded from    *
+     * the external assembler.                           */
+    std::unique_ptr < QueryFunction > function;
 
-    /* JIT function that points to the binary from the   *
-     * from the external assembler.                      */
-    void (*nasmJitFunc)();
-       
- 
-    /* size of the jit function */
-    size_t funcSize;
+
+    /* Arena with the IR nodes of this context and the *
+     * arena that was active before its construction.  */
+    ir_arena* arena;
+    ir_arena* previousArena;
+
+
+    /* header and footer were added to the code */
+    bool codeFinished = false;
+
+
+    /* Last line of each pipeline and the functions that the *
+     * code was split into for pipelined compilation.        */
+    std::vector < ir_node* > pipelineEnds;
+    std::vector < ir_node* > pipelineCode;
+
+
+    /* Directory of the code cache that compiled code is stored in *
+     * and the fingerprint of the code (empty: no code cache).     */
+    std::string codeCacheDirectory;
+    CodeFingerprint fingerprint;
 
 
     JitContextFlounder() : JitContextFlounder ( JitConfig() ) {};
@@ -229,11 +470,9 @@ public:
         
         this->config = config;
 
-        /* initialize global variables from flounder library */
-        allocateAllNodes();    
-        ifId = 0;
-        loopId = 0;
-        vRegNum = 0;
+        /* build the IR of this context in its own arena */
+        arena = createArena();
+        previousArena = activateArena ( arena );
 
         /* initialize global context from flounder */
         codeTree   = irRoot();
@@ -246,8 +485,9 @@ public:
 
     ~JitContextFlounder() {
         
-        /* release global variables from flounder library */
-        freeAllNodes();
+        /* release the IR and reactivate the arena of an enclosing context */
+        activateArena ( previousArena );
+        freeArena ( arena );
     }
 
 
@@ -271,6 +511,7 @@ public:
     void closePipeline () {
         transferNodes ( codeTree, insPipeHeader, pipeHeader );
         transferNodes ( codeTree, codeTree->lastChild, pipeFooter );
+        pipelineEnds.push_back ( codeTree->lastChild );
     }
 
 
@@ -399,6 +640,8 @@ public:
 
 
     void finishCode() {
+        if ( codeFinished ) return;
+        codeFinished = true;
         /* prepend header */
         transferNodes ( codeTree, nullptr, codeHeader );
         /* append footer */
@@ -408,51 +651,215 @@ public:
     
 
     void compile() {
-        #ifdef ALWAYS_PRINT
-        char* code;
-        code = call_emit ( codeTree ); 
-        printFormattedFlounder ( code, true, std::cerr );
-        #endif
+        function = std::make_unique < QueryFunction > ();
+        compileInto ( *function );
+    }
 
-        /* translate to assembly */
-        std::stringstream outs;
+
+    /* Decodes the code for the interpreter. Returns false when the *
+     * code has instructions that the interpreter does not support. */
+    bool decodeForInterpreter () {
+        Timer tDecode = Timer();
         report.config = config;
-        Timer tEmit = Timer();
         finishCode();
+        auto interpreted = std::make_unique < InterpretedCode > ();
+        if ( !decodeFlounder ( codeTree, arena->vRegNum, *interpreted ) ) {
+            return false;
+        }
+        function = std::make_unique < QueryFunction > ();
+        function->interpreted = std::move ( interpreted );
+        report.compilationTime = tDecode.get();
+        return true;
+    }
+
+
+    /* Compiles the remaining machine code of target on a background   *
+     * thread. The thread owns the context and builds IR in its arena. */
+    static void compileInBackground ( std::unique_ptr < JitContextFlounder >  ctx,
+                                      QueryFunction&                          target ) {
+        activateArena ( ctx->previousArena );
+        ctx->previousArena = nullptr;
+        target.compileThread = std::thread ( [ ctx = std::move ( ctx ), &target ] () mutable {
+            activateArena ( ctx->arena );
+            try {
+                ctx->compileRemaining ( target );
+            }
+            catch ( ResqlError& ) {
+                /* the query stays in the interpreter or fails on execution */
+            }
+            ctx.reset();
+        } );
+    }
+
 
+    /* Looks up the machine code of the finished IR in the code cache *
+     * of directory. On a miss the compiled code is stored later.     */
+    bool loadFromCodeCache ( const std::string& directory ) {
+        Timer tLoad = Timer();
+        report.config = config;
+        finishCode();
+        fingerprint = fingerprintFlounder ( codeTree, config.optimizeFlounder );
+        CachedQueryCode cached;
+        auto loaded = std::make_unique < QueryFunction > ();
+        if ( !loadCachedCode ( directory, fingerprint, cached ) 
+             || !loaded->loadCached ( cached, fingerprint ) ) {
+            codeCacheDirectory = directory;
+            return false;
+        }
+        function = std::move ( loaded );
+        report.loadedFromCache = true;
+        report.compilationTime = tLoad.get();
+        return true;
+    }
+
+
+    /* Stores the machine code of target when a code cache is used and *
+     * all of its functions compiled to relocatable code.              */
+    void storeInCodeCache ( QueryFunction& target ) {
+        if ( codeCacheDirectory.empty() ) return;
+        CachedQueryCode cached;
+        cached.fingerprint = fingerprint.text;
+        if ( pipelineCode.empty() ) {
+            cached.functions.resize ( 1 );
+            if ( !cacheFunction ( *target.emitter, (void*) target.func, fingerprint, cached.functions [ 0 ] ) ) return;
+        }
+        else {
+            cached.functions.resize ( pipelineCode.size() );
+            for ( size_t i = 0; i < pipelineCode.size(); i++ ) {
+                if ( target.pipelineEmitters [ i ] == nullptr ) return;
+                if ( !cacheFunction ( *target.pipelineEmitters [ i ], (void*) target.pipelineFuncs [ i ], 
+                                      fingerprint, cached.functions [ i ] ) ) return;
+            }
+        }
+        storeCachedCode ( codeCacheDirectory, cached );
+    }
+
+
+    /* Splits the code into separately compiled functions at pipeline *
+     * boundaries. Returns false when the pipelines share registers or *
+     * jump labels such that the code stays in one function.           */
+    bool splitPipelines () {
+        finishCode();
+        pipelineCode = splitIndependentCode ( codeTree, pipelineEnds );
+        return !pipelineCode.empty();
+    }
+
+
+    /* Compiles the first pipeline function such that the query can *
+     * start while the others are compiled by compileInBackground.  */
+    void compileFirstPipeline () {
+        report.config = config;
+        report.numPipelineFunctions = pipelineCode.size();
+        function = std::make_unique < QueryFunction > ();
+        function->pipelineEmitters.resize ( pipelineCode.size() );
+        function->pipelineFuncs.assign ( pipelineCode.size(), nullptr );
+        Timer tCompile = Timer();
+        compilePipeline ( *function, 0 );
+        report.compilationTime = tCompile.get();
+    }
+
+
+    void compilePipeline ( QueryFunction& target, size_t pipeline ) {
+        std::stringstream outs;
+        translateCode ( pipelineCode [ pipeline ], outs );
+        Timer tAsmjit = Timer();
+        auto& emitter = target.pipelineEmitters [ pipeline ];
+        emitter = std::make_unique < Emitter > ();
+        report.numMachineInstructions += emitter->emit ( pipelineCode [ pipeline ] );
+        target.pipelineFuncs [ pipeline ] = (void (*)()) emitter->function();
+        report.emitTime += tAsmjit.get();
+        if ( pipeline + 1 == pipelineCode.size() ) {
+            storeInCodeCache ( target );
+        }
+        target.setPipelineCompiled ( pipeline );
+    }
+
+
+    /* Compiles the code that target does not have yet: all of it *
+     * for the interpreter or the pipelines after the first one.   */
+    void compileRemaining ( QueryFunction& target ) {
+        if ( pipelineCode.empty() ) {
+            compileInto ( target );
+            return;
+        }
+        try {
+            for ( size_t i = target.numCompiledPipelines; i < pipelineCode.size(); i++ ) {
+                compilePipeline ( target, i );
+            }
+        }
+        catch ( ResqlError& ) {
+            target.abortPipelines();
+            throw;
+        }
+    }
+
+
+    /* Optimizes and allocates registers for the Flounder IR in code */
+    void translateCode ( ir_node* code, std::stringstream& outs ) {
+        TranslationStatistics stats;
         try {
-            translateFlounderToMachineIR ( codeTree, 
+            translateFlounderToMachineIR ( code, 
                                            outs, 
                                            config.optimizeFlounder, 
                                            config.printFlounder, 
-                                           config.printAssembly );
+                                           config.printAssembly,
+                                           &stats );
         }
         catch ( ResqlError& err ) {
-            char* code;
-            code = call_emit ( codeTree ); 
+            char* str;
+            str = call_emit ( code ); 
             std::cerr <<  "---------Error during translation of FLOUNDER IR ---------" << std::endl;
             std::cerr << err.message();
             std::cerr << "Flounder code so far:" << std::endl;
-            printFormattedFlounder ( code, true, std::cerr );
-            free ( code );
+            printFormattedFlounder ( str, true, std::cerr );
+            free ( str );
             throw err;
         }
 
+        report.optimizationTime += stats.optimization;
+        report.registerAllocationTime += stats.registerAllocation;
+        report.callPlacementTime += stats.callPlacement;
+        report.numSpilledVregs += stats.numSpilledVregs;
+        report.numSpillAccesses += stats.numSpillAccesses;
+    }
+
+
+    void compileInto ( QueryFunction& target ) {
+        #ifdef ALWAYS_PRINT
+        char* code;
+        code = call_emit ( codeTree ); 
+        printFormattedFlounder ( code, true, std::cerr );
+        #endif
+
+        /* translate to assembly */
+        std::stringstream outs;
+        report.config = config;
+        Timer tEmit = Timer();
+        finishCode();
+        translateCode ( codeTree, outs );
+
         if ( config.emitMachineCode ) {
             /* emit binary representation */
-            report.numMachineInstructions = mCodeEmitter.emit ( codeTree );
+            Timer tAsmjit = Timer();
+            target.emitter = std::make_unique < Emitter > ();
+            report.numMachineInstructions = target.emitter->emit ( codeTree );
+            target.func = (void (*)()) target.emitter->function();
+            report.emitTime = tAsmjit.get();
             report.compilationTime = tEmit.get();
+            storeInCodeCache ( target );
         } else {
             /* emit asm characters */
             char* code = call_emit ( codeTree ); 
             report.compilationTime = tEmit.get();
             /* run external assembler to emit binary */
             Timer tNasm = Timer();
-            nasmJitFunc = (void (*)()) execNasmAndLoad ( code );
+            target.mappedCode = execNasmAndLoad ( code, target.mappedSize );
+            target.func = (void (*)()) target.mappedCode;
             free ( code );
             report.nasmTime = tNasm.get();
         }
         report.printCode += outs.str();
+        target.compiled.store ( true, std::memory_order_release );
     }
     
  
@@ -460,34 +867,12 @@ public:
         Timer tExec = Timer();
 
         /* execute binary query */
-        auto threads = std::vector<std::thread>{};
-        threads.resize(config.numThreads);
-        for (auto thread_id = 0U; thread_id < config.numThreads; ++thread_id) {
-
-            /* asmjit */
-            if ( config.emitMachineCode ) {
-                threads[thread_id] = std::thread( &Emitter::execute, std::ref ( mCodeEmitter ) );
-            } 
-
-            /* nasm */
-            else {
-                threads[thread_id] = std::thread ( nasmJitFunc );
-            }
-        }
-        
-        /* wait for threads to finish */
-        for (auto& thread : threads) {
-            thread.join();
-        }
-
-        if ( !config.emitMachineCode ) {
-            munmap ( (void*) nasmJitFunc, funcSize );
-        }
+        function->execute ( config.numThreads );
         report.executionTime = tExec.get();
     }
 
 
-    void* execNasmAndLoad ( char* code ) {
+    void* execNasmAndLoad ( char* code, size_t& funcSize ) {
         int prot = PROT_READ | PROT_WRITE;
         int flags = MAP_ANONYMOUS | MAP_PRIVATE;
         char templateName[] = "jitnasmXXXXXX";
@@ -15,5 +15,8 @@ public:
     int innerScanCount= 0;
     int exprIdGen = 1; // start with 1 because 0 means undefined 
     std::map < std::string, SqlType > symbolTypes;
+
+    /* parameters when compiling a prepared statement */
+    ParameterBlock* parameters = nullptr;
 };
 
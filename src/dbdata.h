@@ -9,8 +9,12 @@
 #include <iomanip>
 #include <map>
 #include <mutex>
+#include <cstring>
+#include <string_view>
+#include <unordered_set>
 #include "schema.h"
 #include "values.h"
+#include "statistics.h"
 #include "util/defs.h"
 #include "util/Timer.h"
 #include "util/ResqlError.h"
@@ -102,6 +106,67 @@ struct DataBlock {
 };
 
 
+/* Hash set of the tuples of a relation by the values of a unique key. *
+ * Tuples are hashed and compared by their key fields in place.        */
+struct UniqueKeyIndex {
+
+    struct KeyField {
+        size_t offset;
+        size_t size;
+        bool   isString;
+
+        std::string_view get ( Data* tuple ) const {
+            char* field = (char*) ( tuple + offset );
+            return std::string_view ( field, isString ? strnlen ( field, size ) : size );
+        }
+    };
+
+    struct KeyHash {
+        std::vector < KeyField > fields;
+
+        size_t operator() ( Data* tuple ) const {
+            size_t h = 0;
+            for ( auto& f : fields ) {
+                h = h * 31 + std::hash < std::string_view > () ( f.get ( tuple ) );
+            }
+            return h;
+        }
+    };
+
+    struct KeyEqual {
+        std::vector < KeyField > fields;
+
+        bool operator() ( Data* a, Data* b ) const {
+            for ( auto& f : fields ) {
+                if ( f.get ( a ) != f.get ( b ) ) return false;
+            }
+            return true;
+        }
+    };
+
+    std::unordered_set < Data*, KeyHash, KeyEqual > tuples;
+
+
+    UniqueKeyIndex ( const std::vector < KeyField >& fields ) 
+        : tuples ( 0, KeyHash { fields }, KeyEqual { fields } ) {}
+
+
+    /* Returns false when a tuple with the same key exists */
+    bool insert ( Data* tuple ) {
+        return tuples.insert ( tuple ).second;
+    }
+
+
+    /* Removes the tuple but not another tuple with the same key */
+    void erase ( Data* tuple ) {
+        auto it = tuples.find ( tuple );
+        if ( it != tuples.end() && *it == tuple ) {
+            tuples.erase ( it );
+        }
+    }
+};
+
+
 struct Relation {
     
 
@@ -379,6 +444,10 @@ struct Relation {
     Relation ( Relation&& other ) {
         this->_schema = other._schema;
         this->_dataBlocks = std::move ( other._dataBlocks );
+        this->_sortedAttributes = std::move ( other._sortedAttributes );
+        this->_uniqueKeys = std::move ( other._uniqueKeys );
+        this->_uniqueKeyIndexes = std::move ( other._uniqueKeyIndexes );
+        this->_statistics = std::move ( other._statistics );
     }
 
     /* assignment */
@@ -389,6 +458,10 @@ struct Relation {
         if (this != &other) { 
             this->_schema = other._schema;
             this->_dataBlocks = std::move ( other._dataBlocks );
+            this->_sortedAttributes = std::move ( other._sortedAttributes );
+            this->_uniqueKeys = std::move ( other._uniqueKeys );
+            this->_uniqueKeyIndexes = std::move ( other._uniqueKeyIndexes );
+            this->_statistics = std::move ( other._statistics );
         }
         return *this; 
     }
@@ -434,12 +507,171 @@ struct Relation {
     }
 
 
+    /* Finds integer attributes whose values ascend in storage order */
+    void updateSortedAttributes ( ) {
+        _sortedAttributes.clear();
+        size_t offset = 0;
+        for ( auto& a : _schema._attribs ) {
+            bool isSorted = false;
+            switch ( a.type.tag ) {
+                case SqlType::INT:
+                case SqlType::DATE:
+                    isSorted = isAscending < int32_t > ( offset );
+                    break;
+                case SqlType::BIGINT:
+                    isSorted = isAscending < int64_t > ( offset );
+                    break;
+                default:
+                    break;
+            }
+            if ( isSorted ) {
+                _sortedAttributes.insert ( a.name );
+            }
+            offset += getSizeInTuple ( a.type, _schema._stringsByVal );
+        }
+    }
+
+
+    template < typename T >
+    bool isAscending ( size_t offset ) {
+        bool first = true;
+        T last = 0;
+        for ( auto& block : _dataBlocks ) {
+            for ( Data* tuple = block->begin(); tuple < block->end(); tuple += _schema._tupSize ) {
+                T val = *(T*) ( tuple + offset );
+                if ( !first && val < last ) {
+                    return false;
+                }
+                first = false;
+                last = val;
+            }
+        }
+        return true;
+    }
+
+
+    bool isSortedBy ( const std::string& attributeName ) {
+        return _sortedAttributes.count ( attributeName ) > 0;
+    }
+
+
+    /* Collects the row count and per attribute statistics */
+    void updateStatistics ( ) {
+        size_t rowCount = tupleNum();
+        std::vector < ColumnStatisticsBuilder > builders;
+        std::vector < size_t > offsets;
+        size_t offset = 0;
+        for ( auto& a : _schema._attribs ) {
+            builders.emplace_back ( a.type, _schema._stringsByVal, rowCount );
+            offsets.push_back ( offset );
+            offset += getSizeInTuple ( a.type, _schema._stringsByVal );
+        }
+        for ( auto& block : _dataBlocks ) {
+            for ( Data* tuple = block->begin(); tuple < block->end(); tuple += _schema._tupSize ) {
+                for ( size_t i = 0; i < builders.size(); i++ ) {
+                    builders [ i ].add ( tuple + offsets [ i ] );
+                }
+            }
+        }
+        _statistics.rowCount = rowCount;
+        _statistics.columns.clear();
+        for ( size_t i = 0; i < builders.size(); i++ ) {
+            _statistics.columns [ _schema._attribs [ i ].name ] = builders [ i ].finish();
+        }
+    }
+
+
+    /* Calls f for each tuple starting with the tuple at position first */
+    template < typename F >
+    void forEachTuple ( size_t first, F f ) {
+        size_t skip = first * _schema._tupSize;
+        for ( auto& block : _dataBlocks ) {
+            if ( skip >= block->_contentSize ) {
+                skip -= block->_contentSize;
+                continue;
+            }
+            for ( Data* tuple = block->begin() + skip; tuple < block->end(); tuple += _schema._tupSize ) {
+                f ( tuple );
+            }
+            skip = 0;
+        }
+    }
+
+
+    /* Declares the unique keys and indexes the tuples by them */
+    void setUniqueKeys ( const std::vector < std::vector < std::string > >& keys ) {
+        _uniqueKeys = keys;
+        _uniqueKeyIndexes.clear();
+        for ( auto& key : keys ) {
+            std::vector < UniqueKeyIndex::KeyField > fields;
+            for ( auto& name : key ) {
+                SqlType type = _schema.getTypeByName ( name );
+                fields.push_back ( { (size_t) _schema.getOffsetInTuple ( name ),
+                                     (size_t) getSizeInTuple ( type, _schema._stringsByVal ),
+                                     type.tag == SqlType::VARCHAR || type.tag == SqlType::CHAR } );
+            }
+            _uniqueKeyIndexes.emplace_back ( fields );
+        }
+        indexUniqueKeys ( 0 );
+    }
+
+
+    /* Adds the tuples from position first on to the unique key indexes. *
+     * On a duplicate key the tuples are removed from the indexes again  *
+     * and the violated key is returned, otherwise nullptr.              */
+    const std::vector < std::string >* indexUniqueKeys ( size_t first ) {
+        for ( size_t k = 0; k < _uniqueKeyIndexes.size(); k++ ) {
+            bool unique = true;
+            forEachTuple ( first, [&] ( Data* tuple ) {
+                unique &= _uniqueKeyIndexes [ k ].insert ( tuple );
+            } );
+            if ( !unique ) {
+                for ( auto& index : _uniqueKeyIndexes ) {
+                    forEachTuple ( first, [&] ( Data* tuple ) { index.erase ( tuple ); } );
+                }
+                return &_uniqueKeys [ k ];
+            }
+        }
+        return nullptr;
+    }
+
+
+    /* Returns whether the attributes contain all attributes of a unique key */
+    bool hasUniqueKey ( const SymbolSet& attributes ) {
+        for ( auto& key : _uniqueKeys ) {
+            bool containsAll = true;
+            for ( auto& name : key ) {
+                containsAll &= attributes.count ( name ) > 0;
+            }
+            if ( containsAll ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+
     /* attributes */
     Schema _schema;
 
 
     std::vector < std::unique_ptr < DataBlock > > _dataBlocks;
 
+
+    /* Attributes by which the tuples are ordered, e.g. when *
+     * the table file is clustered by its key.               */
+    SymbolSet _sortedAttributes;
+
+
+    /* Attributes of the primary key and unique constraints. Each key *
+     * identifies at most one tuple.                                  */
+    std::vector < std::vector < std::string > > _uniqueKeys;
+    std::vector < UniqueKeyIndex > _uniqueKeyIndexes;
+
+
+    /* Statistics from the last bulk insert or analyze */
+    TableStatistics _statistics;
+
     
     /* serialization                                                         *
      * we have to split save and load here, because the size of _data cannot *
@@ -461,9 +693,22 @@ struct Relation {
 };
 
 
+/* compiled select and prepared statements, see execute.h */
+struct CompiledQuery;
+struct PreparedStatement;
+
+
 struct Database {
     std::map < std::string, Relation > relations;
 
+    /* Compiled select statements by normalized statement text. The  *
+     * cache is cleared when tables are created, filled or analyzed. */
+    std::map < std::string, std::shared_ptr < CompiledQuery > > compiledQueries;
+    uint64_t compiledQueryUses = 0;
+
+    /* prepared statements by name */
+    std::map < std::string, std::shared_ptr < PreparedStatement > > preparedStatements;
+
     Relation& operator[] ( std::string name ) {
         return relations[name];
     }
@@ -24,6 +24,10 @@ struct DBConfig {
     JitConfig jit = JitConfig();
     bool showPlan = false;
     bool writeResultsToFile = false;
+
+    /* Directory with machine code of queries that is reused *
+     * across restarts (empty: no code cache)                 */
+    std::string codeCacheDirectory = "";
 };
 
 
@@ -210,10 +214,87 @@ void writeRelationToFile ( Relation& rel, std::string filename ) {
 }
 
 
-std::unique_ptr < SelectResult >  executeSelectPlan ( RelOperator*  root, 
-                                                      bool          requestAll,
-                                                      Database&     db,
-                                                      DBConfig      config=DBConfig() ) {
+/* Query plan with its compiled code. The plan keeps the operator *
+ * states alive that the code refers to by address. Before the    *
+ * query is executed again, the states are reset in place.        */
+struct CompiledQuery {
+
+    RelOperator*                       plan;
+    std::unique_ptr < QueryFunction >  function;
+    JitExecutionReport                 report;
+    std::string                        queryPlan;
+    size_t                             numExecutions = 0;
+    uint64_t                           lastUse = 0;
+
+    CompiledQuery ( RelOperator* plan ) : plan ( plan ) {}
+
+    ~CompiledQuery() {
+        /* waits for a background compilation */
+        function.reset();
+        plan->deletePlan();
+    }
+};
+
+
+/* Maximum number of compiled queries in the cache of a database */
+const size_t MaxCompiledQueries = 64;
+
+
+/* Queries that scan at most this many tuples start in the interpreter */
+const size_t MaxInterpretedTuples = 5000;
+
+
+/* Number of base table tuples that the scans of a plan read */
+size_t numScannedTuples ( RelOperator* op ) {
+    size_t num = ( op->tag == RelOperator::SCAN ) ? op->getSize() : 0;
+    for ( auto& c : op->children ) {
+        num += numScannedTuples ( c );
+    }
+    return num;
+}
+
+
+/* Compilation in the background needs asmjit, a core that is not used *
+ * by the query threads, and is off when the code is printed.          */
+bool canCompileInBackground ( JitConfig& config ) {
+    return config.emitMachineCode
+        && !config.printFlounder
+        && !config.printAssembly
+        && ( !config.requireSpareCore || std::thread::hardware_concurrency() > config.numThreads );
+}
+
+
+/* Small queries are interpreted while their machine code is compiled */
+bool startInterpreted ( RelOperator* root, JitConfig& config ) {
+    return config.tieredExecution 
+        && canCompileInBackground ( config )
+        && numScannedTuples ( root ) <= MaxInterpretedTuples;
+}
+
+
+/* The code cache holds asmjit code and no printed code */
+bool useCodeCache ( DBConfig& config ) {
+    return !config.codeCacheDirectory.empty()
+        && config.jit.emitMachineCode
+        && !config.jit.forceInterpreter
+        && !config.jit.printFlounder
+        && !config.jit.printAssembly;
+}
+
+
+/* Queries with several pipelines start executing the first pipeline *
+ * while the later pipelines are compiled                            */
+bool startPipelined ( JitConfig& config ) {
+    return config.pipelinedCompilation
+        && canCompileInBackground ( config );
+}
+
+
+std::unique_ptr < CompiledQuery > compileSelectPlan ( RelOperator*     root, 
+                                                      bool             requestAll,
+                                                      Database&        db,
+                                                      DBConfig&        config,
+                                                      ParameterBlock*  parameters = nullptr ) {
     std::stringstream plan;
     if ( config.showPlan ) {
         root->print ( plan );
@@ -226,37 +307,371 @@ std::unique_ptr < SelectResult >  executeSelectPlan ( RelOperator*  root,
 
     exprCtx.unifyExpressions();
     //exprCtx.show();
-    JitContextFlounder ctx ( config.jit );
-    ctx.requestAll = requestAll;
+    auto ctx = std::make_unique < JitContextFlounder > ( config.jit );
+    ctx->requestAll = requestAll;
+    ctx->rel.parameters = parameters;
+    std::unique_ptr < QueryFunction > function;
+    JitExecutionReport report;
     try {
-        root->produceFlounder ( ctx, {} );
-        ctx.compile();
+        Timer tCodegen = Timer();
+        root->produceFlounder ( *ctx, {} );
+        ctx->report.codegenTime = tCodegen.get();
+        if ( config.jit.forceInterpreter && ctx->decodeForInterpreter() ) {
+            report   = ctx->report;
+            function = std::move ( ctx->function );
+        }
+        else if ( useCodeCache ( config ) && ctx->loadFromCodeCache ( config.codeCacheDirectory ) ) {
+            report   = ctx->report;
+            function = std::move ( ctx->function );
+        }
+        else if ( startInterpreted ( root, config.jit ) && ctx->decodeForInterpreter() ) {
+            report   = ctx->report;
+            function = std::move ( ctx->function );
+            JitContextFlounder::compileInBackground ( std::move ( ctx ), *function );
+        }
+        else if ( startPipelined ( config.jit ) && ctx->splitPipelines() ) {
+            ctx->compileFirstPipeline();
+            report   = ctx->report;
+            function = std::move ( ctx->function );
+            JitContextFlounder::compileInBackground ( std::move ( ctx ), *function );
+        }
+        else {
+            ctx->compile();
+            report   = ctx->report;
+            function = std::move ( ctx->function );
+        }
     }
     catch ( ResqlError& err ) {
         std::cerr << err.message();
         root->deletePlan();
         throw;
     }
-    ctx.execute();
-    std::unique_ptr < Relation > rel = root->retrieveResult();
-    root->deletePlan();
+    auto query = std::make_unique < CompiledQuery > ( root );
+    query->function  = std::move ( function );
+    query->report    = report;
+    query->queryPlan = plan.str();
+    return query;
+}
+
+
+std::unique_ptr < SelectResult > executeCompiledQuery ( CompiledQuery&  query,
+                                                        DBConfig&       config ) {
+    JitExecutionReport report = query.report;
+    report.config = config.jit;
+    if ( query.numExecutions > 0 ) {
+        query.plan->resetPlan();
+        report.compilationTime = 0.0;
+        report.nasmTime = 0.0;
+        report.comparatorCompilationTime = 0.0;
+        report.codegenTime = 0.0;
+        report.optimizationTime = 0.0;
+        report.registerAllocationTime = 0.0;
+        report.callPlacementTime = 0.0;
+        report.emitTime = 0.0;
+    }
+    query.numExecutions++;
+
+    Timer tExec = Timer();
+    report.interpreted = query.function->execute ( config.jit.numThreads );
+    report.executionTime = tExec.get();
+
+    std::unique_ptr < Relation > rel = query.plan->retrieveResult();
     if ( config.writeResultsToFile ) {
         writeRelationToFile ( *rel, "qres.tbl" ); 
     }
-    return std::make_unique < SelectResult > ( ctx.report, std::move ( rel ), plan.str() );
+    return std::make_unique < SelectResult > ( report, std::move ( rel ), query.queryPlan );
+}
+
+
+std::unique_ptr < SelectResult >  executeSelectPlan ( RelOperator*  root, 
+                                                      bool          requestAll,
+                                                      Database&     db,
+                                                      DBConfig      config=DBConfig() ) {
+    std::unique_ptr < CompiledQuery > query = compileSelectPlan ( root, requestAll, db, config );
+    return executeCompiledQuery ( *query, config );
+}
+
+
+/* Key of a select statement in the cache of compiled queries. Whitespace *
+ * outside of string literals is normalized. The key also contains the   *
+ * configuration that the generated code depends on.                     */
+std::string compiledQueryKey ( const std::string&  statement,
+                               DBConfig&           config ) {
+    std::string key;
+    bool inLiteral = false;
+    for ( char c : statement ) {
+        if ( c == '\'' ) {
+            inLiteral = !inLiteral;
+        }
+        if ( !inLiteral && std::isspace ( (unsigned char) c ) ) {
+            c = ' ';
+            if ( key.empty() || key.back() == ' ' ) continue;
+        }
+        key.push_back ( c );
+    }
+    while ( !key.empty() && ( key.back() == ' ' || key.back() == ';' ) ) {
+        key.pop_back();
+    }
+    JitConfig& jit = config.jit;
+    key += "|" + std::to_string ( jit.numThreads )
+         + "|" + std::to_string ( jit.sortMemoryMB )
+         + "|" + std::to_string ( jit.emitMachineCode )
+         + std::to_string ( jit.optimizeFlounder )
+         + std::to_string ( jit.simdSelection )
+         + std::to_string ( jit.tieredExecution )
+         + std::to_string ( jit.forceInterpreter )
+         + std::to_string ( jit.pipelinedCompilation )
+         + std::to_string ( jit.requireSpareCore )
+         + std::to_string ( jit.printAssembly )
+         + std::to_string ( jit.printFlounder )
+         + std::to_string ( config.showPlan );
+    return key;
 }
 
 
-std::unique_ptr < SelectResult > executeSelect ( Query&     query, 
-                                                 Database&  db,
-                                                 DBConfig&  config ) {
+CompiledQuery* findCompiledQuery ( const std::string&  key,
+                                   Database&           db ) {
+    auto it = db.compiledQueries.find ( key );
+    if ( it == db.compiledQueries.end() ) {
+        return nullptr;
+    }
+    it->second->lastUse = ++db.compiledQueryUses;
+    return it->second.get();
+}
+
+
+/* Adds a compiled query to the cache and evicts the least recently *
+ * used query when the cache is full.                               */
+void addCompiledQuery ( const std::string&                key,
+                        std::shared_ptr < CompiledQuery >  query,
+                        Database&                          db ) {
+    if ( db.compiledQueries.size() >= MaxCompiledQueries ) {
+        auto lru = std::min_element ( db.compiledQueries.begin(), db.compiledQueries.end(),
+            [] ( auto& a, auto& b ) { return a.second->lastUse < b.second->lastUse; } );
+        db.compiledQueries.erase ( lru );
+    }
+    query->lastUse = ++db.compiledQueryUses;
+    db.compiledQueries [ key ] = query;
+}
+
+
+/* Prepared select statement with the parameter block that its code *
+ * reads. The compiled query is dropped when tables change and the   *
+ * statement is compiled again on its next execution.                */
+struct PreparedStatement {
+
+    std::string                        statement;
+    DBConfig                           config;
+    ParameterBlock                     parameters;
+    std::unique_ptr < CompiledQuery >  query;
+
+    PreparedStatement ( std::string&  statement, 
+                        DBConfig&     config, 
+                        size_t        numParameters )
+        : statement ( statement ), config ( config ), parameters ( numParameters ) {}
+};
+
+
+/* Drops compiled code that depends on the tables of the database */
+void invalidateCompiledQueries ( Database& db ) {
+    db.compiledQueries.clear();
+    for ( auto& prepared : db.preparedStatements ) {
+        prepared.second->query.reset();
+    }
+}
+
+
+std::unique_ptr < SelectResult > executeSelect ( Query&              query, 
+                                                 Database&           db,
+                                                 DBConfig&           config,
+                                                 const std::string&  cacheKey ) {
     buildQuery ( query, db );
-    if ( query.plan != nullptr ) {
-        return executeSelectPlan ( query.plan, query.requestAll, db, config );    
+    if ( query.plan == nullptr ) {
+        throw ResqlError ( "Could not generate query plan." );
     }
-    else {
+    std::shared_ptr < CompiledQuery > compiled = compileSelectPlan ( query.plan, query.requestAll, db, config );
+    /* only queries that executed are cached, a pipeline *
+     * that failed to compile throws on execution         */
+    std::unique_ptr < SelectResult > result = executeCompiledQuery ( *compiled, config );
+    addCompiledQuery ( cacheKey, compiled, db );
+    return result;
+}
+
+
+void compilePreparedStatement ( PreparedStatement&  prepared,
+                                Query&              query,
+                                Database&           db ) {
+    buildQuery ( query, db );
+    if ( query.plan == nullptr ) {
         throw ResqlError ( "Could not generate query plan." );
     }
+    prepared.query = compileSelectPlan ( query.plan, 
+                                         query.requestAll, 
+                                         db, 
+                                         prepared.config, 
+                                         &prepared.parameters );
+}
+
+
+ControlResult executePrepare ( Query&        query, 
+                               std::string&  statement,
+                               Database&     db,
+                               DBConfig&     config ) {
+    auto prepared = std::make_shared < PreparedStatement > ( statement, config, query.numParameters );
+    compilePreparedStatement ( *prepared, query, db );
+    db.preparedStatements [ query.statementName ] = prepared;
+    return { true, "Prepared statement " + query.statementName + "\n" };
+}
+
+
+int64_t powerOfTen ( int exponent ) {
+    int64_t res = 1;
+    for ( int i=0; i < exponent; i++ ) {
+        res *= 10;
+    }
+    return res;
+}
+
+
+/* Converts an argument of an execute statement to the type of its *
+ * parameter. String values are kept in storage.                   */
+SqlValue parameterValue ( Expr*         arg,
+                          SqlType&      type,
+                          std::string&  storage ) {
+
+    SqlValue res = emptySqlValue;
+    SqlType& from = arg->type;
+    bool fromString = ( from.tag == SqlType::CHAR || from.tag == SqlType::VARCHAR );
+
+    switch ( type.tag ) {
+
+        case SqlType::BIGINT:
+            if ( from.tag == SqlType::BIGINT ) {
+                res.bigintData = arg->value.bigintData;
+                return res;
+            }
+            break;
+
+        case SqlType::DECIMAL: {
+            int scale = type.decimalSpec().scale;
+            if ( from.tag == SqlType::BIGINT ) {
+                res.decimalData = arg->value.bigintData * powerOfTen ( scale );
+                return res;
+            }
+            if ( from.tag == SqlType::DECIMAL ) {
+                int difference = scale - from.decimalSpec().scale;
+                if ( difference >= 0 ) {
+                    res.decimalData = arg->value.decimalData * powerOfTen ( difference );
+                }
+                else if ( arg->value.decimalData % powerOfTen ( -difference ) == 0 ) {
+                    res.decimalData = arg->value.decimalData / powerOfTen ( -difference );
+                }
+                else {
+                    /* truncated values would change the result of comparisons */
+                    throw ResqlError ( "Value " + arg->symbol + " has more decimal places than " 
+                        + serializeType ( type ) + " parameter." );
+                }
+                return res;
+            }
+            break;
+        }
+
+        case SqlType::FLOAT:
+            if ( from.tag == SqlType::FLOAT ) {
+                res.floatData = arg->value.floatData;
+                return res;
+            }
+            if ( from.tag == SqlType::BIGINT ) {
+                res.floatData = arg->value.bigintData;
+                return res;
+            }
+            if ( from.tag == SqlType::DECIMAL ) {
+                res.floatData = (double) arg->value.decimalData 
+                              / powerOfTen ( from.decimalSpec().scale );
+                return res;
+            }
+            break;
+
+        case SqlType::DATE:
+            if ( from.tag == SqlType::DATE ) {
+                res.dateData = arg->value.dateData;
+                return res;
+            }
+            if ( fromString ) {
+                Expr* date = ExprGen::constant ( arg->symbol, SqlType::DATE );
+                res.dateData = date->value.dateData;
+                freeExpr ( date );
+                return res;
+            }
+            break;
+
+        case SqlType::BOOL:
+            if ( from.tag == SqlType::BOOL ) {
+                res.boolData = arg->value.boolData;
+                return res;
+            }
+            break;
+
+        case SqlType::CHAR:
+            if ( fromString && arg->symbol.length() == 1 ) {
+                storage = arg->symbol;
+                res.charData = storage.data();
+                return res;
+            }
+            break;
+
+        case SqlType::VARCHAR:
+            if ( fromString ) {
+                storage = arg->symbol;
+                res.varcharData = storage.data();
+                return res;
+            }
+            break;
+
+        default:
+            break;
+    }
+    throw ResqlError ( "Expected " + serializeType ( type ) + " value instead of " 
+        + serializeType ( from ) + " for parameter." );
+}
+
+
+/* Binds the arguments to the parameter block of a prepared statement *
+ * and executes its code, that is only compiled again after tables    *
+ * changed. The code runs with the number of threads of the prepare.  */
+std::unique_ptr < SelectResult > executePrepared ( Query&     query,
+                                                   Database&  db,
+                                                   DBConfig&  config ) {
+
+    auto it = db.preparedStatements.find ( query.statementName );
+    if ( it == db.preparedStatements.end() ) {
+        throw ResqlError ( "Prepared statement " + query.statementName + " not found." );
+    }
+    PreparedStatement& prepared = *it->second;
+    if ( prepared.query == nullptr ) {
+        Query prepareQuery = parseSql ( prepared.statement );
+        compilePreparedStatement ( prepared, prepareQuery, db );
+    }
+
+    ParameterBlock& params = prepared.parameters;
+    ExprVec args = exprListToVector ( query.argumentExpr );
+    if ( args.size() != params.values.size() ) {
+        throw ResqlError ( "Prepared statement " + query.statementName + " expects " 
+            + std::to_string ( params.values.size() ) + " parameters." );
+    }
+    for ( size_t i=0; i < args.size(); i++ ) {
+        if ( args[i]->tag != Expr::CONSTANT ) {
+            throw ResqlError ( "Parameters of execute statements need to be constants." );
+        }
+        /* skip parameters that the code does not use */
+        if ( params.types[i].tag != SqlType::NT ) {
+            params.values[i] = parameterValue ( args[i], params.types[i], params.strings[i] );
+        }
+    }
+
+    DBConfig executeConfig = config;
+    executeConfig.jit.numThreads = prepared.config.jit.numThreads;
+    return executeCompiledQuery ( *prepared.query, executeConfig );
 }
 
 
@@ -276,7 +691,16 @@ CreateTableResult executeCreateTable ( Query&     query,
         expr = expr->next; 
     }
     Schema s = Schema ( atts );
-    db.relations.try_emplace ( query.tableName, s );
+    for ( auto& key : query.uniqueKeys ) {
+        for ( auto& name : key ) {
+            if ( !s.contains ( name ) ) {
+                throw ResqlError ( "Key attribute " + name + " is not in table " + query.tableName + "." );
+            }
+        }
+    }
+    invalidateCompiledQueries ( db );
+    Relation& table = db.relations.try_emplace ( query.tableName, s ).first->second;
+    table.setUniqueKeys ( query.uniqueKeys );
     return { query.tableName };
 } 
 
@@ -348,10 +772,12 @@ BulkInsertResult executeBulkInsert ( Query&     query,
     std::string line;
 
     /* Access and iterate table elements */
+    invalidateCompiledQueries ( db );
     Relation& table = db.relations [ query.tableName ];
     auto appendIt = Relation::AppendIterator ( &table );
     auto atts = AttributeIterator::getAll ( table._schema );
     size_t numInserts = 0;
+    size_t numTuplesBefore = table.tupleNum();
         
     while ( std::getline ( f, line) ) {
 
@@ -384,6 +810,21 @@ BulkInsertResult executeBulkInsert ( Query&     query,
         }
         numInserts++;
     }
+
+    /* verify key constraints on the inserted tuples and remove them on violation */
+    const std::vector < std::string >* violatedKey = table.indexUniqueKeys ( numTuplesBefore );
+    if ( violatedKey != nullptr ) {
+        table.applyLimit ( numTuplesBefore );
+        std::string keyNames;
+        for ( auto& name : *violatedKey ) {
+            keyNames += ( keyNames.empty() ? "" : ", " ) + name;
+        }
+        throw ResqlError ( "Bulk insert violates unique key ( " + keyNames + " ) of table " + query.tableName + "." );
+    }
+
+    /* ordering metadata and statistics for the planner */
+    table.updateSortedAttributes();
+    table.updateStatistics();
     return { numInserts, 0.0 };
 } 
 
@@ -404,6 +845,35 @@ void showTables ( Database& db, std::stringstream& out ) {
 }
 
 
+void analyzeTable ( std::string         name,
+                    Database&           db,
+                    std::stringstream&  out ) {
+
+    if ( db.relations.count ( name ) == 0 ) {
+        throw ResqlError ( "Table " + name + " does not exist." );
+    }
+    Relation& rel = db.relations [ name ];
+    rel.updateStatistics();
+    invalidateCompiledQueries ( db );
+
+    std::vector < std::string > table;
+    table.push_back ( "Attribute" );
+    table.push_back ( "Min" );
+    table.push_back ( "Max" );
+    table.push_back ( "Distinct values" );
+    for ( auto& a : rel._schema._attribs ) {
+        ColumnStatistics* stats = rel._statistics.column ( a.name );
+        bool hasRange = stats->isNumeric && rel._statistics.rowCount > 0;
+        table.push_back ( a.name );
+        table.push_back ( hasRange ? serializeSqlValue ( stats->min, a.type ) : "-" );
+        table.push_back ( hasRange ? serializeSqlValue ( stats->max, a.type ) : "-" );
+        table.push_back ( std::to_string ( (size_t) std::llround ( stats->distinct ) ) );
+    }
+    std::string sub = std::to_string ( rel._statistics.rowCount ) + " tuples";
+    printStringTable ( out, table, 4, 1, sub );
+}
+
+
 void setBoolVar ( std::string         cmd, 
                   std::string         search, 
                   bool&               var,
@@ -464,12 +934,25 @@ ControlResult processControl ( std::string  line,
     setBoolVar ( line, "showfln",  config.jit.printFlounder, actionDone, out );       
     setBoolVar ( line, "optimize", config.jit.optimizeFlounder, actionDone, out );       
     setBoolVar ( line, "emitmc",   config.jit.emitMachineCode, actionDone, out );       
+    setBoolVar ( line, "simdsel",  config.jit.simdSelection, actionDone, out );       
+    setBoolVar ( line, "tiered",   config.jit.tieredExecution, actionDone, out );       
+    setBoolVar ( line, "interp",   config.jit.forceInterpreter, actionDone, out );       
+    setBoolVar ( line, "pipecomp", config.jit.pipelinedCompilation, actionDone, out );       
+    setIntVar  ( line, "sortmem",  config.jit.sortMemoryMB, actionDone, out );    
     
     if ( line.compare ( "tables" ) == 0 ) {
         showTables ( db, out );
         actionDone = true;
     }
 
+    if ( line.find ( "analyze " ) == 0 ) {
+        std::string name = line.substr ( 8 );
+        rtrim ( name );
+        ltrim ( name );
+        analyzeTable ( name, db, out );
+        actionDone = true;
+    }
+
     return { actionDone, out.str() };
 }
 
@@ -516,6 +999,13 @@ QueryResult executeStatement ( std::string  statement,
             return res;
         }
 
+        /* execute compiled select statements again */
+        std::string cacheKey = compiledQueryKey ( statement, config );
+        CompiledQuery* compiled = findCompiledQuery ( cacheKey, db );
+        if ( compiled != nullptr ) {
+            return executeCompiledQuery ( *compiled, config );
+        }
+
         /* parse query statement */
         Query query = parseSql ( statement );
         if ( query.parseError ) {
@@ -524,7 +1014,7 @@ QueryResult executeStatement ( std::string  statement,
 
         /* execute statement */
         if ( query.tag == Query::SELECT ) {
-            return executeSelect ( query, db, config );
+            return executeSelect ( query, db, config, cacheKey );
         }
         else if ( query.tag == Query::CREATE_TABLE ) {
             return executeCreateTable ( query, db );
@@ -532,6 +1022,12 @@ QueryResult executeStatement ( std::string  statement,
         else if ( query.tag == Query::BULK_INSERT ) {
             return executeBulkInsert ( query, db );
         }
+        else if ( query.tag == Query::PREPARE ) {
+            return executePrepare ( query, statement, db, config );
+        }
+        else if ( query.tag == Query::EXECUTE ) {
+            return executePrepared ( query, db, config );
+        }
     }
     catch ( std::runtime_error& e ) {
         return QueryResult ( e );
@@ -51,10 +51,17 @@ struct Expr {
         /* case */
         CASE,
         WHENTHEN,
+        /* subquery */
+        EXISTS,
+        NOT_EXISTS,
+        IN_SUBQUERY,
+        NOT_IN_SUBQUERY,
+        SUBQUERY,
         /* other */
         ATTRIBUTE,
         TYPECAST,
         CONSTANT,
+        PARAMETER,
         AS,
         TYPE,
         TABLE,
@@ -119,10 +126,17 @@ const char* exprTagNames[] {
     /* case */
     "CASE",
     "WHENTHEN",
+    /* subquery */
+    "EXISTS",
+    "NOT_EXISTS",
+    "IN_SUBQUERY",
+    "NOT_IN_SUBQUERY",
+    "SUBQUERY",
     /* other */
     "ATTRIBUTE",
     "TYPECAST",
     "CONSTANT",
+    "PARAMETER",
     "AS",
     "TYPE",
     "TABLE",
@@ -188,6 +202,10 @@ std::string serializeExpr ( Expr* e ) {
             ss << ","
                << serializeSqlValue ( e->value, e->type );
             break;
+        case Expr::PARAMETER:
+            ss << ","
+               << e->symbol;
+            break;
         default:
             // nothing to do
             break;
@@ -522,6 +540,13 @@ namespace ExprGen {
         parseConstant ( e, typeCategory );
         return e;
     }
+
+    /* parameter of a prepared statement with its position in the value field */
+    Expr* parameter ( size_t index ) {
+        Expr* e = literalExpr ( Expr::PARAMETER, "?" + std::to_string ( index + 1 ) );
+        e->value.bigintData = index;
+        return e;
+    }
     
     Expr* add ( Expr* l, Expr* r ) {
         Expr* e = binaryExpr ( Expr::ADD, "+", l, r );
@@ -642,6 +667,40 @@ namespace ExprGen {
         return e;
     }
     
+    /* The children of a subquery are the select expression, *
+     * the tables and the where condition if there is one.  */
+    Expr* subquery ( Expr* select, Expr* tables, Expr* where ) {
+        Expr* e = otherExpr ( Expr::SUBQUERY, "subquery" );
+        select->next = tables;
+        Expr* last = tables;
+        while ( last->next != nullptr ) {
+            last = last->next;
+        }
+        last->next = where;
+        e->child = select;
+        return e;
+    }
+    
+    Expr* exists ( Expr* subquery ) {
+        Expr* e = unaryExpr ( Expr::EXISTS, "exists", subquery );
+        return e;
+    }
+    
+    Expr* notExists ( Expr* subquery ) {
+        Expr* e = unaryExpr ( Expr::NOT_EXISTS, "not exists", subquery );
+        return e;
+    }
+    
+    Expr* inSubquery ( Expr* probe, Expr* subquery ) {
+        Expr* e = binaryExpr ( Expr::IN_SUBQUERY, "in", probe, subquery );
+        return e;
+    }
+    
+    Expr* notInSubquery ( Expr* probe, Expr* subquery ) {
+        Expr* e = binaryExpr ( Expr::NOT_IN_SUBQUERY, "not in", probe, subquery );
+        return e;
+    }
+    
     Expr* attr ( std::string symbol ) {
         Expr* e = literalExpr ( Expr::ATTRIBUTE, symbol );
         return e;
@@ -1230,6 +1289,10 @@ void deriveExpressionTypesLiteral ( Expr*                             e,
             /* nothing to do here, type already defined by parser */
             break;
 
+        case Expr::PARAMETER:
+            /* type is defined by the enclosing expression */
+            break;
+
         case Expr::STAR:
             /* for count(*) and select * also gets BIGINT but is never used */
             e->type = TypeInit::BIGINT();
@@ -1290,6 +1353,29 @@ void deriveExpressionTypesUnary ( Expr*                             e,
 }
 
 
+/* Parameters of prepared statements take the type of the other operand, *
+ * e.g. of the attribute in 'x > ?'. Like constants, integer parameters   *
+ * are bigints and string parameters with more than one character are    *
+ * varchars.                                                             */
+void deriveParameterType ( Expr* param, Expr* other ) {
+
+    if ( param->tag != Expr::PARAMETER || param->type.tag != SqlType::NT ) {
+        return;
+    }
+    if ( other->type.tag == SqlType::NT ) {
+        throw ResqlError ( "Could not derive the type of parameter " + param->symbol + "." );
+    }
+    SqlType type = other->type;
+    if ( type.tag == SqlType::INT ) {
+        type = TypeInit::BIGINT ( );
+    }
+    if ( type.tag == SqlType::CHAR && type.charSpec().num > 1 ) {
+        type = TypeInit::VARCHAR ( type.charSpec().num );
+    }
+    param->type = type;
+}
+
+
 void deriveExpressionTypesBinary ( Expr*                             e, 
                                    std::map <std::string, SqlType>&  identTypes ) {
             
@@ -1297,6 +1383,8 @@ void deriveExpressionTypesBinary ( Expr*                             e,
     Expr* right = e->child->next;
     deriveExpressionTypes ( left, identTypes );
     deriveExpressionTypes ( right, identTypes );
+    deriveParameterType ( left, right );
+    deriveParameterType ( right, left );
 
     switch ( e->tag ) {
         case Expr::ADD:
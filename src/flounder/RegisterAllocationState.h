@@ -22,8 +22,8 @@ struct RegisterAllocationState {
         currentlyAllocated = (bool*) malloc ( sizeof ( bool ) * numVregs );
         explicitAlloc = (bool*) malloc ( sizeof ( bool ) * numVregs );
         for ( int i=0; i<numMregs; i++) mregInUse[i] = 0;
-        for ( int i=0; i<vRegNum; i++) allocation[i] = 0;
-        for ( int i=0; i<vRegNum; i++) currentlyAllocated[i] = false;
+        for ( int i=0; i<numVregs; i++) allocation[i] = 0;
+        for ( int i=0; i<numVregs; i++) currentlyAllocated[i] = false;
     }
 
     
@@ -78,6 +78,10 @@ struct RegisterAllocationState {
     //     Doing so could improve stack access locality.
     //
     int numSpillSlots = 0;
+
+
+    // Number of virtual registers that were spilled
+    int numSpilledVregs = 0;
     
 
     size_t spillSize = 0;
@@ -95,9 +99,9 @@ struct RegisterAllocationState {
 };
 
 
-static ir_node* getAllocatedMachineRegister ( ir_node* vregNode, 
-                                              int*     allocation ) {
-    uint8_t id = allocation [ vregNode->id ] - 1;
+/* machine register 'id' with the size of the vreg */
+static ir_node* getMachineRegister ( ir_node* vregNode, 
+                                     uint8_t  id ) {
     assert ( isVreg ( vregNode ) );
     if ( vregNode->nodeType == VREG8 ) {
         return reg8 ( id );
@@ -113,34 +117,21 @@ static ir_node* getAllocatedMachineRegister ( ir_node* vregNode,
 }
 
 
-static int getFreeMregId ( RegisterAllocationState& state ) {
-   
-    // prioritize callee-save registers 
-    for ( int i=0; i<numMregs; i++ ) {
-        if ( !state.mregInUse[i] && allocationMregs[i] && !callerSaveMask[i] ) {
-            return i;
-        }
-    }
-    // then use caller-save
-    for ( int i=0; i<numMregs; i++ ) {
-        if ( !state.mregInUse[i] && allocationMregs[i] ) {
-            return i;
-        }
-    }
-    assert (0);
-    return -1;
+static ir_node* getAllocatedMachineRegister ( ir_node* vregNode, 
+                                              int*     allocation ) {
+    return getMachineRegister ( vregNode, allocation [ vregNode->id ] - 1 );
 }
 
 
-
-
+/* Allocates the machine register 'mregId' or a spill slot if mregId is -1 */
 void allocateReg ( ir_node*                 vregNd, 
-                   RegisterAllocationState& state ) {
+                   RegisterAllocationState& state,
+                   int                      mregId ) {
 
-    // use machine register if available
-    if ( state.numMregsUsed < numAllocationMregs ) {
+    // use assigned machine register
+    if ( mregId >= 0 ) {
+        assert ( !state.mregInUse [ mregId ] );
         state.numMregsUsed++;
-        int mregId = getFreeMregId ( state );
         state.allocation [ vregNd->id ] = mregId+1;
         state.currentlyAllocated [ vregNd->id ] = true;
         state.mregInUse [ mregId ] = 1;
@@ -162,6 +153,7 @@ void allocateReg ( ir_node*                 vregNd,
             state.allocation [ vregNd->id ] = -state.numSpillSlots;
         }
         state.currentlyAllocated [ vregNd->id ] = true;
+        state.numSpilledVregs++;
         if ( printAllocation ) {
             printf ( "- ! - spill %s to [rsp-%i]\n", vregNd->ident, state.allocation [ vregNd->id ]*(-8) ); 
         }
@@ -4,6 +4,8 @@
  * @author Jan Mühlig <jan.muehlig@cs.tu-dortmund.de>
  * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
  */
+#pragma once
+#include <vector>
 #include <unordered_map>
 #include <algorithm>
 #include <cassert>
@@ -19,7 +21,12 @@ class Emitter
 private:
     asmjit::JitRuntime _runtime;
     asmjit::CodeHolder _code;
-    std::unordered_map<std::string, asmjit::Label> _labels;
+    std::unordered_map<const char*, asmjit::Label> _labels;
+
+    /* Code offsets of 64 bit address immediates and their addresses. *
+     * Addresses in other immediates are counted as not relocatable.  */
+    std::vector<std::pair<uint32_t, void*>> _relocations;
+    size_t _unrelocatedAddresses = 0;
 
 public:
     Emitter() {
@@ -39,27 +46,42 @@ public:
             //printf ( "current_node: %s", call_emit(current_node) );
 
             c++;
-            if(current_node->nodeType == BaseNodeTypes::ROOT) {
+            switch ( current_node->nodeType ) {
+            case BaseNodeTypes::ROOT: {
                 current_node = current_node->firstChild;
                 continue;
-            } else if(current_node->nodeType == BaseNodeTypes::UNDEFINED) {
+            } break;
+            case BaseNodeTypes::UNDEFINED: {
                 current_node = current_node->next; // TODO: Should this happen?
                 continue;
-            } else if(current_node->nodeType == NodeTypes::PUSH) {
+            } break;
+            case NodeTypes::PUSH: {
                 assert(current_node->nChildren == 1 && "PUSH has != 1 children");
                 assert( isReg ( current_node->firstChild ) && "PUSH has other type than REG");
                 asm_container.push(this->interpret_register(current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::POP) {
+            } break;
+            case NodeTypes::POP: {
                 assert(current_node->nChildren == 1 && "POP has != 1 children");
                 assert( isReg ( current_node->firstChild ) && "POP has other type than REG");
                 asm_container.pop(this->interpret_register(current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::RET) {
+            } break;
+            case NodeTypes::RET: {
                 asm_container.ret();
-            } else if(current_node->nodeType == NodeTypes::MOV) {
+            } break;
+            case NodeTypes::MOV: {
                 assert(current_node->nChildren == 2 && "MOV has != 2 children");
                 if( isReg ( current_node->firstChild ) ) {
                     auto second_child = current_node->lastChild;
-                    if ( isConst ( second_child ) ) {
+                    if ( second_child->nodeType == NodeTypes::CONSTANT_ADDRESS 
+                         && second_child->addressData != nullptr
+                         && current_node->firstChild->nodeType == NodeTypes::REG64 ) {
+                        asm_container.long_().mov(
+                                this->interpret_register(current_node->firstChild),
+                                asmjit::Imm((int64_t)second_child->addressData)
+                        );
+                        this->_relocations.emplace_back(asm_container.offset() - sizeof(void*), 
+                                                        second_child->addressData);
+                    } else if ( isConst ( second_child ) ) {
                         asm_container.mov(
                                 this->interpret_register(current_node->firstChild),
                                 this->interpret_constant(current_node->lastChild)
@@ -91,7 +113,8 @@ public:
                 } else {
                     std::cout << "TODO: MOV to " << current_node->firstChild->nodeType << std::endl;
                 }
-            } else if(current_node->nodeType == NodeTypes::MOVZX) {
+            } break;
+            case NodeTypes::MOVZX: {
                 assert(current_node->nChildren == 2 && "MOVZX has != 2 children");
                 if( isReg ( current_node->firstChild ) ) {
                     auto second_child = current_node->lastChild;
@@ -114,7 +137,8 @@ public:
                 else {
                     std::cout << "MOVZX: first operand must be reg." << std::endl;
                 }
-            } else if(current_node->nodeType == NodeTypes::MOVSX) {
+            } break;
+            case NodeTypes::MOVSX: {
                 assert(current_node->nChildren == 2 && "MOVSX has != 2 children");
                 if( isReg ( current_node->firstChild ) ) {
                     auto second_child = current_node->lastChild;
@@ -137,7 +161,8 @@ public:
                 else {
                     std::cout << "MOVSX: first operand must be reg." << std::endl;
                 }
-            } else if(current_node->nodeType == NodeTypes::MOVSXD) {
+            } break;
+            case NodeTypes::MOVSXD: {
                 assert(current_node->nChildren == 2 && "MOVSXD has != 2 children");
                 if( isReg ( current_node->firstChild ) ) {
                     auto second_child = current_node->lastChild;
@@ -160,7 +185,8 @@ public:
                 else {
                     std::cout << "MOVSXD: first operand must be reg." << std::endl;
                 }
-            } else if(current_node->nodeType == NodeTypes::CMP) {
+            } break;
+            case NodeTypes::CMP: {
                 assert(current_node->nChildren == 2 && "CMP has != 2 children");
  
                 ir_node* op1 = current_node->firstChild;
@@ -185,26 +211,32 @@ public:
                     assert(false && "CMP [2] is not REG or CONSTANT");
                 }
     
-            } 
-            else if(current_node->nodeType == NodeTypes::COMMENT_LINE) {
+            } break;
+            case NodeTypes::COMMENT_LINE: {
                 c--;c++; /* do nothing */
-            } else if(current_node->nodeType == NodeTypes::JGE) { c--;
+            } break;
+            case NodeTypes::JGE: { c--;
                 assert(current_node->nChildren == 1 && "JGE has != 1 children");
                 asm_container.jge(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::JG) { c--;
+            } break;
+            case NodeTypes::JG: { c--;
                 assert(current_node->nChildren == 1 && "JG has != 1 children");
                 asm_container.jg(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::JLE) {
+            } break;
+            case NodeTypes::JLE: {
                 c--;
                 assert(current_node->nChildren == 1 && "JLE has != 1 children");
                 asm_container.jle(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::JL) { c--;
+            } break;
+            case NodeTypes::JL: { c--;
                 assert(current_node->nChildren == 1 && "JL has != 1 children");
                 asm_container.jl(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::SECTION) {
+            } break;
+            case NodeTypes::SECTION: {
                 assert(current_node->nChildren == 0 && "SECTION has children");
                 asm_container.bind(this->label(asm_container, current_node));
-            } else if(current_node->nodeType == NodeTypes::ADD) {
+            } break;
+            case NodeTypes::ADD: {
                 assert(current_node->nChildren == 2 && "ADD has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "ADD [1] is not a REG");
                 if( isConst ( current_node->lastChild ) ) {
@@ -220,7 +252,8 @@ public:
                 } else {
                     assert(false && "ADD [2] is not a REG or CONSTANT");
                 }
-            } else if(current_node->nodeType == NodeTypes::SUB) {
+            } break;
+            case NodeTypes::SUB: {
                 assert(current_node->nChildren == 2 && "SUB has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "SUB [1] is not a REG");
                 if( isConst ( current_node->lastChild ) ) {
@@ -235,7 +268,8 @@ public:
                         this->interpret_register(current_node->lastChild)
                     );
                 }
-            } else if(current_node->nodeType == NodeTypes::IMUL) {
+            } break;
+            case NodeTypes::IMUL: {
                 assert(current_node->nChildren == 2 && "IMUL has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "IMUL [1] is not a REG");
                 if( isConst ( current_node->lastChild ) ) {
@@ -250,7 +284,8 @@ public:
                         this->interpret_register(current_node->lastChild)
                     );
                 }
-            } else if(current_node->nodeType == NodeTypes::XOR) {
+            } break;
+            case NodeTypes::XOR: {
                 assert(current_node->nChildren == 2 && "XOR has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "XOR [1] is not a REG");
                 assert( isReg ( current_node->lastChild ) && "XOR [2] is not a REG");
@@ -258,7 +293,8 @@ public:
                     this->interpret_register(current_node->firstChild),
                     this->interpret_register(current_node->lastChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::AND) {
+            } break;
+            case NodeTypes::AND: {
                 assert(current_node->nChildren == 2 && "AND has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "AND [1] is not a REG");
                 assert( isReg ( current_node->lastChild ) && "AND [2] is not a REG");
@@ -266,7 +302,8 @@ public:
                     this->interpret_register(current_node->firstChild),
                     this->interpret_register(current_node->lastChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::OR) {
+            } break;
+            case NodeTypes::OR: {
                 assert(current_node->nChildren == 2 && "OR has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "OR [1] is not a REG");
                 assert( isReg ( current_node->lastChild ) && "OR [2] is not a REG");
@@ -274,7 +311,8 @@ public:
                     this->interpret_register(current_node->firstChild),
                     this->interpret_register(current_node->lastChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::CRC32) {
+            } break;
+            case NodeTypes::CRC32: {
                 assert(current_node->nChildren == 2 && "CRC32 has != 2 children");
                 assert( isReg ( current_node->firstChild ) && "CRC32 [1] is not a REG");
                 assert( isReg ( current_node->lastChild ) && "CRC32 [2] is not a REG");
@@ -282,42 +320,61 @@ public:
                     this->interpret_register(current_node->firstChild),
                     this->interpret_register(current_node->lastChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::DIV) {
+            } break;
+            case NodeTypes::TZCNT: {
+                assert(current_node->nChildren == 2 && "TZCNT has != 2 children");
+                assert( isReg ( current_node->firstChild ) && "TZCNT [1] is not a REG");
+                assert( isReg ( current_node->lastChild ) && "TZCNT [2] is not a REG");
+                asm_container.tzcnt (
+                    this->interpret_register(current_node->firstChild),
+                    this->interpret_register(current_node->lastChild)
+                );
+            } break;
+            case NodeTypes::DIV: {
                 assert(current_node->nChildren == 1 && "DIV has != 1 children");
                 assert( isReg ( current_node->firstChild ) && "DIV [1] is not a REG");
                 asm_container.div(
                     this->interpret_register(current_node->firstChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::IDIV) {
+            } break;
+            case NodeTypes::IDIV: {
                 assert(current_node->nChildren == 1 && "IDIV has != 1 children");
                 assert( isReg ( current_node->firstChild ) && "IDIV [1] is not a REG");
                 asm_container.idiv(
                     this->interpret_register(current_node->firstChild)
                 );
-            } else if(current_node->nodeType == NodeTypes::INC) {
+            } break;
+            case NodeTypes::INC: {
                 assert(current_node->nChildren == 1 && "INC has != 1 children");
                 asm_container.inc(this->interpret_register(current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::JMP) {
+            } break;
+            case NodeTypes::JMP: {
                 assert(current_node->nChildren == 1 && "JMP has != 1 children");
                 asm_container.jmp(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::JE) {
+            } break;
+            case NodeTypes::JE: {
                 assert(current_node->nChildren == 1 && "JE has != 1 children");
                 asm_container.je(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::CDQE) {
+            } break;
+            case NodeTypes::CDQE: {
                 assert(current_node->nChildren == 0 && "CDQE has != 0 children");
                 asm_container.cdqe();
-            } else if(current_node->nodeType == NodeTypes::CQO) {
+            } break;
+            case NodeTypes::CQO: {
                 assert(current_node->nChildren == 0 && "CQO has != 0 children");
                 asm_container.cqo();
-            } else if(current_node->nodeType == NodeTypes::JNE) {
+            } break;
+            case NodeTypes::JNE: {
                 assert(current_node->nChildren == 1 && "JNE has != 1 children");
                 asm_container.jne(this->label(asm_container, current_node->firstChild));
-            } else if(current_node->nodeType == NodeTypes::CALL) {
+            } break;
+            case NodeTypes::CALL: {
                 assert(current_node->nChildren == 1 && "CALL has != 1 children");
                 assert( isReg ( current_node->firstChild ) && "CALL has not REG");
                 asm_container.call(this->interpret_register(current_node->firstChild));
+            } break;
             /* aligned simd move */
-            } else if ( current_node->nodeType == SimdNodeTypes::VMOVDQA ) {
+            case SimdNodeTypes::VMOVDQA: {
                 assert(current_node->nChildren == 2 && "VMOVDQA has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -330,7 +387,8 @@ public:
                 if ( fst->nodeType == NodeTypes::MEM_AT && scd->nodeType == SimdNodeTypes::YMM ) {
                     asm_container.vmovdqa ( this->interpret_mem ( fst ), this->interpret_register_avx ( scd ) );
                 }
-            } else if ( current_node->nodeType == SimdNodeTypes::VMOVDQA32 ) {
+            } break;
+            case SimdNodeTypes::VMOVDQA32: {
                 assert(current_node->nChildren == 2 && "VMOVDQA32 has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -343,7 +401,8 @@ public:
                 if ( fst->nodeType == NodeTypes::MEM_AT && scd->nodeType == SimdNodeTypes::ZMM ) {
                     asm_container.vmovdqa32 ( this->interpret_mem ( fst ), this->interpret_register_avx512 ( scd ) );
                 }
-            } else if ( current_node->nodeType == SimdNodeTypes::MOVDQA ) {
+            } break;
+            case SimdNodeTypes::MOVDQA: {
                 assert(current_node->nChildren == 2 && "MOVQA has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -356,8 +415,9 @@ public:
                 if ( fst->nodeType == NodeTypes::MEM_AT && scd->nodeType == SimdNodeTypes::XMM ) {
                     asm_container.movdqa ( this->interpret_mem ( fst ), this->interpret_register_sse ( scd ) );
                 }
+            } break;
             /* unaligned simd move */
-            } else if ( current_node->nodeType == SimdNodeTypes::VMOVDQU ) {
+            case SimdNodeTypes::VMOVDQU: {
                 assert(current_node->nChildren == 2 && "VMOVDQU has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -370,7 +430,8 @@ public:
                 if ( fst->nodeType == NodeTypes::MEM_AT && scd->nodeType == SimdNodeTypes::YMM ) {
                     asm_container.vmovdqu ( this->interpret_mem ( fst ), this->interpret_register_avx ( scd ) );
                 }
-            } else if ( current_node->nodeType == SimdNodeTypes::VMOVDQU32 ) {
+            } break;
+            case SimdNodeTypes::VMOVDQU32: {
                 assert(current_node->nChildren == 2 && "VMOVDQU32 has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -383,7 +444,8 @@ public:
                 if ( fst->nodeType == NodeTypes::MEM_AT && scd->nodeType == SimdNodeTypes::ZMM ) {
                     asm_container.vmovdqu32 ( this->interpret_mem ( fst ), this->interpret_register_avx512 ( scd ) );
                 }
-            } else if ( current_node->nodeType == SimdNodeTypes::MOVDQU ) {
+            } break;
+            case SimdNodeTypes::MOVDQU: {
                 assert(current_node->nChildren == 2 && "MOVQU has != 2 children");
                 ir_node* fst  = current_node->firstChild;
                 ir_node* scd = current_node->lastChild;
@@ -397,7 +459,8 @@ public:
                     asm_container.movdqu ( this->interpret_mem ( fst ), this->interpret_register_sse ( scd ) );
                 }
             /* simd extract */
-            } else if ( current_node->nodeType == SimdNodeTypes::VEXTRACTI64X2 ) {
+            } break;
+            case SimdNodeTypes::VEXTRACTI64X2: {
                 assert(current_node->nChildren == 3 && "VEXTRACTI64X2 has != 3 children");
                 ir_node* fst = current_node->firstChild;
                 ir_node* scd = current_node->firstChild->next;
@@ -408,7 +471,8 @@ public:
 		    this->interpret_register_avx ( scd ),
                     this->interpret_constant ( thd )
 		);
-            } else if ( current_node->nodeType == SimdNodeTypes::VEXTRACTF128 ) {
+            } break;
+            case SimdNodeTypes::VEXTRACTF128: {
                 assert(current_node->nChildren == 3 && "VEXTRACTF128 has != 3 children");
                 ir_node* fst = current_node->firstChild;
                 ir_node* scd = current_node->firstChild->next;
@@ -419,7 +483,8 @@ public:
 		    this->interpret_register_avx ( scd ),
                     this->interpret_constant ( thd )
 		);
-            } else if ( current_node->nodeType == SimdNodeTypes::VPEXTRQ ) {
+            } break;
+            case SimdNodeTypes::VPEXTRQ: {
                 assert(current_node->nChildren == 3 && "VPEXTRQ has != 3 children");
                 ir_node* fst = current_node->firstChild;
                 ir_node* scd = current_node->firstChild->next;
@@ -430,7 +495,8 @@ public:
 		    this->interpret_register_sse ( scd ),
                     this->interpret_constant ( thd )
 		);
-            } else if ( current_node->nodeType == SimdNodeTypes::PEXTRQ ) {
+            } break;
+            case SimdNodeTypes::PEXTRQ: {
                 assert(current_node->nChildren == 3 && "PEXTRQ has != 3 children");
                 ir_node* fst = current_node->firstChild;
                 ir_node* scd = current_node->firstChild->next;
@@ -441,8 +507,10 @@ public:
 		    this->interpret_register_sse ( scd ),
                     this->interpret_constant ( thd )
 		);
-            } else {
+            } break;
+            default: {
                 std::cout << "NodeType not recognized by MC Emitter: " << current_node->nodeType << std::endl;
+            } break;
             }
     
             current_node = current_node->next;
@@ -459,19 +527,45 @@ public:
         }
     }
 
+
+    /* Adds the emitted code to the runtime and returns its entry point */
+    const std::vector<std::pair<uint32_t, void*>>& relocations() const {
+        return this->_relocations;
+    }
+
+
+    size_t numUnrelocatedAddresses() const {
+        return this->_unrelocatedAddresses;
+    }
+
+
+    size_t codeSize() const {
+        return this->_code.codeSize();
+    }
+
+
+    void* function() {
+        Func func;
+        auto err = this->_runtime.add(&func, &this->_code);
+        if (err) {
+            return nullptr;
+        }
+        return (void*) func;
+    }
+
 private:
 
+    /* Labels are identified by the address of their interned identifier. *
+     * Placed labels (sections) carry the identifier in ident2.           */
     asmjit::Label& label(asmjit::x86::Assembler &assembler, ir_node *node) {
-        std::string label(node->ident);
-        label.erase(std::remove_if(label.begin(), label.end(), [](char c) {
-            return c == ':' || c == '\n';
-        }), label.end());
-    
-        if(this->_labels.find(label) == this->_labels.end()) {
-            this->_labels[label] = assembler.newLabel();
+        const char* ident = node->nodeType == NodeTypes::SECTION ? node->ident2 : node->ident;
+        assert(ident != nullptr && "Label without identifier");
+
+        auto it = this->_labels.find(ident);
+        if(it == this->_labels.end()) {
+            it = this->_labels.emplace(ident, assembler.newLabel()).first;
         }
-    
-        return this->_labels[label];
+        return it->second;
     }
 
 
@@ -485,6 +579,9 @@ private:
             case CONSTANT_INT8:
                 return (int64_t)node->int8Data;
             case CONSTANT_ADDRESS:
+                if ( node->addressData != nullptr ) {
+                    this->_unrelocatedAddresses++;
+                }
                 return (int64_t)node->addressData;
             case CONSTANT_DOUBLE:
                 return (int64_t)node->doubleData;
@@ -497,110 +594,33 @@ private:
 
 
     asmjit::x86::Gp interpret_register(ir_node* node) {
-        if ( node->nodeType == REG64 ) {
-            if ( node->id == RAX) {
-                return asmjit::x86::rax;
-            } else if ( node->id == RCX) {
-                return asmjit::x86::rcx;
-            } else if ( node->id == RDX) {
-                return asmjit::x86::rdx;
-            } else if ( node->id == RBX) {
-                return asmjit::x86::rbx;
-            } else if ( node->id == RSP) {
-                return asmjit::x86::rsp;
-            } else if ( node->id == RBP) {
-                return asmjit::x86::rbp;
-            } else if ( node->id == RSI) {
-                return asmjit::x86::rsi;
-            } else if ( node->id == RDI) {
-                return asmjit::x86::rdi;
-            } else if ( node->id == R8) {
-                return asmjit::x86::r8;
-            } else if ( node->id == R9) {
-                return asmjit::x86::r9;
-            } else if ( node->id == R10) {
-                return asmjit::x86::r10;
-            } else if ( node->id == R11) {
-                return asmjit::x86::r11;
-            } else if ( node->id == R12) {
-                return asmjit::x86::r12;
-            } else if ( node->id == R13) {
-                return asmjit::x86::r13;
-            } else if ( node->id == R14) {
-                return asmjit::x86::r14;
-            } else if ( node->id == R15) {
-                return asmjit::x86::r15;
-            }
-        }
-        else if ( node->nodeType == REG32 ) {
-            if ( node->id == EAX) {
-                return asmjit::x86::eax;
-            } else if ( node->id == ECX) {
-                return asmjit::x86::ecx;
-            } else if ( node->id == EDX) {
-                return asmjit::x86::edx;
-            } else if ( node->id == EBX) {
-                return asmjit::x86::ebx;
-            } else if ( node->id == ESP) {
-                return asmjit::x86::esp;
-            } else if ( node->id == EBP) {
-                return asmjit::x86::ebp;
-            } else if ( node->id == ESI) {
-                return asmjit::x86::esi;
-            } else if ( node->id == EDI) {
-                return asmjit::x86::edi;
-            } else if ( node->id == R8D) {
-                return asmjit::x86::r8d;
-            } else if ( node->id == R9D) {
-                return asmjit::x86::r9d;
-            } else if ( node->id == R10D) {
-                return asmjit::x86::r10d;
-            } else if ( node->id == R11D) {
-                return asmjit::x86::r11d;
-            } else if ( node->id == R12D) {
-                return asmjit::x86::r12d;
-            } else if ( node->id == R13D) {
-                return asmjit::x86::r13d;
-            } else if ( node->id == R14D) {
-                return asmjit::x86::r14d;
-            } else if ( node->id == R15D) {
-                return asmjit::x86::r15d;
-            }
-        }
-        else if ( node->nodeType == REG8 ) {
-            if ( node->id == AL) {
-                return asmjit::x86::al;
-            } else if ( node->id == CL) {
-                return asmjit::x86::cl;
-            } else if ( node->id == BL) {
-                return asmjit::x86::bl;
-            } else if ( node->id == DL) {
-                return asmjit::x86::dl;
-            } else if ( node->id == SPL) {
-                return asmjit::x86::spl;
-            } else if ( node->id == BPL) {
-                return asmjit::x86::bpl;
-            } else if ( node->id == SIL) {
-                return asmjit::x86::sil;
-            } else if ( node->id == DIL) {
-                return asmjit::x86::dil;
-            } else if ( node->id == R8B) {
-                return asmjit::x86::r8b;
-            } else if ( node->id == R9B) {
-                return asmjit::x86::r9b;
-            } else if ( node->id == R10B) {
-                return asmjit::x86::r10b;
-            } else if ( node->id == R11B) {
-                return asmjit::x86::r11b;
-            } else if ( node->id == R12B) {
-                return asmjit::x86::r12b;
-            } else if ( node->id == R13B) {
-                return asmjit::x86::r13b;
-            } else if ( node->id == R14B) {
-                return asmjit::x86::r14b;
-            } else if ( node->id == R15B) {
-                return asmjit::x86::r15b;
-            }
+        /* registers in the order of the register name enums */
+        static const asmjit::x86::Gp regs64[] = {
+            asmjit::x86::rax, asmjit::x86::rcx, asmjit::x86::rdx, asmjit::x86::rbx,
+            asmjit::x86::rsp, asmjit::x86::rbp, asmjit::x86::rsi, asmjit::x86::rdi,
+            asmjit::x86::r8,  asmjit::x86::r9,  asmjit::x86::r10, asmjit::x86::r11,
+            asmjit::x86::r12, asmjit::x86::r13, asmjit::x86::r14, asmjit::x86::r15
+        };
+        static const asmjit::x86::Gp regs32[] = {
+            asmjit::x86::eax,  asmjit::x86::ecx,  asmjit::x86::edx,  asmjit::x86::ebx,
+            asmjit::x86::esp,  asmjit::x86::ebp,  asmjit::x86::esi,  asmjit::x86::edi,
+            asmjit::x86::r8d,  asmjit::x86::r9d,  asmjit::x86::r10d, asmjit::x86::r11d,
+            asmjit::x86::r12d, asmjit::x86::r13d, asmjit::x86::r14d, asmjit::x86::r15d
+        };
+        static const asmjit::x86::Gp regs8[] = {
+            asmjit::x86::al,   asmjit::x86::cl,   asmjit::x86::dl,   asmjit::x86::bl,
+            asmjit::x86::spl,  asmjit::x86::bpl,  asmjit::x86::sil,  asmjit::x86::dil,
+            asmjit::x86::r8b,  asmjit::x86::r9b,  asmjit::x86::r10b, asmjit::x86::r11b,
+            asmjit::x86::r12b, asmjit::x86::r13b, asmjit::x86::r14b, asmjit::x86::r15b
+        };
+        assert(node->id >= 0 && node->id < 16 && "Unknown REG");
+        switch ( node->nodeType ) {
+            case REG64:
+                return regs64[node->id];
+            case REG32:
+                return regs32[node->id];
+            case REG8:
+                return regs8[node->id];
         }
         assert(false && "Unknown REG");
         return asmjit::x86::rax; //todo: error
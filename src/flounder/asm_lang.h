@@ -68,7 +68,8 @@ enum NodeTypes {
     CONSTANT_INT8     = 58,
     CONSTANT_DOUBLE   = 59,
     MOVSXD            = 60,
-    CRC32             = 61
+    CRC32             = 61,
+    TZCNT             = 62
 };
 
 
@@ -110,6 +111,13 @@ static bool checkInstrReadAsm ( ir_node* instr, int p ) {
         case INC:
             if ( p == 0 ) return true;
             break;
+        case DEC:
+            if ( p == 0 ) return true;
+            break;
+        case XOR:
+            if ( p == 0 ) return true;
+            if ( p == 1 ) return true;
+            break;
         case AND:
             if ( p == 0 ) return true;
             if ( p == 1 ) return true;
@@ -121,6 +129,9 @@ static bool checkInstrReadAsm ( ir_node* instr, int p ) {
             if ( p == 0 ) return true;
             if ( p == 1 ) return true;
             break;
+        case TZCNT:
+            if ( p == 1 ) return true;
+            break;
         case MEM_AT:
             if ( p == 0)  return true;
             break;
@@ -158,6 +169,15 @@ static bool checkInstrWriteAsm ( ir_node* instr, int p ) {
         case INC:
             if ( p == 0 ) return true;
             break;
+        case DEC:
+            if ( p == 0 ) return true;
+            break;
+        case LEA:
+            if ( p == 0 ) return true;
+            break;
+        case XOR:
+            if ( p == 0 ) return true;
+            break;
         case AND:
             if ( p == 0 ) return true;
             break;
@@ -167,6 +187,24 @@ static bool checkInstrWriteAsm ( ir_node* instr, int p ) {
         case CRC32:
             if ( p == 0 ) return true;
             break;
+        case TZCNT:
+            if ( p == 0 ) return true;
+            break;
+    }
+    return false;
+}
+
+
+static bool isJump ( ir_node* instr ) {
+    switch ( instr->nodeType ) {
+        case JMP:
+        case JE:
+        case JNE:
+        case JL:
+        case JLE:
+        case JG:
+        case JGE:
+            return true;
     }
     return false;
 }
@@ -275,8 +313,8 @@ static ir_node* reg32 ( int id ) {
 enum MachineRegName8 {
     AL   = 0,
     CL   = 1,
-    BL   = 2,
-    DL   = 3,
+    DL   = 2,
+    BL   = 3,
     SPL  = 4,
     BPL  = 5,
     SIL  = 6,
@@ -294,8 +332,8 @@ enum MachineRegName8 {
 static char* regNames8[] = { 
     "al", 
     "cl", 
-    "bl", 
     "dl", 
+    "bl", 
     "spl", 
     "bpl", 
     "sil", 
@@ -384,14 +422,13 @@ static bool isReg ( ir_node* node ) {
 }
 
 
-unsigned int labelId = 0;
-
-
 static ir_node* idLabel ( char* ident ) {
     char* label;
-    asprintf ( &label, "%s%i", ident, labelId );
-    labelId++;
-    return literal ( label, ID_LABEL ); 
+    asprintf ( &label, "%s%i", ident, getArena()->labelId );
+    getArena()->labelId++;
+    ir_node* res = literal ( label, ID_LABEL );
+    free ( label );
+    return res;
 }
 
 static ir_node* label ( char* ident ) {
@@ -518,13 +555,17 @@ static ir_node* cqo () {
 static ir_node* commentLine ( char* msg ) {
     char* ln;
     asprintf ( &ln, ";%s\n", msg );
-    return literal ( ln, COMMENT_LINE );
+    ir_node* res = literal ( ln, COMMENT_LINE );
+    free ( ln );
+    return res;
 }
 
 static ir_node* commentLine ( const char* msg ) {
     char* ln;
     asprintf ( &ln, ";%s\n", msg );
-    return literal ( ln, COMMENT_LINE );
+    ir_node* res = literal ( ln, COMMENT_LINE );
+    free ( ln );
+    return res;
 }
 
 static ir_node* func ( char* name ) {
@@ -654,6 +695,10 @@ static ir_node* crc32 ( ir_node* op1, ir_node* op2 ) {
     return binaryInstr ( "crc32", op1, op2, CRC32 );
 }
 
+static ir_node* tzcnt ( ir_node* op1, ir_node* op2 ) {
+    return binaryInstr ( "tzcnt", op1, op2, TZCNT );
+}
+
 static ir_node* memAt ( ir_node* child ) {
     return bracketingNode ( "[", "]", child, MEM_AT ); 
 }
@@ -699,17 +744,23 @@ static ir_node* memSub ( ir_node* op1, ir_node* op2 ) {
 }
 
 
+/* the section keeps the interned label identifier for the emitter */
 static ir_node* placeLabel ( ir_node* label ) {
     char* strVal;
     asprintf ( &strVal, "%s:\n", label->ident );
-    return literal ( strVal, SECTION ); 
+    ir_node* res = literal ( strVal, SECTION ); 
+    res->ident2 = label->ident;
+    free ( strVal );
+    return res;
 }
 
 
 static ir_node* section ( char* secName ) {
     char* strVal;
     asprintf ( &strVal, "section %s\n", secName );
-    return literal ( strVal, SECTION ); 
+    ir_node* res = literal ( strVal, SECTION ); 
+    free ( strVal );
+    return res;
 }
 
 
@@ -88,9 +88,6 @@ static BinaryComparator isNotEqual ( ir_node* a, ir_node* b ) {
 }
 
 
-static int loopId = 0;
-
-
 typedef struct WhileLoop {
     int id; 
     ir_node* root;
@@ -102,11 +99,11 @@ typedef struct WhileLoop {
 static WhileLoop While ( BinaryComparator condition, ir_node* root ) {
     char* strHead;
     char* strFoot;
-    asprintf ( &strHead, "loop_head%i", loopId );
-    asprintf ( &strFoot, "loop_foot%i", loopId );
+    asprintf ( &strHead, "loop_head%i", getArena()->loopId );
+    asprintf ( &strFoot, "loop_foot%i", getArena()->loopId );
 
     WhileLoop loop = (WhileLoop) { 
-        loopId++, 
+        getArena()->loopId++, 
         root, 
         label ( strHead ), 
         label ( strFoot ) 
@@ -131,11 +128,11 @@ static void closeWhile ( WhileLoop loop ) {
 static WhileLoop WhileTrue ( ir_node* root ) {
     char* strHead;
     char* strFoot;
-    asprintf ( &strHead, "loop_head%i", loopId );
-    asprintf ( &strFoot, "loop_foot%i", loopId );
+    asprintf ( &strHead, "loop_head%i", getArena()->loopId );
+    asprintf ( &strFoot, "loop_foot%i", getArena()->loopId );
 
     WhileLoop loop = (WhileLoop) { 
-        loopId++, 
+        getArena()->loopId++, 
         root, 
         label ( strHead ), 
         label ( strFoot ) 
@@ -158,9 +155,6 @@ static void continueWhile ( WhileLoop loop, BinaryComparator condition ) {
 }
 
 
-static int ifId = 0;
-
-
 typedef struct IfClause {
     int id; 
     ir_node* root;
@@ -170,10 +164,10 @@ typedef struct IfClause {
 
 static IfClause If ( BinaryComparator condition, ir_node* root ) {
     char* strFoot;
-    asprintf ( &strFoot, "if_foot%i", ifId );
+    asprintf ( &strFoot, "if_foot%i", getArena()->ifId );
 
     IfClause ifclause = (IfClause) { 
-        ifId++, 
+        getArena()->ifId++, 
         root, 
         label ( strFoot ) 
     };
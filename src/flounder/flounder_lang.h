@@ -52,7 +52,6 @@ static bool checkInstrWrite ( ir_node* instr, int p ) {
 
 
 /* ------------------ VIRTUAL REGISTERS ----------------------  */
-static int vRegNum = 0;
 
 
 static bool isVregNodeType ( ExtendedNodeTypes type ) {
@@ -90,10 +89,11 @@ static uint8_t getVregByteSize ( ir_node* vregNd ) {
 
 static ir_node* vreg ( const char* name, ExtendedNodeTypes type ) {
     char* s;
-    int id = vRegNum++;
+    int id = getArena()->vRegNum++;
     //asprintf ( &s, "%s%i(%i)", name, getVregNodeTypeBits ( type ), id );
     asprintf ( &s, "{%s(%i)}", name, id );
     ir_node* res = literal ( s, type );
+    free ( s );
     res->id = id;
     return res;
 }
@@ -144,6 +144,7 @@ static ir_node* openLoop ( int loopId ) {
     char* strVal;
     asprintf ( &strVal, "openLoop%i\n", loopId );
     ir_node* res = literal ( strVal, OPEN_LOOP );
+    free ( strVal );
     res->id = loopId;
     return res;
 }
@@ -153,6 +154,7 @@ static ir_node* closeLoop ( int loopId ) {
     char* strVal;
     asprintf ( &strVal, "closeLoop%i\n", loopId );
     ir_node* res = literal ( strVal, CLOSE_LOOP );
+    free ( strVal );
     res->id = loopId;
     return res;
 }
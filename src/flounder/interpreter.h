@@ -0,0 +1,516 @@
+/**
+ * @file
+ * Interpreter for Flounder IR with virtual registers.
+ * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
+ */
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <unordered_map>
+#include <immintrin.h>
+
+#include "flounder.h"
+
+
+/* Operand of an interpreted instruction */
+struct InterpretedOperand {
+
+    enum Kind : uint8_t {
+        NONE,
+        REGISTER,
+        IMMEDIATE,
+        MEMORY
+    };
+
+    Kind     kind = NONE;
+
+    /* access width in bytes (0: not known yet) */
+    uint8_t  width = 0;
+
+    /* register or base register of a memory operand (-1: no base) */
+    int32_t  reg = -1;
+
+    /* immediate value or displacement of a memory operand */
+    int64_t  value = 0;
+};
+
+
+struct InterpretedInstruction {
+    int                 nodeType;
+    InterpretedOperand  op1;
+    InterpretedOperand  op2;
+
+    /* instruction index of jump targets */
+    int                 target = -1;
+
+    /* function and arguments of managed calls */
+    void*               function = nullptr;
+    int                 firstArgument = 0;
+    int                 numArguments = 0;
+};
+
+
+/* Flounder IR decoded into instructions with resolved operands. The   *
+ * register file holds the virtual registers followed by the machine  *
+ * registers that the IR uses explicitly, e.g. for division.          */
+struct InterpretedCode {
+    std::vector < InterpretedInstruction >  instructions;
+    std::vector < InterpretedOperand >      arguments;
+    int                                     numRegisters = 0;
+};
+
+
+/* Number of arguments that managed calls pass in registers */
+const int MaxInterpretedCallArguments = 6;
+
+
+struct FlounderDecoder {
+
+    InterpretedCode&  code;
+    int               numVregs;
+
+    /* labels and jumps that refer to them by interned identifier */
+    std::unordered_map < const char*, int >         labels;
+    std::vector < std::pair < int, const char* > >  jumps;
+
+    /* the last instruction was a comparison that set the flags */
+    bool flagsSet = false;
+
+
+    FlounderDecoder ( InterpretedCode& code, int numVregs )
+        : code ( code ), numVregs ( numVregs ) {
+        code.numRegisters = numVregs + numMregs;
+    }
+
+
+    static bool constantValue ( ir_node* node, int64_t& value ) {
+        switch ( node->nodeType ) {
+            case CONSTANT_INT64:   value = node->int64Data;             return true;
+            case CONSTANT_INT32:   value = node->int32Data;             return true;
+            case CONSTANT_INT8:    value = node->int8Data;              return true;
+            case CONSTANT_ADDRESS: value = (int64_t) node->addressData; return true;
+            case CONSTANT_DOUBLE:  value = (int64_t) node->doubleData;  return true;
+        }
+        return false;
+    }
+
+
+    bool registerOperand ( ir_node* node, InterpretedOperand& op ) {
+        op.kind = InterpretedOperand::REGISTER;
+        if ( isVreg ( node ) ) {
+            op.reg = node->id;
+            op.width = getVregByteSize ( node );
+            return true;
+        }
+        if ( isReg ( node ) ) {
+            op.reg = numVregs + node->id;
+            op.width = regByteSize ( node );
+            return true;
+        }
+        return false;
+    }
+
+
+    bool immediateOperand ( ir_node* node, InterpretedOperand& op ) {
+        if ( node->nodeType == CONST_LOAD ) {
+            node = node->firstChild;
+        }
+        if ( !isConst ( node ) ) return false;
+        op.kind = InterpretedOperand::IMMEDIATE;
+        op.width = constByteSize ( node );
+        return constantValue ( node, op.value );
+    }
+
+
+    /* Addresses are a base register, a constant, or a base register *
+     * with a constant displacement.                                 */
+    bool addressOperand ( ir_node* node, InterpretedOperand& op ) {
+        InterpretedOperand base;
+        if ( registerOperand ( node, base ) ) {
+            op.reg = base.reg;
+            return true;
+        }
+        if ( immediateOperand ( node, base ) ) {
+            op.value = base.value;
+            return true;
+        }
+        if ( node->nodeType == MEM_ADD || node->nodeType == MEM_SUB ) {
+            InterpretedOperand displacement;
+            if ( !addressOperand ( node->firstChild, op ) ) return false;
+            if ( !immediateOperand ( node->lastChild, displacement ) ) return false;
+            op.value += ( node->nodeType == MEM_ADD ) ? displacement.value : -displacement.value;
+            return true;
+        }
+        return false;
+    }
+
+
+    bool operand ( ir_node* node, InterpretedOperand& op ) {
+        if ( node->nodeType == MEM_AT ) {
+            op.kind = InterpretedOperand::MEMORY;
+            op.width = ( strncmp ( node->ident, "byte", 4 ) == 0 ) ? 1 : 0;
+            return addressOperand ( node->firstChild, op );
+        }
+        return registerOperand ( node, op ) || immediateOperand ( node, op );
+    }
+
+
+    /* Memory operands take the width of the register operand */
+    static bool resolveWidths ( InterpretedOperand& op1, InterpretedOperand& op2 ) {
+        if ( op1.kind == InterpretedOperand::MEMORY && op1.width == 0 ) {
+            if ( op2.kind != InterpretedOperand::REGISTER ) return false;
+            op1.width = op2.width;
+        }
+        if ( op2.kind == InterpretedOperand::MEMORY && op2.width == 0 ) {
+            if ( op1.kind != InterpretedOperand::REGISTER ) return false;
+            op2.width = op1.width;
+        }
+        return true;
+    }
+
+
+    bool decodeCall ( ir_node* line, InterpretedInstruction& instr ) {
+        ir_node* retVal = line->firstChild;
+        if ( retVal == nullptr || retVal->next == nullptr ) return false;
+        int64_t address;
+        if ( !registerOperand ( retVal, instr.op1 ) ) return false;
+        if ( !constantValue ( retVal->next, address ) ) return false;
+        instr.function = (void*) address;
+        instr.firstArgument = code.arguments.size();
+        for ( ir_node* param = retVal->next->next; param != nullptr; param = param->next ) {
+            InterpretedOperand op;
+            if ( !operand ( param, op ) ) return false;
+            if ( op.kind == InterpretedOperand::MEMORY && op.width == 0 ) op.width = 8;
+            code.arguments.push_back ( op );
+            instr.numArguments++;
+        }
+        return instr.numArguments <= MaxInterpretedCallArguments;
+    }
+
+
+    bool decodeLine ( ir_node* line ) {
+        InterpretedInstruction instr;
+        instr.nodeType = line->nodeType;
+        bool readsFlags = false;
+
+        switch ( line->nodeType ) {
+
+            case REQ_VREG:
+            case CLEAR_VREG:
+            case OPEN_LOOP:
+            case CLOSE_LOOP:
+            case COMMENT_LINE:
+                return true;
+
+            case SECTION:
+                if ( line->ident2 == nullptr ) return false;
+                labels [ line->ident2 ] = code.instructions.size();
+                flagsSet = false;
+                return true;
+
+            case JE:
+            case JNE:
+            case JL:
+            case JLE:
+            case JG:
+            case JGE:
+                readsFlags = true;
+                [[fallthrough]];
+            case JMP:
+                if ( readsFlags && !flagsSet ) return false;
+                jumps.push_back ( { (int) code.instructions.size(), line->firstChild->ident } );
+                break;
+
+            case RET:
+            case CQO:
+            case CDQE:
+                break;
+
+            case INC:
+            case DEC:
+            case IDIV:
+                if ( !registerOperand ( line->firstChild, instr.op1 ) ) return false;
+                if ( line->nodeType == IDIV && instr.op1.width != 8 ) return false;
+                break;
+
+            case MOV:
+            case MOVZX:
+            case MOVSX:
+            case MOVSXD:
+            case CMP:
+            case ADD:
+            case SUB:
+            case IMUL:
+            case AND:
+            case OR:
+            case XOR:
+            case CRC32:
+            case TZCNT:
+                if ( line->nChildren != 2 ) return false;
+                if ( !operand ( line->firstChild, instr.op1 ) ) return false;
+                if ( !operand ( line->lastChild, instr.op2 ) ) return false;
+                if ( instr.op1.kind == InterpretedOperand::IMMEDIATE ) return false;
+                if ( line->nodeType == MOVSXD && instr.op2.width == 0 ) instr.op2.width = 4;
+                if ( !resolveWidths ( instr.op1, instr.op2 ) ) return false;
+                break;
+
+            case MANAGED_CALL:
+                if ( !decodeCall ( line, instr ) ) return false;
+                break;
+
+            default:
+                return false;
+        }
+        if ( !isJump ( line ) ) {
+            flagsSet = ( line->nodeType == CMP );
+        }
+        code.instructions.push_back ( instr );
+        return true;
+    }
+
+
+    bool decode ( ir_node* codeTree ) {
+        for ( ir_node* line = codeTree->firstChild; line != nullptr; line = line->next ) {
+            if ( !decodeLine ( line ) ) return false;
+        }
+        for ( auto& jump : jumps ) {
+            auto label = labels.find ( jump.second );
+            if ( label == labels.end() ) return false;
+            code.instructions [ jump.first ].target = label->second;
+        }
+        return !code.instructions.empty() && code.instructions.back().nodeType == RET;
+    }
+};
+
+
+/* Decodes finished Flounder IR for the interpreter. Returns false *
+ * when the IR contains instructions the interpreter does not      *
+ * support, e.g. system calls or simd instructions.                */
+static bool decodeFlounder ( ir_node*          codeTree,
+                             int               numVregs,
+                             InterpretedCode&  code ) {
+    FlounderDecoder decoder ( code, numVregs );
+    if ( !decoder.decode ( codeTree ) ) {
+        code.instructions.clear();
+        code.arguments.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/* Executes decoded Flounder IR with a register file per thread. Registers *
+ * follow x86 semantics: 32 bit writes clear the upper half and 8 bit      *
+ * writes keep the upper bits. Comparisons are signed as in the IR jumps.  */
+struct FlounderInterpreter {
+
+    const InterpretedCode&  code;
+    std::vector < int64_t > regs;
+
+    /* operands of the last comparison */
+    int64_t flagA = 0;
+    int64_t flagB = 0;
+
+
+    FlounderInterpreter ( const InterpretedCode& code )
+        : code ( code ), regs ( code.numRegisters, 0 ) {}
+
+
+    static int64_t signExtend ( uint64_t value, int width ) {
+        switch ( width ) {
+            case 1:  return (int8_t)  value;
+            case 4:  return (int32_t) value;
+            default: return (int64_t) value;
+        }
+    }
+
+
+    static uint64_t zeroExtend ( uint64_t value, int width ) {
+        switch ( width ) {
+            case 1:  return (uint8_t)  value;
+            case 4:  return (uint32_t) value;
+            default: return value;
+        }
+    }
+
+
+    void* address ( const InterpretedOperand& op ) {
+        int64_t base = ( op.reg >= 0 ) ? regs [ op.reg ] : 0;
+        return (void*) ( base + op.value );
+    }
+
+
+    /* Reads an operand zero-extended to 64 bit, immediates are sign-extended */
+    uint64_t read ( const InterpretedOperand& op ) {
+        switch ( op.kind ) {
+            case InterpretedOperand::REGISTER:
+                return zeroExtend ( regs [ op.reg ], op.width );
+            case InterpretedOperand::IMMEDIATE:
+                return op.value;
+            case InterpretedOperand::MEMORY: {
+                uint64_t value = 0;
+                memcpy ( &value, address ( op ), op.width );
+                return value;
+            }
+            default:
+                return 0;
+        }
+    }
+
+
+    void write ( const InterpretedOperand& op, uint64_t value ) {
+        if ( op.kind == InterpretedOperand::MEMORY ) {
+            memcpy ( address ( op ), &value, op.width );
+            return;
+        }
+        int64_t& reg = regs [ op.reg ];
+        switch ( op.width ) {
+            case 1:  reg = ( reg & ~0xFFLL ) | ( value & 0xFF ); break;
+            case 4:  reg = (uint32_t) value;                     break;
+            default: reg = value;
+        }
+    }
+
+
+    int64_t& machineRegister ( int id ) {
+        return regs [ code.numRegisters - numMregs + id ];
+    }
+
+
+    uint64_t call ( const InterpretedInstruction& instr ) {
+        int64_t args [ MaxInterpretedCallArguments ] = { 0 };
+        for ( int i=0; i<instr.numArguments; i++ ) {
+            const InterpretedOperand& op = code.arguments [ instr.firstArgument + i ];
+            args[i] = ( op.kind == InterpretedOperand::REGISTER ) ? signExtend ( read ( op ), op.width ) : read ( op );
+        }
+        auto f = (int64_t (*) ( int64_t, int64_t, int64_t, int64_t, int64_t, int64_t )) instr.function;
+        return f ( args[0], args[1], args[2], args[3], args[4], args[5] );
+    }
+
+
+    static uint64_t crc32 ( uint64_t crc, uint64_t value, int width ) {
+        switch ( width ) {
+            case 1:  return _mm_crc32_u8  ( (uint32_t) crc, (uint8_t) value );
+            case 4:  return _mm_crc32_u32 ( (uint32_t) crc, (uint32_t) value );
+            default: return _mm_crc32_u64 ( (uint32_t) crc, value );
+        }
+    }
+
+
+    void run () {
+        const InterpretedInstruction* instructions = code.instructions.data();
+        size_t pc = 0;
+        while ( true ) {
+            const InterpretedInstruction& instr = instructions [ pc++ ];
+            const InterpretedOperand& op1 = instr.op1;
+            const InterpretedOperand& op2 = instr.op2;
+
+            switch ( instr.nodeType ) {
+                case MOV:
+                    write ( op1, read ( op2 ) );
+                    break;
+                case MOVZX:
+                    write ( op1, zeroExtend ( read ( op2 ), op2.width ) );
+                    break;
+                case MOVSX:
+                case MOVSXD:
+                    write ( op1, signExtend ( read ( op2 ), op2.width ) );
+                    break;
+                case ADD:
+                    write ( op1, read ( op1 ) + read ( op2 ) );
+                    break;
+                case SUB:
+                    write ( op1, read ( op1 ) - read ( op2 ) );
+                    break;
+                case IMUL:
+                    write ( op1, read ( op1 ) * read ( op2 ) );
+                    break;
+                case AND:
+                    write ( op1, read ( op1 ) & read ( op2 ) );
+                    break;
+                case OR:
+                    write ( op1, read ( op1 ) | read ( op2 ) );
+                    break;
+                case XOR:
+                    write ( op1, read ( op1 ) ^ read ( op2 ) );
+                    break;
+                case INC:
+                    write ( op1, read ( op1 ) + 1 );
+                    break;
+                case DEC:
+                    write ( op1, read ( op1 ) - 1 );
+                    break;
+                case CRC32:
+                    write ( op1, crc32 ( read ( op1 ), read ( op2 ), op2.width ) );
+                    break;
+                case TZCNT: {
+                    uint64_t value = read ( op2 );
+                    write ( op1, value == 0 ? op2.width * 8 : __builtin_ctzll ( value ) );
+                    break;
+                }
+                case CQO:
+                    machineRegister ( RDX ) = ( machineRegister ( RAX ) < 0 ) ? -1 : 0;
+                    break;
+                case CDQE:
+                    machineRegister ( RAX ) = (int32_t) machineRegister ( RAX );
+                    break;
+                case IDIV: {
+                    __int128 dividend = ( (__int128) machineRegister ( RDX ) << 64 )
+                                      | (uint64_t) machineRegister ( RAX );
+                    int64_t divisor = read ( op1 );
+                    machineRegister ( RAX ) = (int64_t) ( dividend / divisor );
+                    machineRegister ( RDX ) = (int64_t) ( dividend % divisor );
+                    break;
+                }
+                case CMP:
+                    flagA = signExtend ( read ( op1 ), op1.width );
+                    flagB = signExtend ( read ( op2 ), op1.width );
+                    break;
+                case JMP:
+                    pc = instr.target;
+                    break;
+                case JE:
+                    if ( flagA == flagB ) pc = instr.target;
+                    break;
+                case JNE:
+                    if ( flagA != flagB ) pc = instr.target;
+                    break;
+                case JL:
+                    if ( flagA < flagB ) pc = instr.target;
+                    break;
+                case JLE:
+                    if ( flagA <= flagB ) pc = instr.target;
+                    break;
+                case JG:
+                    if ( flagA > flagB ) pc = instr.target;
+                    break;
+                case JGE:
+                    if ( flagA >= flagB ) pc = instr.target;
+                    break;
+                case MANAGED_CALL:
+                    write ( op1, call ( instr ) );
+                    break;
+                case RET:
+                    return;
+            }
+        }
+    }
+};
+
+
+/* Interprets the code with the same number of threads as machine code */
+static void interpretFlounder ( const InterpretedCode& code, size_t numThreads ) {
+    auto threads = std::vector < std::thread > {};
+    threads.resize ( numThreads );
+    for ( auto& thread : threads ) {
+        thread = std::thread ( [&code] () {
+            FlounderInterpreter interpreter ( code );
+            interpreter.run();
+        } );
+    }
+    for ( auto& thread : threads ) {
+        thread.join();
+    }
+}
@@ -6,9 +6,17 @@
 #pragma once
 
 #include <cstring>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
 #include "util/assertion.h"
 
 
+/* number of nodes and identifier characters per arena block */
+#define IR_NODE_BLOCK_SIZE  16384
+#define IR_CHAR_BLOCK_SIZE  65536
+
+
 enum BaseNodeTypes {
     UNDEFINED         =  0,
     ROOT              =  1
@@ -58,24 +66,74 @@ typedef struct ir_node {
 } ir_node;
 
 
-/* global allocation of nodes */
-static ir_node* allNodes = NULL;
-static int nextNodeIdx = 0;
-static int numAllocated = 1000000;
+/* Arena with the nodes and identifiers of one IR program. Nodes and *
+ * identifiers are allocated from blocks that are never moved, so     *
+ * the program size is not limited. The arena also holds the counters *
+ * for unique names and ids of the program.                           */
+typedef struct ir_arena {
+
+    /* node blocks with next free node in the last block */
+    std::vector < ir_node* > nodeBlocks;
+    int nextNodeIdx = IR_NODE_BLOCK_SIZE;
+
+    /* character blocks for identifiers */
+    std::vector < char* > charBlocks;
+    size_t nextCharIdx = IR_CHAR_BLOCK_SIZE;
+
+    /* interned identifiers, each distinct identifier is stored once */
+    std::unordered_map < std::string_view, char* > identifiers;
+
+    /* counters for virtual registers, labels, loops and ifs */
+    int vRegNum = 0;
+    int labelId = 0;
+    int loopId = 0;
+    int ifId = 0;
 
+} ir_arena;
+
+
+/* Arena that IR is built in by the current thread. Each thread can *
+ * build a separate program, e.g. to compile queries in parallel.  */
+static thread_local ir_arena* activeArena = NULL;
+
+
+static ir_arena* createArena () {
+    return new ir_arena();
+}
 
-static void allocateAllNodes () {
-    allNodes = (ir_node*) malloc ( sizeof ( ir_node ) * numAllocated );
-    for ( int i=0; i<nextNodeIdx; i++ ) {
-        allNodes[i].ident = nullptr;
-        allNodes[i].ident2 = nullptr;
+
+static void freeArena ( ir_arena* arena ) {
+    for ( ir_node* block : arena->nodeBlocks ) {
+        free ( block );
+    }
+    for ( char* block : arena->charBlocks ) {
+        free ( block );
     }
+    delete arena;
+}
+
+
+/* Sets the arena for building IR in the current thread and returns the previous one */
+static ir_arena* activateArena ( ir_arena* arena ) {
+    ir_arena* previous = activeArena;
+    activeArena = arena;
+    return previous;
+}
+
+
+static ir_arena* getArena () {
+    M_Assert ( activeArena != NULL, "No active IR arena." );
+    return activeArena;
 }
 
 
 static ir_node* getNode () {
-    M_Assert ( nextNodeIdx < numAllocated, "More nodes than allocated." );
-    ir_node* node = &allNodes[nextNodeIdx++];
+    ir_arena* arena = getArena();
+    if ( arena->nextNodeIdx == IR_NODE_BLOCK_SIZE ) {
+        arena->nodeBlocks.push_back ( (ir_node*) malloc ( sizeof ( ir_node ) * IR_NODE_BLOCK_SIZE ) );
+        arena->nextNodeIdx = 0;
+    }
+    ir_node* node = &arena->nodeBlocks.back()[arena->nextNodeIdx++];
     node->ident = NULL;
     node->ident2 = NULL;
     node->emit_fun = NULL;
@@ -91,23 +149,57 @@ static ir_node* getNode () {
 }
 
 
+/* copies a string into the active arena */
+static char* arenaString ( const char* str ) {
+    ir_arena* arena = getArena();
+    size_t len = strlen ( str ) + 1;
+    if ( arena->nextCharIdx + len > IR_CHAR_BLOCK_SIZE ) {
+        size_t size = len > IR_CHAR_BLOCK_SIZE ? len : IR_CHAR_BLOCK_SIZE;
+        char* block = (char*) malloc ( size );
+        if ( len > IR_CHAR_BLOCK_SIZE ) {
+            /* dedicated block for long strings keeps the current block */
+            arena->charBlocks.insert ( arena->charBlocks.begin(), block );
+            memcpy ( block, str, len );
+            return block;
+        }
+        arena->charBlocks.push_back ( block );
+        arena->nextCharIdx = 0;
+    }
+    char* res = &arena->charBlocks.back()[arena->nextCharIdx];
+    memcpy ( res, str, len );
+    arena->nextCharIdx += len;
+    return res;
+}
+
+
+/* Returns the arena copy of an identifier. Equal identifiers *
+ * share one copy and can be compared by address.             */
+static char* internString ( const char* str ) {
+    ir_arena* arena = getArena();
+    auto it = arena->identifiers.find ( std::string_view ( str ) );
+    if ( it != arena->identifiers.end() ) {
+        return it->second;
+    }
+    char* res = arenaString ( str );
+    arena->identifiers.emplace ( std::string_view ( res ), res );
+    return res;
+}
+
+
 static void setIdent ( ir_node* n, char* id ) {
-    asprintf ( &(n->ident), "%s", id );
+    n->ident = internString ( id );
 }
 
 
 static void setIdent2 ( ir_node* n, char* id ) {
-    asprintf ( &(n->ident2), "%s", id );
+    n->ident2 = internString ( id );
 }
 
 
+/* identifiers are immutable in the arena and shared by copies */
 static ir_node* copyNode ( ir_node* n) {
     ir_node* res = getNode();
     memcpy ( res, n, sizeof ( ir_node ) );
-    if ( n->ident != NULL ) 
-        setIdent ( res, n->ident );
-    if ( n->ident2 != NULL ) 
-        setIdent2 ( res, n->ident2 );
     return res;
 }
 
@@ -122,26 +214,6 @@ static char* call_emit ( ir_node* node ) {
 }
 
 
-static void freeNode ( ir_node* n ) {
-    M_Assert ( n != NULL, "Node to free is NULL" );
-    if ( n == NULL ) return;
-    if ( n->ident != NULL ) {
-        free ( n->ident );
-    }
-    if ( n->ident2 != NULL ) {
-        free ( n->ident2 );
-    }
-}
-
-
-static void freeAllNodes () {
-    for ( int i=0; i<nextNodeIdx; i++ ) {
-        freeNode ( &allNodes[i] );
-    }
-    free ( allNodes );
-}
-
-
 static char* emitIrRoot ( ir_node* node ) {
     char* res = "";
     ir_node* chd = node->firstChild;
@@ -187,9 +259,9 @@ static ir_node* insertBeforeChild ( ir_node* baseNode, ir_node* child, ir_node*
     else {
         child->prev->next = insert;
     }
+    insert->prev = child->prev;
     insert->next = child;
     child->prev  = insert;
-    insert->prev = child->prev;
     baseNode->nChildren++;
     return insert;
 }
@@ -198,7 +270,9 @@ static ir_node* insertBeforeChild ( ir_node* baseNode, ir_node* child, ir_node*
 
 static ir_node* insertAfterChild ( ir_node* baseNode, ir_node* child, ir_node* insert ) {
     insert->next = child->next;
-    insert->next->prev = insert;
+    if ( insert->next != NULL ) {
+        insert->next->prev = insert;
+    }
     insert->prev = child;
     child->next  = insert;
     if ( baseNode->lastChild == child ) {
@@ -12,6 +12,8 @@
 #include "translate_call.h"    
 #include "translate_optimize.h"    
 #include "translate_analyze.h"    
+#include "translate_split.h"
+#include "util/Timer.h"
 
 
 int ceilToMultipleOf ( int val, int multipleOf ) {
@@ -48,9 +50,24 @@ void addCalleeSave ( ir_node* baseNode, RegisterAllocationState& state ) {
         
         
 
-static void translationPass ( ir_node* baseNode ) {
+/* Time of the translation phases in milliseconds and spill counts */
+struct TranslationStatistics {
+    double optimization = 0.0;
+    double registerAllocation = 0.0;
+    double callPlacement = 0.0;
+    int    numSpilledVregs = 0;
+    int    numSpillAccesses = 0;
+};
 
-    RegisterAllocationState state ( vRegNum );
+
+static void translationPass ( ir_node* baseNode, TranslationStatistics* stats = nullptr ) {
+
+    Timer tPass = Timer();
+    double callPlacementTime = 0.0;
+    int spillAccessBefore = numSpillAccess;
+    RegisterAllocationState state ( getArena()->vRegNum );
+    AllocationPlan plan;
+    buildAllocationPlan ( plan, baseNode, getArena()->vRegNum );
     int lineNum=0;
     ir_node* line = baseNode->firstChild;
     while ( line != NULL ) {
@@ -58,12 +75,25 @@ static void translationPass ( ir_node* baseNode ) {
         // save next instruction to allow deletion and to skip inserts
         ir_node* next = line->next;
 
+        // keep split intervals in registers during loops
+        if ( line->nodeType == OPEN_LOOP ) {
+            openLoopSplits ( baseNode, line, plan, state );
+        }
+        else if ( line->nodeType == CLOSE_LOOP ) {
+            closeLoopSplits ( baseNode, line, plan, state );
+        }
+        else if ( isJump ( line ) && !plan.activeSplitLoops.empty() ) {
+            storeSplitsBeforeExit ( baseNode, line, plan );
+        }
+
         // register allocation
-        handleRegisterAllocation ( baseNode, line, lineNum, state );
+        handleRegisterAllocation ( baseNode, line, lineNum, state, plan );
 
         // function calls 
         if ( isManagedCall ( line->nodeType ) ) {
+            Timer tCall = Timer();
             placeManagedCall ( baseNode, line, state );
+            callPlacementTime += tCall.get();
         }
 
         // remove loop marker-instructions
@@ -84,6 +114,13 @@ static void translationPass ( ir_node* baseNode ) {
     }
     
     addCalleeSave ( baseNode, state );
+
+    if ( stats != nullptr ) {
+        stats->callPlacement = callPlacementTime;
+        stats->registerAllocation = tPass.get() - callPlacementTime;
+        stats->numSpilledVregs = state.numSpilledVregs;
+        stats->numSpillAccesses = numSpillAccess - spillAccessBefore;
+    }
 } 
 
 
@@ -113,7 +150,8 @@ static void translateFlounderToMachineIR ( ir_node*       codeTree,
                                            std::ostream&  stream = std::cout,
                                            bool           optimizeFlounder=false,
                                            bool           printFlounderIr=false,
-                                           bool           printAssembly=false ) {
+                                           bool           printAssembly=false,
+                                           TranslationStatistics* stats=nullptr ) {
    
     if ( printFlounderIr ) {
         char* code;
@@ -123,8 +161,11 @@ static void translateFlounderToMachineIR ( ir_node*       codeTree,
         free ( code );
     }
     if ( optimizeFlounder ) {
-        stream << "optimizing..." << std::endl;
+        Timer tOptimize = Timer();
         optimize ( codeTree );
+        if ( stats != nullptr ) {
+            stats->optimization = tOptimize.get();
+        }
         if ( printFlounderIr ) {
             char* code;
             code = call_emit ( codeTree ); 
@@ -135,7 +176,7 @@ static void translateFlounderToMachineIR ( ir_node*       codeTree,
     }
 
     numSpillAccess = 0;
-    translationPass ( codeTree );
+    translationPass ( codeTree, stats );
 
     if ( printAssembly ) {
         char* code;
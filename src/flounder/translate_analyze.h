@@ -5,6 +5,11 @@
  */
 #pragma once
 
+#include <set>
+#include <map>
+#include <vector>
+#include <unordered_map>
+
 
 struct LineInfo {
     int       num;
@@ -49,6 +54,13 @@ struct CodeAnalysis {
     std::map < int, LineInfo > vregRequests;
     std::map < int, LineInfo > vregClears;
     
+    // number of request and clear markers of each vreg
+    std::map < int, int > vregRequestCount;
+    std::map < int, int > vregClearCount;
+
+    // vregs used as operands without known read/write semantics
+    std::set < int > vregOpaque;
+    
 
     // loop open markers ordered by line number
     //  map: line number -> loop open LineInfo
@@ -58,6 +70,13 @@ struct CodeAnalysis {
     //  map: loop id -> loop close LineInfo
     std::map < int, LineInfo > loopCloseMarkers;
 
+    // line ranges that may execute repeatedly, i.e. loops
+    // and the ranges between backward jumps and their labels
+    std::vector < std::pair < int, int > > loopRanges;
+
+    // line numbers of placed labels by interned identifier
+    std::unordered_map < const char*, int > labelLines;
+
 
     // analyze memory access 
     // - key (int): virtual register used as base address for multiple reads/writes
@@ -131,11 +150,13 @@ static void recordMarkers ( ir_node*       node,
     if ( node->nodeType == REQ_VREG ) {
         int vregId = node->firstChild->id; 
         analysis.vregRequests [ vregId ] = info; 
+        analysis.vregRequestCount [ vregId ]++; 
     }    
 
     else if ( node->nodeType == CLEAR_VREG ) {
         int vregId = node->firstChild->id; 
         analysis.vregClears [ vregId ] = info; 
+        analysis.vregClearCount [ vregId ]++; 
     }
 
     else if ( node->nodeType == OPEN_LOOP ) {
@@ -146,6 +167,16 @@ static void recordMarkers ( ir_node*       node,
         analysis.loopCloseMarkers [ node->id ] = info;
     }
 
+    else if ( node->nodeType == SECTION && node->ident2 != NULL ) {
+        analysis.labelLines [ node->ident2 ] = lineNum;
+    }
+
+    else if ( isJump ( node ) ) {
+        auto label = analysis.labelLines.find ( node->firstChild->ident );
+        if ( label != analysis.labelLines.end() ) {
+            analysis.loopRanges.push_back ( { label->second, lineNum } );
+        }
+    }
 }
 
 
@@ -176,6 +207,14 @@ static void setReadWriteDescend ( ir_node*      instr,
 		    { { lineNum, instr }, child }
 	        );
             }
+
+            if ( !checkInstrRead ( node, i ) && 
+                 !checkInstrWrite ( node, i ) &&
+                 node->nodeType != REQ_VREG &&
+                 node->nodeType != CLEAR_VREG ) {
+                
+                analysis.vregOpaque.insert ( vid );
+            }
         }
 
         setReadWriteDescend ( instr, child, lineNum, analysis );
@@ -264,6 +303,13 @@ static CodeAnalysis analyzeCode ( ir_node*      baseNode,
         lineNum++;
     }
 
+    for ( auto& open : analysis.loopOpenMarkers ) {
+        auto close = analysis.loopCloseMarkers.find ( open.second.node->id );
+        if ( close != analysis.loopCloseMarkers.end() ) {
+            analysis.loopRanges.push_back ( { open.first, close->second.num } );
+        }
+    }
+
     // order by instruction number of first element in group
     for ( auto& it: analysis.memReads ) {
         analysis.orderedMemAccess [ it.second.front().line.num ] = it.second;
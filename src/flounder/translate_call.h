@@ -11,7 +11,7 @@
 #include "RegisterAllocationState.h"
 
 
-static int callParamRegisterOverwrites = 0;
+static thread_local int callParamRegisterOverwrites = 0;
 
 
 typedef struct StackSavedRegisters {
@@ -0,0 +1,355 @@
+/**
+ * @file
+ * Linear scan register allocation over live intervals of virtual registers.
+ * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
+ */
+#pragma once
+
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+#include "flounder.h"
+#include "x86_abi.h"
+
+
+/* weight of a use per loop nesting level */
+const double LoopUseWeight = 10.0;
+const int    MaxLoopWeightDepth = 6;
+
+
+/* Live range of a virtual register from its request to its clear */
+struct LiveInterval {
+
+    /* requested virtual register */
+    ir_node*  vreg;
+
+    /* line numbers of request and clear */
+    int       start;
+    int       end;
+
+    /* uses weighted by loop depth */
+    double    weight;
+
+    /* assigned machine register or -1 if the interval is spilled */
+    int       mreg;
+};
+
+
+/* Loop in the IR delimited by the loop markers */
+struct LoopRange {
+    int  id;
+    int  open;
+    int  close;
+
+    /* the loop can be entered by jumps from outside */
+    bool hasSideEntry;
+};
+
+
+/* A spilled interval that is kept in a register during a loop.  *
+ * The value is loaded before the loop and stored after the loop *
+ * and before jumps that leave the loop.                         */
+struct IntervalSplit {
+    int   interval;
+    int   mreg;
+    bool  written;
+
+    /* spill slot of the interval while the split is active */
+    int   spillSlot;
+};
+
+
+struct AllocationPlan {
+
+    std::vector < LiveInterval > intervals;
+
+    /* intervals of each vreg in order and the next one to allocate */
+    std::vector < std::vector < int > > vregIntervals;
+    std::vector < int > nextInterval;
+
+    /* splits that are placed at the markers of a loop */
+    std::map < int, std::vector < IntervalSplit > > loopSplits;
+
+    /* loops that enclose a label, identified by its interned identifier */
+    std::unordered_map < const char*, std::vector < int > > labelLoops;
+
+    /* loops with splits that enclose the current line */
+    std::vector < int > activeSplitLoops;
+};
+
+
+/* Conservatively treats the first operand as written except for comparisons */
+static bool isWrittenOperand ( ir_node* instr, int p ) {
+    return checkInstrWrite ( instr, p ) || ( p == 0 && instr->nodeType != CMP );
+}
+
+
+struct LiveIntervalAnalysis {
+
+    AllocationPlan&  plan;
+
+    std::vector < LoopRange >  loops;
+    std::vector < int >        loopStack;
+    std::vector < int >        openInterval;
+
+    /* weighted uses and written intervals per loop */
+    std::vector < std::unordered_map < int, double > >  loopUses;
+    std::vector < std::vector < int > >                 loopWrites;
+
+    /* jumps with the loops that enclose them */
+    std::vector < std::pair < const char*, std::vector < int > > > jumps;
+
+
+    LiveIntervalAnalysis ( AllocationPlan& plan, int numVregs )
+        : plan ( plan ), openInterval ( numVregs, -1 ) {}
+
+
+    void recordUse ( ir_node* vreg, bool written ) {
+        int iv = openInterval [ vreg->id ];
+        if ( iv < 0 ) return;
+        int depth = std::min ( (int) loopStack.size(), MaxLoopWeightDepth );
+        double weight = 1.0;
+        for ( int d=0; d<depth; d++ ) weight *= LoopUseWeight;
+        plan.intervals [ iv ].weight += weight;
+        for ( int l : loopStack ) {
+            loopUses [ l ] [ iv ] += weight;
+            if ( written ) loopWrites [ l ].push_back ( iv );
+        }
+    }
+
+
+    void recordUsesDescend ( ir_node* line, ir_node* node ) {
+        ir_node* child = node->firstChild;
+        int p = 0;
+        while ( child != NULL ) {
+            if ( isVreg ( child ) ) {
+                recordUse ( child, node == line && isWrittenOperand ( line, p ) );
+            }
+            recordUsesDescend ( line, child );
+            child = child->next;
+            p++;
+        }
+    }
+
+
+    void analyzeLine ( ir_node* line, int lineNum ) {
+        switch ( line->nodeType ) {
+            case OPEN_LOOP:
+                loopStack.push_back ( loops.size() );
+                loops.push_back ( { line->id, lineNum, -1, false } );
+                loopUses.emplace_back();
+                loopWrites.emplace_back();
+                break;
+            case CLOSE_LOOP:
+                M_Assert ( loopStack.size() > 0, "Loop closed without open marker." );
+                loops [ loopStack.back() ].close = lineNum;
+                loopStack.pop_back();
+                break;
+            case REQ_VREG: {
+                ir_node* vreg = line->firstChild;
+                int iv = plan.intervals.size();
+                plan.intervals.push_back ( { vreg, lineNum, -1, 0.0, -1 } );
+                plan.vregIntervals [ vreg->id ].push_back ( iv );
+                openInterval [ vreg->id ] = iv;
+                break;
+            }
+            case CLEAR_VREG: {
+                ir_node* vreg = line->firstChild;
+                if ( openInterval [ vreg->id ] >= 0 ) {
+                    plan.intervals [ openInterval [ vreg->id ] ].end = lineNum;
+                    openInterval [ vreg->id ] = -1;
+                }
+                break;
+            }
+            case SECTION:
+                if ( line->ident2 != NULL ) {
+                    plan.labelLoops [ line->ident2 ] = loopIds();
+                }
+                break;
+            default:
+                if ( isJump ( line ) ) {
+                    jumps.push_back ( { line->firstChild->ident, loopIds() } );
+                }
+                else {
+                    recordUsesDescend ( line, line );
+                }
+        }
+    }
+
+
+    std::vector < int > loopIds () {
+        std::vector < int > ids;
+        for ( int l : loopStack ) ids.push_back ( loops [ l ].id );
+        return ids;
+    }
+
+
+    /* Marks loops with labels that are targets of jumps from outside */
+    void findSideEntries () {
+        for ( auto& jump : jumps ) {
+            auto target = plan.labelLoops.find ( jump.first );
+            if ( target == plan.labelLoops.end() ) continue;
+            for ( int id : target->second ) {
+                if ( std::find ( jump.second.begin(), jump.second.end(), id ) == jump.second.end() ) {
+                    for ( auto& loop : loops ) {
+                        if ( loop.id == id ) loop.hasSideEntry = true;
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+/* Returns a free allocation register, callee-save registers first */
+static int getFreeAllocationMreg ( bool* inUse ) {
+    for ( int i=0; i<numMregs; i++ ) {
+        if ( !inUse[i] && allocationMregs[i] && !callerSaveMask[i] ) return i;
+    }
+    for ( int i=0; i<numMregs; i++ ) {
+        if ( !inUse[i] && allocationMregs[i] ) return i;
+    }
+    return -1;
+}
+
+
+/* Assigns registers to intervals in the order of their start. When all *
+ * registers are in use, the interval with the lowest weight is spilled. */
+static void linearScan ( AllocationPlan& plan ) {
+
+    bool inUse [ numMregs ] = { false };
+    std::vector < int > active;
+
+    for ( int iv=0; iv < (int) plan.intervals.size(); iv++ ) {
+        LiveInterval& cur = plan.intervals [ iv ];
+
+        // expire intervals that were cleared before
+        for ( auto it = active.begin(); it != active.end(); ) {
+            LiveInterval& a = plan.intervals [ *it ];
+            if ( a.end < cur.start ) {
+                inUse [ a.mreg ] = false;
+                it = active.erase ( it );
+            }
+            else {
+                ++it;
+            }
+        }
+
+        int mreg = getFreeAllocationMreg ( inUse );
+        if ( mreg >= 0 ) {
+            cur.mreg = mreg;
+            inUse [ mreg ] = true;
+            active.push_back ( iv );
+            continue;
+        }
+
+        // spill the active interval with the lowest weight or the current
+        auto victim = active.end();
+        double minWeight = cur.weight;
+        for ( auto it = active.begin(); it != active.end(); ++it ) {
+            LiveInterval& a = plan.intervals [ *it ];
+            if ( a.weight < minWeight || ( a.weight == minWeight && a.end > cur.end ) ) {
+                minWeight = a.weight;
+                victim = it;
+            }
+        }
+        if ( victim != active.end() ) {
+            LiveInterval& v = plan.intervals [ *victim ];
+            cur.mreg = v.mreg;
+            v.mreg = -1;
+            *victim = iv;
+        }
+    }
+}
+
+
+static bool overlaps ( int s1, int e1, int s2, int e2 ) {
+    return s1 <= e2 && s2 <= e1;
+}
+
+
+/* Keeps spilled intervals in free registers during the loops that use them */
+static void splitIntervals ( AllocationPlan&        plan,
+                             LiveIntervalAnalysis&  analysis ) {
+
+    // ranges in which the machine registers are occupied
+    std::vector < std::pair < int, int > > occupied [ numMregs ];
+    for ( auto& iv : plan.intervals ) {
+        if ( iv.mreg >= 0 ) occupied [ iv.mreg ].push_back ( { iv.start, iv.end } );
+    }
+
+    struct Candidate {
+        double  weight;
+        int     interval;
+        int     loop;
+    };
+
+    std::vector < Candidate > candidates;
+    for ( int l=0; l < (int) analysis.loops.size(); l++ ) {
+        LoopRange& loop = analysis.loops [ l ];
+        if ( loop.hasSideEntry || loop.close < 0 ) continue;
+        for ( auto& use : analysis.loopUses [ l ] ) {
+            LiveInterval& iv = plan.intervals [ use.first ];
+            if ( iv.mreg < 0 && iv.start < loop.open && loop.close < iv.end ) {
+                candidates.push_back ( { use.second, use.first, l } );
+            }
+        }
+    }
+    std::stable_sort ( candidates.begin(), candidates.end(),
+        [] ( const Candidate& a, const Candidate& b ) { return a.weight > b.weight; } );
+
+    std::map < int, std::vector < int > > splitLoops;
+    for ( auto& c : candidates ) {
+        LoopRange& loop = analysis.loops [ c.loop ];
+
+        // one split per interval and loop nest
+        bool nested = false;
+        for ( int l : splitLoops [ c.interval ] ) {
+            LoopRange& other = analysis.loops [ l ];
+            nested |= overlaps ( loop.open, loop.close, other.open, other.close );
+        }
+        if ( nested ) continue;
+
+        bool inUse [ numMregs ] = { false };
+        for ( int r=0; r<numMregs; r++ ) {
+            for ( auto& range : occupied [ r ] ) {
+                inUse [ r ] |= overlaps ( range.first, range.second, loop.open, loop.close );
+            }
+        }
+        int mreg = getFreeAllocationMreg ( inUse );
+        if ( mreg < 0 ) continue;
+
+        auto& writes = analysis.loopWrites [ c.loop ];
+        bool written = std::find ( writes.begin(), writes.end(), c.interval ) != writes.end();
+        occupied [ mreg ].push_back ( { loop.open, loop.close } );
+        splitLoops [ c.interval ].push_back ( c.loop );
+        plan.loopSplits [ loop.id ].push_back ( { c.interval, mreg, written, 0 } );
+    }
+}
+
+
+static void buildAllocationPlan ( AllocationPlan&  plan,
+                                  ir_node*         baseNode,
+                                  int              numVregs ) {
+
+    plan.vregIntervals.resize ( numVregs );
+    plan.nextInterval.assign ( numVregs, 0 );
+
+    LiveIntervalAnalysis analysis ( plan, numVregs );
+    int lineNum = 0;
+    for ( ir_node* line = baseNode->firstChild; line != NULL; line = line->next ) {
+        analysis.analyzeLine ( line, lineNum++ );
+    }
+
+    // intervals that are never cleared stay live until the end
+    for ( auto& iv : plan.intervals ) {
+        if ( iv.end < 0 ) iv.end = lineNum;
+    }
+
+    analysis.findSideEntries ();
+    linearScan ( plan );
+    splitIntervals ( plan, analysis );
+}
@@ -1,6 +1,7 @@
 /**
  * @file
- * Apply optimization to Flounder IR i.e. SIMD load/store and delay loads. 
+ * Apply optimization to Flounder IR i.e. redundant and dead code elimination,
+ * copy coalescing, delay loads and shrink wrapping of vreg ranges.
  * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
  */
 #pragma once
@@ -8,300 +9,643 @@
 #include <set>
 #include <map>
 #include <list>
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
 
 #include "flounder.h"
 #include "translate_analyze.h"
 #include "translate_optimize_simd.h"
 
 
+/* maximum number of analysis rounds of iterative passes */
+const int MaxOptimizationRounds = 16;
+
+
+/* Instructions that neither access memory by writing nor transfer *
+ * control. Passes can move code across them and keep the values   *
+ * that were loaded from memory before.                            */
+static bool isLocalInstr ( ir_node* instr ) {
+    switch ( instr->nodeType ) {
+        case MOV:
+        case MOVZX:
+        case MOVSX:
+        case MOVSXD:
+        case LEA:
+        case ADD:
+        case SUB:
+        case IMUL:
+        case AND:
+        case OR:
+        case XOR:
+        case INC:
+        case DEC:
+        case CRC32:
+        case TZCNT:
+        case CMP:
+        case CDQE:
+        case CQO:
+        case DIV:
+        case IDIV:
+        case REQ_VREG:
+        case CLEAR_VREG:
+        case COMMENT_LINE:
+            break;
+        default:
+            return false;
+    }
 
-static void delayLoads ( ir_node* baseNode ) {
-    
-    std::cout << "delay loads.." << std::endl;
+    /* stores and read-modify-write on memory */
+    ir_node* first = instr->firstChild;
+    if ( first != NULL && first->nodeType == MEM_AT && instr->nodeType != CMP ) {
+        return false;
+    }
+    return true;
+}
 
-    CodeAnalysis analysis = analyzeCode ( baseNode );
-   
-    std::set < int > delayed;
-    int lineNum = 0;
-    ir_node* instr = baseNode->firstChild;
-
-    while ( instr != NULL ) {
-
-        // save prev instruction to allow deletion and skip inserts
-        ir_node* next = instr->next;
-        if ( instr->nodeType == MOV ) {
-            ir_node* first = instr->firstChild;
-            ir_node* second = instr->lastChild;
-           
-            // delay load
-            if ( isVreg ( first ) && 
-                 second->nodeType == MEM_AT && 
-                 delayed.count ( first->id ) == 0 ) {
-
-                if ( isRead ( analysis, first ) ) {
-                    RegAccessInfo& fr = firstRead ( analysis, first );
-                    
-                    if ( analysis.vregWrites [ first->id ].size() == 1 ) {
-                        delayed.insert ( first->id ); // delay only once to avoid loops
-                        removeChild ( baseNode, instr );
-                        insertAfterChild ( baseNode, fr.line.node->prev, instr );
-                    }
-
-                } 
-            }
+
+static bool isConditionalJump ( ir_node* instr ) {
+    return isJump ( instr ) && instr->nodeType != JMP;
+}
+
+
+/* Memory locations that consist of vregs and constants */
+static bool isVregAddress ( ir_node* node ) {
+    switch ( node->nodeType ) {
+        case MEM_AT:
+        case MEM_ADD:
+        case MEM_SUB:
+            break;
+        case CONSTANT:
+        case CONSTANT_ADDRESS:
+        case CONSTANT_INT64:
+        case CONSTANT_INT32:
+        case CONSTANT_INT8:
+            return true;
+        default:
+            return isVreg ( node );
+    }
+    for ( ir_node* child = node->firstChild; child != NULL; child = child->next ) {
+        if ( !isVregAddress ( child ) ) return false;
+    }
+    return true;
+}
+
+
+static bool isEqualAddress ( ir_node* a, ir_node* b ) {
+    if ( a->nodeType != b->nodeType || a->nChildren != b->nChildren ) {
+        return false;
+    }
+    switch ( a->nodeType ) {
+        case CONSTANT:
+            return strcmp ( a->ident, b->ident ) == 0;
+        case CONSTANT_ADDRESS:
+            return a->addressData == b->addressData;
+        case CONSTANT_INT64:
+            return a->int64Data == b->int64Data;
+        case CONSTANT_INT32:
+            return a->int32Data == b->int32Data;
+        case CONSTANT_INT8:
+            return a->int8Data == b->int8Data;
+    }
+    if ( isVreg ( a ) ) {
+        return a->id == b->id;
+    }
+    ir_node* ca = a->firstChild;
+    ir_node* cb = b->firstChild;
+    while ( ca != NULL ) {
+        if ( !isEqualAddress ( ca, cb ) ) return false;
+        ca = ca->next;
+        cb = cb->next;
+    }
+    return true;
+}
+
+
+static bool usesVreg ( ir_node* node, int id ) {
+    if ( isVreg ( node ) ) {
+        return node->id == id;
+    }
+    for ( ir_node* child = node->firstChild; child != NULL; child = child->next ) {
+        if ( usesVreg ( child, id ) ) return true;
+    }
+    return false;
+}
+
+
+/* ids of the vregs that an instruction writes */
+static std::vector < int > writtenVregs ( ir_node* instr ) {
+    std::vector < int > ids;
+    int p = 0;
+    for ( ir_node* child = instr->firstChild; child != NULL; child = child->next ) {
+        if ( isVreg ( child ) && checkInstrWrite ( instr, p ) ) {
+            ids.push_back ( child->id );
         }
-        instr = next; 
-        lineNum++;
+        p++;
     }
+    return ids;
 }
 
 
+/* Loads of the form 'mov vreg, [address]' */
+static bool isVregLoad ( ir_node* instr ) {
+    return instr->nodeType == MOV
+        && isVreg ( instr->firstChild )
+        && instr->lastChild->nodeType == MEM_AT
+        && isVregAddress ( instr->lastChild );
+}
 
 
-static void shrinkWrapUsageRanges ( ir_node* baseNode ) {
+/* The vreg is requested and cleared once and only used by known instructions */
+static bool hasSingleRange ( CodeAnalysis& analysis, int id ) {
+    return analysis.vregRequestCount [ id ] == 1
+        && analysis.vregClearCount [ id ] <= 1
+        && analysis.vregOpaque.count ( id ) == 0;
+}
 
-    std::cout << "shrink wrap.." << std::endl;
 
-    CodeAnalysis analysis = analyzeCode ( baseNode );
+static bool isAccessed ( CodeAnalysis& analysis, int id ) {
+    return analysis.vregReads.count ( id ) > 0 || analysis.vregWrites.count ( id ) > 0;
+}
 
-    for ( const auto& vregReq : analysis.vregRequests ) {
-   
-        int id = vregReq.second.node->firstChild->id;
-        LineInfo req   = vregReq.second;
-        LineInfo clear = analysis.vregClears [ id ];
-
-        auto itLowerLoops = analysis.loopOpenMarkers.lower_bound ( req.num );
-        auto itUpperLoops = analysis.loopOpenMarkers.upper_bound ( clear.num );
-        LineInfo requestBefore = firstWrite ( analysis, id ).line;
-        if ( !isRead ( analysis, id ) ) {
-            if ( requestBefore.node->nodeType != MANAGED_CALL ) {
-                std::cout << call_emit ( requestBefore.node ) << " is never read!" << std::endl;
-                removeChild ( baseNode, req.node );
-                removeChild ( baseNode, requestBefore.node );
-                removeChild ( baseNode, clear.node );
+
+/* first and last line that reads or writes a vreg */
+static void accessRange ( CodeAnalysis& analysis, int id, int& first, int& last ) {
+    first = INT_MAX;
+    last = -1;
+    auto reads = analysis.vregReads.find ( id );
+    if ( reads != analysis.vregReads.end() ) {
+        first = std::min ( first, reads->second.front().line.num );
+        last  = std::max ( last,  reads->second.back().line.num );
+    }
+    auto writes = analysis.vregWrites.find ( id );
+    if ( writes != analysis.vregWrites.end() ) {
+        first = std::min ( first, writes->second.front().line.num );
+        last  = std::max ( last,  writes->second.back().line.num );
+    }
+}
+
+
+static bool readsAtLine ( CodeAnalysis& analysis, int id, int lineNum ) {
+    auto reads = analysis.vregReads.find ( id );
+    if ( reads == analysis.vregReads.end() ) return false;
+    for ( auto& r : reads->second ) {
+        if ( r.line.num == lineNum ) return true;
+    }
+    return false;
+}
+
+
+/* Checks that the lines from first to last are executed in order within one  *
+ * iteration of each loop, i.e. loops are either disjoint, enclose the range, *
+ * or are contained in the range without containing 'line'.                   */
+static bool isLoopConsistent ( CodeAnalysis& analysis, int first, int last, int line ) {
+    for ( auto& loop : analysis.loopRanges ) {
+        int open  = loop.first;
+        int close = loop.second;
+        if ( close < first || last < open ) continue;
+        if ( open <= first && last <= close ) continue;
+        if ( first <= open && close <= last && ( line < open || close < line ) ) continue;
+        return false;
+    }
+    return true;
+}
+
+
+static void renameVregsDescend ( ir_node*                                  node,
+                                 std::unordered_map < int, ir_node* >&     renames ) {
+
+    for ( ir_node* child = node->firstChild; child != NULL; child = child->next ) {
+        if ( isVreg ( child ) ) {
+            auto it = renames.find ( child->id );
+            if ( it != renames.end() ) {
+                child->id    = it->second->id;
+                child->ident = it->second->ident;
             }
+        }
+        renameVregsDescend ( child, renames );
+    }
+}
+
+
+
+/* Replaces loads from a location that was loaded before in the same basic *
+ * block with a copy of the previously loaded vreg. Stores, calls, labels  *
+ * and jumps end the availability of all loaded values.                    */
+static void eliminateRedundantLoads ( ir_node* baseNode ) {
+
+    struct AvailableLoad {
+        ir_node*  address;
+        ir_node*  vreg;
+    };
+    std::vector < AvailableLoad > available;
+
+    for ( ir_node* instr = baseNode->firstChild; instr != NULL; instr = instr->next ) {
+
+        if ( !isLocalInstr ( instr ) ) {
+            available.clear();
             continue;
         }
-        LineInfo clearAfter    = lastRead ( analysis, id ).line;
-     
-        /* Expand requestBefore and clearAfter such that all loops in the *
-         * original validity range are fully contained.                   *
-         */
-        for ( auto itLoop = itLowerLoops; itLoop != itUpperLoops; itLoop++ ) {
-
-            LineInfo open  = itLoop->second;
-            LineInfo close = analysis.loopCloseMarkers [ open.node->id ];
-
-            if ( open.num < requestBefore.num ) {
-                
-                /* skip if the whole loop closes before first use */
-                if ( close.num < requestBefore.num ) {
-                    continue;
+
+        if ( isVregLoad ( instr ) ) {
+            ir_node* dest = instr->firstChild;
+            for ( auto& load : available ) {
+                if ( load.vreg->nodeType == dest->nodeType &&
+                     load.vreg->id != dest->id &&
+                     isEqualAddress ( load.address, instr->lastChild ) ) {
+
+                    ir_node* copy = copyNode ( load.vreg );
+                    copy->next = NULL;
+                    copy->prev = dest;
+                    dest->next = copy;
+                    instr->lastChild = copy;
+                    break;
                 }
-                requestBefore = open;
-            }
-            
-            if ( close.num > clearAfter.num ) {
-                clearAfter = close;
             }
         }
 
-        removeChild ( baseNode, req.node );
-        insertAfterChild ( baseNode, requestBefore.node->prev, req.node );
+        // values in written or cleared vregs are not available anymore
+        std::vector < int > ids = writtenVregs ( instr );
+        if ( instr->nodeType == REQ_VREG || instr->nodeType == CLEAR_VREG ) {
+            ids.push_back ( instr->firstChild->id );
+        }
+        for ( int id : ids ) {
+            available.erase ( std::remove_if ( available.begin(), available.end(),
+                [id] ( AvailableLoad& load ) {
+                    return load.vreg->id == id || usesVreg ( load.address, id );
+                } ), available.end() );
+        }
 
-        if ( isRead ( analysis, id ) ) {
-            
-            removeChild ( baseNode, clear.node );
-            insertAfterChild ( baseNode, clearAfter.node, clear.node );
+        if ( isVregLoad ( instr ) && !usesVreg ( instr->lastChild, instr->firstChild->id ) ) {
+            available.push_back ( { instr->lastChild, instr->firstChild } );
         }
-    } 
+    }
 }
 
 
 
+/* Coalesces the vregs of 'mov a, b' when a starts with the copy and the *
+ * values of a and b do not differ while both are live. This is the case  *
+ * when b is not used after the copy (combining) or when a and b are      *
+ * written only by the copy and before the copy (aliasing).               */
+static bool isCoalescable ( CodeAnalysis&  analysis,
+                            ir_node*       instr,
+                            int            a,
+                            int            b,
+                            int            lineNum ) {
 
+    if ( a == b || instr->firstChild->nodeType != instr->lastChild->nodeType ) return false;
+    if ( !hasSingleRange ( analysis, a ) || !hasSingleRange ( analysis, b ) ) return false;
 
-static void replaceAliasesDescend ( ir_node*               node,
-                                    std::map < int, int >  aliasMap ) {
-    
-    ir_node* child = node->firstChild;
-    while ( child != NULL ) {
-        if ( isVreg ( child ) ) {
-            if ( aliasMap.find ( child->id ) != aliasMap.end() ) {
-                child->id = aliasMap [ child->id ];
-                char* ident;
-                asprintf ( &ident, "_(%i)", child->id );
-                setIdent ( child, ident ); 
-            }
-        }
-        replaceAliasesDescend ( child, aliasMap );
-
-        if ( child->nodeType == MOV ) {
-            if ( isVreg ( child->firstChild ) 
-              && isVreg ( child->lastChild )
-              && ( child->firstChild->id == child->lastChild->id ) ) {
-      
-                removeChild ( node, child );
-            }
-        }
+    // equal types of the declared vregs
+    ir_node* declA = analysis.vregRequests [ a ].node->firstChild;
+    ir_node* declB = analysis.vregRequests [ b ].node->firstChild;
+    if ( declA->nodeType != declB->nodeType ) return false;
+
+    int firstA, lastA, firstB, lastB;
+    accessRange ( analysis, a, firstA, lastA );
+    accessRange ( analysis, b, firstB, lastB );
 
-        child = child->next;
+    // a starts with the copy and b with a write
+    if ( firstA != lineNum ) return false;
+    if ( analysis.vregWrites.count ( b ) == 0 ) return false;
+    if ( analysis.vregWrites [ b ].front().line.num != firstB ) return false;
+    if ( readsAtLine ( analysis, b, firstB ) ) return false;
+
+    bool combining = ( lastB == lineNum );
+    bool aliasing  = analysis.vregWrites [ a ].size() == 1
+                  && analysis.vregWrites [ b ].back().line.num < lineNum;
+    if ( !combining && !aliasing ) return false;
+
+    return isLoopConsistent ( analysis, firstB, std::max ( lastA, lastB ), lineNum );
+}
+
+
+/* Moves the accesses of a to b in line order, except those of the copy */
+static void mergeAccesses ( std::map < int, std::vector < RegAccessInfo > >&  accesses,
+                            int                                              a,
+                            int                                              b,
+                            int                                              copyLine ) {
+
+    std::vector < RegAccessInfo > merged;
+    std::vector < RegAccessInfo >& accB = accesses [ b ];
+    auto itA = accesses.find ( a );
+    if ( itA != accesses.end() ) {
+        std::merge ( itA->second.begin(), itA->second.end(), accB.begin(), accB.end(),
+            std::back_inserter ( merged ),
+            [] ( const RegAccessInfo& x, const RegAccessInfo& y ) { return x.line.num < y.line.num; } );
+        accesses.erase ( itA );
     }
+    else {
+        merged = accB;
+    }
+    merged.erase ( std::remove_if ( merged.begin(), merged.end(),
+        [copyLine] ( RegAccessInfo& acc ) { return acc.line.num == copyLine; } ), merged.end() );
+
+    if ( merged.empty() ) accesses.erase ( b );
+    else accesses [ b ] = merged;
 }
 
 
+/* Keeps the wider range of the request and clear markers of a and b for b *
+ * and updates the analysis as if the copy was removed and a renamed to b.  */
+static void mergeVregRanges ( CodeAnalysis&              analysis,
+                              int                        a,
+                              int                        b,
+                              int                        copyLine,
+                              std::vector < ir_node* >&  removed ) {
+
+    LineInfo reqA = analysis.vregRequests [ a ];
+    LineInfo reqB = analysis.vregRequests [ b ];
+    removed.push_back ( reqA.num < reqB.num ? reqB.node : reqA.node );
+    if ( reqA.num < reqB.num ) analysis.vregRequests [ b ] = reqA;
+    analysis.vregRequests.erase ( a );
+
+    bool clearedA = analysis.vregClears.count ( a ) > 0;
+    bool clearedB = analysis.vregClears.count ( b ) > 0;
+    if ( clearedA && clearedB ) {
+        LineInfo clearA = analysis.vregClears [ a ];
+        LineInfo clearB = analysis.vregClears [ b ];
+        removed.push_back ( clearA.num > clearB.num ? clearB.node : clearA.node );
+        if ( clearA.num > clearB.num ) analysis.vregClears [ b ] = clearA;
+    }
+    else if ( clearedA ) {
+        removed.push_back ( analysis.vregClears [ a ].node );
+    }
+    else if ( clearedB ) {
+        removed.push_back ( analysis.vregClears [ b ].node );
+        analysis.vregClears.erase ( b );
+    }
+    analysis.vregClears.erase ( a );
+
+    mergeAccesses ( analysis.vregReads,  a, b, copyLine );
+    mergeAccesses ( analysis.vregWrites, a, b, copyLine );
+}
+
 
-static void mergeVregRanges ( ir_node*       baseNode,
-                              CodeAnalysis&  analysis,
-                              int            id1,
-                              int            id2 ) {
+/* Each round analyzes the code once and updates the analysis for every  *
+ * coalesced copy. Lines are removed and vregs renamed at the end of the *
+ * round, so line numbers stay valid while the round inspects the code.  */
+static void coalesceCopies ( ir_node* baseNode ) {
 
+    for ( int round = 0; round < MaxOptimizationRounds; round++ ) {
 
-        LineInfo req        = analysis.vregRequests [ id1 ];
-        LineInfo clear      = analysis.vregClears   [ id1 ];
-        LineInfo aliasReq   = analysis.vregRequests [ id2 ];
-        LineInfo aliasClear = analysis.vregClears   [ id2 ];
+        CodeAnalysis analysis = analyzeCode ( baseNode );
+        std::unordered_map < int, int > merges;
+        std::vector < ir_node* > removed;
 
-        LineInfo mergeReq;
-        LineInfo mergeClear;
-        if ( aliasReq.num < req.num ) {
-            mergeReq = aliasReq;
-            removeChild ( baseNode, req.node );
+        // declared vregs before the analysis is updated
+        std::unordered_map < int, ir_node* > decls;
+        for ( auto& req : analysis.vregRequests ) {
+            decls [ req.first ] = req.second.node->firstChild;
         }
-        else {
-            mergeReq = req;
-            removeChild ( baseNode, aliasReq.node );
+
+        auto resolve = [&merges] ( int id ) {
+            for ( auto it = merges.find ( id ); it != merges.end(); it = merges.find ( id ) ) {
+                id = it->second;
+            }
+            return id;
+        };
+
+        int lineNum = 0;
+        for ( ir_node* instr = baseNode->firstChild; instr != NULL; instr = instr->next ) {
+            if ( instr->nodeType == MOV && isVreg ( instr->firstChild ) && isVreg ( instr->lastChild ) ) {
+                int a = resolve ( instr->firstChild->id );
+                int b = resolve ( instr->lastChild->id );
+                if ( isCoalescable ( analysis, instr, a, b, lineNum ) ) {
+                    mergeVregRanges ( analysis, a, b, lineNum, removed );
+                    removed.push_back ( instr );
+                    merges [ a ] = b;
+                }
+            }
+            lineNum++;
         }
-        if ( aliasClear.num > clear.num ) {
-            mergeClear = aliasClear;
-            removeChild ( baseNode, clear.node );
+
+        if ( merges.empty() ) break;
+
+        for ( ir_node* node : removed ) removeChild ( baseNode, node );
+        std::unordered_map < int, ir_node* > renames;
+        for ( auto& m : merges ) {
+            renames [ m.first ] = decls [ resolve ( m.first ) ];
         }
-        else {
-            mergeClear = clear;
-            removeChild ( baseNode, aliasClear.node );
+        renameVregsDescend ( baseNode, renames );
+    }
+}
+
+
+
+/* Instructions without effect other than writing their first operand */
+static bool isRemovableWrite ( ir_node* instr ) {
+    switch ( instr->nodeType ) {
+        case MOV:
+        case MOVZX:
+        case MOVSX:
+        case MOVSXD:
+        case LEA:
+            return true;
+        case ADD:
+        case SUB:
+        case IMUL:
+        case AND:
+        case OR:
+        case XOR:
+        case INC:
+        case DEC:
+        case CRC32:
+        case TZCNT: {
+            // keep flags for conditional jumps
+            ir_node* next = instr->next;
+            while ( next != NULL && next->nodeType == COMMENT_LINE ) next = next->next;
+            return next == NULL || !isConditionalJump ( next );
         }
-        mergeReq.node->firstChild->id = id2;
-        mergeClear.node->firstChild->id = id2;
-       
-        analysis.vregRequests [ id1 ] = mergeReq; 
-        analysis.vregRequests [ id2 ] = mergeReq; 
-        analysis.vregClears   [ id1 ] = mergeClear; 
-        analysis.vregClears   [ id2 ] = mergeClear; 
+    }
+    return false;
 }
-                          
 
 
+/* Removes vregs that are never read together with their writes */
+static void eliminateDeadCode ( ir_node* baseNode ) {
 
-static void aliasing ( ir_node* baseNode ) {
+    for ( int round = 0; round < MaxOptimizationRounds; round++ ) {
 
-    std::cout << "aliasing.." << std::endl;
-    
-    std::map < int, int > aliasMap;
+        CodeAnalysis analysis = analyzeCode ( baseNode );
+        bool changed = false;
 
-    CodeAnalysis analysis = analyzeCode ( baseNode );
-    for ( const auto& vregReq : analysis.vregRequests ) {
+        for ( auto& req : analysis.vregRequests ) {
+            int id = req.first;
+            if ( !hasSingleRange ( analysis, id ) || analysis.vregReads.count ( id ) > 0 ) {
+                continue;
+            }
 
-        int id = vregReq.second.node->firstChild->id;
-       
-        std::map < int, std::vector < RegAccessInfo > > vregWrites;
-        
-        if ( analysis.vregWrites [ id ].size() > 1 ) {
-            continue;
-        }
-        ir_node* write = analysis.vregWrites [ id ] [ 0 ].line.node;
-        if ( write->nodeType != MOV ) {
-           continue;
-        }
-        if ( !isVreg ( write->firstChild->next ) ) {
-           continue;
-        }
+            std::set < ir_node* > writes;
+            bool removable = true;
+            for ( auto& w : analysis.vregWrites [ id ] ) {
+                removable &= isRemovableWrite ( w.line.node );
+                writes.insert ( w.line.node );
+            }
+            if ( !removable ) continue;
 
-        int aliasId = write->firstChild->next->id;
-        if ( analysis.vregWrites [ aliasId ].size() > 1 ) {
-            continue;
-        }
-        if ( aliasMap.find ( aliasId ) != aliasMap.end() ) {
-            aliasId = aliasMap [ aliasId ];
+            for ( ir_node* w : writes ) {
+                removeChild ( baseNode, w );
+            }
+            removeChild ( baseNode, req.second.node );
+            if ( analysis.vregClears.count ( id ) > 0 ) {
+                removeChild ( baseNode, analysis.vregClears [ id ].node );
+            }
+            changed = true;
         }
 
-        mergeVregRanges ( baseNode, analysis, id, aliasId );
+        if ( !changed ) break;
+    }
+}
+
 
-/*
-        LineInfo aliasReq   = analysis.vregRequests [ aliasId ];
-        LineInfo aliasClear = analysis.vregClears [ aliasId ];
 
-        LineInfo mergeReq;
-        LineInfo mergeClear;
-        if ( aliasReq.num < req.num ) {
-            mergeReq = aliasReq;
-            removeChild ( baseNode, req.node );
-        }
-        else {
-            mergeReq = req;
-            removeChild ( baseNode, aliasReq.node );
-        }
-        if ( aliasClear.num > clear.num ) {
-            mergeClear = aliasClear;
-            removeChild ( baseNode, clear.node );
-        }
-        else {
-            mergeClear = clear;
-            removeChild ( baseNode, aliasClear.node );
-        }
-        mergeReq.node->firstChild->id = aliasId;
-        mergeClear.node->firstChild->id = aliasId;
-       
-        analysis.vregRequests [ id ] = mergeReq; 
-        analysis.vregRequests [ aliasId ] = mergeReq; 
-        analysis.vregClears [ id ] = mergeClear; 
-        analysis.vregClears [ aliasId ] = mergeClear; 
-*/
+/* Moves loads towards the first read of the loaded vreg. Loads are not     *
+ * moved across stores, calls or loops. Forward jumps are passed when their  *
+ * labels are placed after all reads, such that tuples that do not qualify   *
+ * skip the load, or when the load also passes the labels of all jumps.      */
+static void delayLoads ( ir_node* baseNode ) {
 
+    CodeAnalysis analysis = analyzeCode ( baseNode );
 
-        aliasMap [ id ] = aliasId;
+    std::vector < ir_node* > loads;
+    std::unordered_map < ir_node*, int > lineNums;
+    std::unordered_map < const char*, int > jumpsToLabel;
+    int lineNum = 0;
+    for ( ir_node* instr = baseNode->firstChild; instr != NULL; instr = instr->next ) {
+        if ( isVregLoad ( instr ) ) loads.push_back ( instr );
+        if ( isJump ( instr ) ) jumpsToLabel [ instr->firstChild->ident ]++;
+        lineNums [ instr ] = lineNum++;
     }
 
-    replaceAliasesDescend ( baseNode, aliasMap );
+    for ( ir_node* load : loads ) {
+
+        int id = load->firstChild->id;
+        ir_node* address = load->lastChild;
+        if ( !hasSingleRange ( analysis, id ) ) continue;
+        if ( analysis.vregWrites [ id ].size() != 1 || !isRead ( analysis, id ) ) continue;
+        int lastReadNum = lastRead ( analysis, id ).line.num;
+
+        // passed jumps with labels that were not passed yet
+        std::unordered_map < const char*, int > pendingJumps;
+
+        ir_node* target = NULL;
+        for ( ir_node* instr = load->next; instr != NULL; instr = instr->next ) {
+
+            // all paths from the load to a read pass the position
+            bool valid = true;
+            for ( auto& jumps : pendingJumps ) {
+                valid &= analysis.labelLines [ jumps.first ] > lastReadNum;
+            }
+            if ( valid ) target = instr;
+
+            if ( usesVreg ( instr, id ) ) break;
+
+            if ( isConditionalJump ( instr ) ) {
+                auto label = analysis.labelLines.find ( instr->firstChild->ident );
+                if ( label == analysis.labelLines.end() || label->second < lineNums [ instr ] ) break;
+                pendingJumps [ label->first ]++;
+                continue;
+            }
+
+            if ( instr->nodeType == SECTION && instr->ident2 != NULL ) {
+                auto jumps = pendingJumps.find ( instr->ident2 );
+                int numPassed = ( jumps != pendingJumps.end() ) ? jumps->second : 0;
+                if ( numPassed != jumpsToLabel [ instr->ident2 ] ) break;
+                if ( jumps != pendingJumps.end() ) pendingJumps.erase ( jumps );
+                continue;
+            }
+
+            if ( !isLocalInstr ( instr ) ) break;
+
+            // the loaded location stays the same
+            bool addressChanged = false;
+            for ( int w : writtenVregs ( instr ) ) {
+                addressChanged |= usesVreg ( address, w );
+            }
+            if ( instr->nodeType == REQ_VREG || instr->nodeType == CLEAR_VREG ) {
+                addressChanged |= usesVreg ( address, instr->firstChild->id );
+            }
+            if ( addressChanged ) break;
+        }
+
+        if ( target != NULL && target != load->next ) {
+            removeChild ( baseNode, load );
+            insertBeforeChild ( baseNode, target, load );
+        }
+    }
 }
 
-static void combining ( ir_node* baseNode ) {
-    std::cout << "combining.." << std::endl;
+
+
+/* Moves the request and clear markers of vregs to their first and last access. *
+ * Loops that use a vreg requested outside of the loop are fully contained, to   *
+ * keep values that are live across iterations.                                  */
+static void shrinkWrapUsageRanges ( ir_node* baseNode ) {
+
     CodeAnalysis analysis = analyzeCode ( baseNode );
-    std::map < int, int > aliasMap;
-    ir_node* instr = baseNode->firstChild;
-    while ( instr != NULL && instr->next != NULL ) {
-        if ( instr->nodeType == MOV ) {
-            if ( ( isVreg ( instr->firstChild ) ) &&
-                 ( isVreg ( instr->lastChild  ) ) && 
-                 ( instr->next->nodeType == CLEAR_VREG ) &&
-                 ( instr->next->firstChild->id == instr->lastChild->id ) )  
-            {
-                int idFirst  = instr->lastChild->id;
-                int idSecond = instr->firstChild->id;
-                if ( aliasMap.find ( idFirst ) != aliasMap.end() ) {
-                    idFirst = aliasMap [ idFirst ];
-                } 
-                mergeVregRanges ( baseNode, analysis, idFirst, idSecond );
-                aliasMap [ idSecond ] = idFirst;
+
+    std::vector < ir_node* > lines;
+    for ( ir_node* instr = baseNode->firstChild; instr != NULL; instr = instr->next ) {
+        lines.push_back ( instr );
+    }
+
+    for ( const auto& vregReq : analysis.vregRequests ) {
+
+        int id = vregReq.first;
+        if ( !hasSingleRange ( analysis, id ) || !isAccessed ( analysis, id ) ) continue;
+
+        LineInfo req = vregReq.second;
+        bool cleared = analysis.vregClears.count ( id ) > 0;
+        int clearNum = cleared ? analysis.vregClears [ id ].num : lines.size();
+
+        int first, last;
+        accessRange ( analysis, id, first, last );
+
+        bool expanded = true;
+        while ( expanded ) {
+            expanded = false;
+            for ( auto& loop : analysis.loopRanges ) {
+                int open  = loop.first;
+                int close = loop.second;
+                bool overlaps  = open <= last && first <= close;
+                bool contained = first <= open && close <= last;
+                bool local     = open < req.num && clearNum < close;
+                if ( overlaps && !contained && !local ) {
+                    first = std::min ( first, open );
+                    last  = std::max ( last, close );
+                    expanded = true;
+                }
             }
-        } 
-        instr = instr->next;
+        }
+
+        if ( first > req.num ) {
+            removeChild ( baseNode, req.node );
+            insertBeforeChild ( baseNode, lines [ first ], req.node );
+        }
+        if ( cleared && last < clearNum ) {
+            ir_node* clear = analysis.vregClears [ id ].node;
+            removeChild ( baseNode, clear );
+            insertAfterChild ( baseNode, lines [ last ], clear );
+        }
     }
-    replaceAliasesDescend ( baseNode, aliasMap );
 }
 
 
-static void optimize ( ir_node* baseNode ) { 
-    
-    aliasing ( baseNode );
 
-    delayLoads ( baseNode );
+static void optimize ( ir_node* baseNode ) {
 
-    shrinkWrapUsageRanges ( baseNode );
-    
-    combining ( baseNode );
-}
+    eliminateRedundantLoads ( baseNode );
 
+    coalesceCopies ( baseNode );
 
+    eliminateDeadCode ( baseNode );
 
+    delayLoads ( baseNode );
 
+    shrinkWrapUsageRanges ( baseNode );
+}
@@ -0,0 +1,141 @@
+/**
+ * @file
+ * Split Flounder IR into functions that are translated separately.
+ * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
+ */
+#pragma once
+
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "flounder.h"
+
+
+/* Lowest and highest code part in which a vreg or label occurs */
+struct PartRange {
+    size_t first;
+    size_t last;
+
+    void add ( size_t part ) {
+        first = std::min ( first, part );
+        last  = std::max ( last, part );
+    }
+};
+
+
+template < typename Key >
+static void addPartRange ( std::map < Key, PartRange >&  ranges,
+                           Key                           key,
+                           size_t                        part ) {
+    auto it = ranges.find ( key );
+    if ( it == ranges.end() ) {
+        ranges [ key ] = { part, part };
+    }
+    else {
+        it->second.add ( part );
+    }
+}
+
+
+static void recordVregParts ( ir_node*                       node,
+                              size_t                         part,
+                              std::map < int, PartRange >&  vregs ) {
+    if ( isVreg ( node ) ) {
+        addPartRange ( vregs, node->id, part );
+    }
+    for ( ir_node* child = node->firstChild; child != nullptr; child = child->next ) {
+        recordVregParts ( child, part, vregs );
+    }
+}
+
+
+/* Parts that only return or comment are kept with the previous part */
+static bool isTrailingPart ( ir_node* first ) {
+    for ( ir_node* line = first; line != nullptr; line = line->next ) {
+        if ( line->nodeType != RET && line->nodeType != COMMENT_LINE ) return false;
+    }
+    return true;
+}
+
+
+/* Splits the lines of codeTree after the given boundary lines into   *
+ * separate functions. Neighbouring parts that share a vreg or a jump *
+ * label stay in the same function. The last function ends with the   *
+ * return of codeTree and the others get a return appended. Returns   *
+ * the roots of the functions or an empty vector when the code cannot *
+ * be split.                                                          */
+static std::vector < ir_node* > splitIndependentCode ( ir_node*                        codeTree,
+                                                       const std::vector < ir_node* >& boundaries ) {
+
+    std::set < ir_node* > boundarySet ( boundaries.begin(), boundaries.end() );
+    std::vector < ir_node* > partStart;
+    std::map < int, PartRange > vregs;
+    std::map < const char*, PartRange > labels;
+
+    /* assign lines to the parts between boundaries */
+    size_t part = 0;
+    partStart.push_back ( codeTree->firstChild );
+    for ( ir_node* line = codeTree->firstChild; line != nullptr; line = line->next ) {
+        recordVregParts ( line, part, vregs );
+        if ( line->nodeType == SECTION && line->ident2 != nullptr ) {
+            addPartRange < const char* > ( labels, line->ident2, part );
+        }
+        if ( isJump ( line ) ) {
+            addPartRange < const char* > ( labels, line->firstChild->ident, part );
+        }
+        if ( boundarySet.count ( line ) > 0 && line->next != nullptr ) {
+            partStart.push_back ( line->next );
+            part++;
+        }
+    }
+
+    /* keep parts together that share vregs or labels */
+    std::vector < bool > cut ( partStart.size(), true );
+    cut [ 0 ] = false;
+    auto keepTogether = [&cut] ( PartRange& range ) {
+        for ( size_t p = range.first + 1; p <= range.last; p++ ) {
+            cut [ p ] = false;
+        }
+    };
+    for ( auto& v : vregs )  keepTogether ( v.second );
+    for ( auto& l : labels ) keepTogether ( l.second );
+    if ( isTrailingPart ( partStart.back() ) ) {
+        cut.back() = false;
+    }
+
+    std::vector < ir_node* > functions;
+    ir_node* function = nullptr;
+    for ( size_t p = 0; p < partStart.size(); p++ ) {
+        if ( p == 0 || cut [ p ] ) {
+            function = irRoot();
+            function->firstChild = partStart [ p ];
+            functions.push_back ( function );
+        }
+        ir_node* end = ( p + 1 < partStart.size() ) ? partStart [ p + 1 ]->prev : codeTree->lastChild;
+        function->lastChild = end;
+        for ( ir_node* line = partStart [ p ]; line != end->next; line = line->next ) {
+            function->nChildren++;
+        }
+    }
+    if ( functions.size() < 2 ) {
+        return {};
+    }
+
+    /* unlink the functions and let each return. The leading comment *
+     * gives call placement a line to insert after.                   */
+    for ( ir_node* f : functions ) {
+        f->firstChild->prev = nullptr;
+        f->lastChild->next = nullptr;
+        insertBeforeChild ( f, f->firstChild, commentLine ( " --- Pipeline function" ) );
+        if ( f != functions.back() ) {
+            addChild ( f, ret() );
+        }
+    }
+    codeTree->firstChild = nullptr;
+    codeTree->lastChild  = nullptr;
+    codeTree->nChildren  = 0;
+    return functions;
+}
+
@@ -9,6 +9,7 @@
 #include "flounder.h"
 #include "RegisterAllocationState.h"
 #include "translate_analyze.h"
+#include "translate_linear_scan.h"
 #include "limits.h"
 #include "stdlib.h"
 
@@ -125,7 +126,7 @@ ir_node* accessSpillSlot ( int spillId ) {
     return stackAccess;
 }
 
-int numSpillAccess = 0;
+thread_local int numSpillAccess = 0;
 
 
 ir_node* getSpillLoadReg ( ir_node* expr, int i ) {
@@ -190,6 +191,91 @@ void emitSpillCode ( ir_node*          base,
 }
 
 
+/* -------------------- INTERVAL SPLITS AT LOOPS ---------------------- */
+static ir_node* splitRegister ( IntervalSplit& split, AllocationPlan& plan ) {
+    return getMachineRegister ( plan.intervals [ split.interval ].vreg, split.mreg );
+}
+
+
+/* Loads split intervals to their registers before the loop marker */
+static void openLoopSplits ( ir_node*                  base,
+                             ir_node*                  marker,
+                             AllocationPlan&           plan,
+                             RegisterAllocationState&  state ) {
+
+    auto it = plan.loopSplits.find ( marker->id );
+    if ( it == plan.loopSplits.end() ) return;
+
+    for ( IntervalSplit& split : it->second ) {
+        int vregId = plan.intervals [ split.interval ].vreg->id;
+        M_Assert ( state.allocation [ vregId ] < 0, "Split interval is not spilled." );
+        split.spillSlot = state.allocation [ vregId ];
+        insertBeforeChild ( base, marker, mov ( splitRegister ( split, plan ), 
+                                                accessSpillSlot ( -split.spillSlot ) ) );
+        numSpillAccess++;
+        state.allocation [ vregId ] = split.mreg + 1;
+        state.mregInUse [ split.mreg ] = 1;
+        state.numMregsUsed++;
+    }
+    plan.activeSplitLoops.push_back ( marker->id );
+}
+
+
+static void storeSplits ( ir_node*         base,
+                          ir_node*         line,
+                          AllocationPlan&  plan,
+                          int              loopId,
+                          bool             before ) {
+
+    for ( IntervalSplit& split : plan.loopSplits [ loopId ] ) {
+        if ( !split.written ) continue;
+        ir_node* store = mov ( accessSpillSlot ( -split.spillSlot ), splitRegister ( split, plan ) );
+        if ( before ) {
+            insertBeforeChild ( base, line, store );
+        }
+        else {
+            insertAfterChild ( base, line, store );
+        }
+        numSpillAccess++;
+    }
+}
+
+
+/* Stores split intervals after the loop marker and returns them to their spill slots */
+static void closeLoopSplits ( ir_node*                  base,
+                              ir_node*                  marker,
+                              AllocationPlan&           plan,
+                              RegisterAllocationState&  state ) {
+
+    if ( plan.activeSplitLoops.empty() || plan.activeSplitLoops.back() != marker->id ) return;
+    plan.activeSplitLoops.pop_back();
+
+    storeSplits ( base, marker, plan, marker->id, false );
+    for ( IntervalSplit& split : plan.loopSplits [ marker->id ] ) {
+        int vregId = plan.intervals [ split.interval ].vreg->id;
+        state.allocation [ vregId ] = split.spillSlot;
+        state.mregInUse [ split.mreg ] = 0;
+        state.numMregsUsed--;
+    }
+}
+
+
+/* Stores split intervals before jumps that leave their loop */
+static void storeSplitsBeforeExit ( ir_node*         base,
+                                    ir_node*         jump,
+                                    AllocationPlan&  plan ) {
+
+    auto target = plan.labelLoops.find ( jump->firstChild->ident );
+    for ( int loopId : plan.activeSplitLoops ) {
+        bool leavesLoop = target == plan.labelLoops.end() ||
+            std::find ( target->second.begin(), target->second.end(), loopId ) == target->second.end();
+        if ( leavesLoop ) {
+            storeSplits ( base, jump, plan, loopId, true );
+        }
+    }
+}
+
+
 void getAllVregsDescend ( ir_node* node, std::vector < ir_node* >& set ) {
     ir_node* child = node->firstChild;
     while ( child != NULL ) {
@@ -211,12 +297,14 @@ std::vector < ir_node* > getAllVregs ( ir_node* node ) {
 
 void allocExplicit ( ir_node*                 baseNode,
                      ir_node*                 line,
-                     RegisterAllocationState& state ) {
+                     RegisterAllocationState& state,
+                     AllocationPlan&          plan ) {
 
     ir_node* vreg = line->firstChild;
 
     if ( line->nodeType == REQ_VREG  ) {
-        allocateReg ( vreg, state );
+        LiveInterval& interval = plan.intervals [ plan.vregIntervals [ vreg->id ] [ plan.nextInterval [ vreg->id ]++ ] ];
+        allocateReg ( vreg, state, interval.mreg );
         removeChild ( baseNode, line );
         state.explicitAlloc [ vreg->id ] = true;
         state.allocatedVregs [ vreg->id ] = vreg;
@@ -233,7 +321,8 @@ void allocExplicit ( ir_node*                 baseNode,
 void handleRegisterAllocation ( ir_node*                 baseNode, 
                                 ir_node*                 line, 
                                 int                      lineNum,
-                                RegisterAllocationState& state ) {
+                                RegisterAllocationState& state,
+                                AllocationPlan&          plan ) {
  
     if ( printAllocation ) {
         for(int i=0; i<numMregs; i++) {
@@ -244,7 +333,7 @@ void handleRegisterAllocation ( ir_node*                 baseNode,
 
     // handle explicit allocation 
     if ( line->nodeType == REQ_VREG || line->nodeType == CLEAR_VREG ) {
-        allocExplicit ( baseNode, line, state );
+        allocExplicit ( baseNode, line, state, plan );
     }
     else {
         // replace vreg operands
@@ -19,5 +19,10 @@
 #include "materialize.h"
 #include "nestedloopsjoin.h"
 #include "hashjoin.h"
+#include "mergejoin.h"
+#include "bandjoin.h"
+#include "semijoin.h"
 #include "aggregation.h"
+#include "groupjoin.h"
 #include "orderby.h"
+#include "topk.h"
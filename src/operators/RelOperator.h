@@ -32,6 +32,11 @@ public:
         HASHJOIN,
         AGGREGATION,
         ORDERBY,    
+        GROUPJOIN,
+        TOPK,
+        MERGEJOIN,
+        BANDJOIN,
+        SEMIJOIN,
     };
 
     /* pointer to parent operator */
@@ -159,6 +164,22 @@ public:
      */
     virtual size_t getSize ()   = 0;
 
+
+    /**
+     * @brief Returns statistics of a base table attribute or nullptr.
+     * Scans provide the statistics of their relation, other operators
+     * pass on the statistics of their children.
+     */
+    virtual ColumnStatistics* columnStatistics ( const std::string& attribute ) {
+        for ( auto& c : children ) {
+            ColumnStatistics* stats = c->columnStatistics ( attribute );
+            if ( stats != nullptr ) {
+                return stats;
+            }
+        }
+        return nullptr;
+    }
+
     
     /*
      * Flounder JIT interface
@@ -187,6 +208,24 @@ public:
     virtual void addLimit ( size_t limit ) {
         throw ResqlError ( "Limit can only be set on materializing operators" );
     }
+
+
+    /**
+     * @brief Resets the runtime state of the operator after execution.
+     * The generated code refers to the state by address. Operators reset
+     * iterators, hash tables and flags in place such that the compiled
+     * query can be executed again.
+     */
+    virtual void resetState () {}
+
+
+    /* Resets the children first, the parent may use their state */
+    void resetPlan () {
+        for ( auto& c : this->children ) {
+            c->resetPlan();
+        }
+        this->resetState();
+    }
    
 
     void printPrefix ( std::string prefix, bool isLastChild, std::ostream& out ) {
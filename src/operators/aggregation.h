@@ -82,6 +82,24 @@ public:
         if ( _groupExpr.size() == 0 ) {
             return 1;
         }
+
+        /* the number of groups is at most the product of the *
+         * distinct values of the grouping attributes          */
+        double groups = 1.0;
+        for ( Expr* e : _groupExpr ) {
+            ColumnStatistics* stats = nullptr;
+            if ( e->tag == Expr::ATTRIBUTE ) {
+                stats = _child->columnStatistics ( e->symbol );
+            }
+            if ( stats == nullptr ) {
+                groups = -1.0;
+                break;
+            }
+            groups *= stats->distinct;
+        }
+        if ( groups > 0.0 ) {
+            return (size_t) std::ceil ( std::min ( groups, (double) _child->getSize() ) );
+        }
         else {
             int sizeReduction = 512;
             for ( size_t i=1; i<_groupExpr.size() && sizeReduction > 2; i++ ) {
@@ -92,10 +110,16 @@ public:
     }
 
 
-    void updateAggregates ( ValueSet&               valuesTable, 
-                            std::vector < Expr*  >  aggExpr, 
-                            ValueSet&               aggVals,
-                            JitContextFlounder&     ctx ) {
+    virtual void resetState () {
+        _state->guard.reset();
+        clearHashTable ( _ht );
+    }
+
+
+    static void updateAggregates ( ValueSet&               valuesTable, 
+                                   std::vector < Expr*  >  aggExpr, 
+                                   ValueSet&               aggVals,
+                                   JitContextFlounder&     ctx ) {
 
         for ( size_t i = 0; i < valuesTable.size(); i++ ) {
             Value& accumulator = valuesTable[i];
@@ -250,7 +274,7 @@ public:
         size_t groupOffset = Values::byteSize ( groupVals, Values::htMatConfig.stringsByVal );
         ir_node* groupHash = Values::hash ( groupVals, ctx ); 
 
-        _ht = allocateHashTable ( getSize(), _entrySchema._tupSize );
+        _ht = allocateHashTable ( getSize() * 5 / 3, _entrySchema._tupSize );
 
         ir_node* htPtr = constLoad ( constAddress ( _ht ) );
         ir_node* htEntry = ctx.request ( vreg64 ( "htEntry" ) );
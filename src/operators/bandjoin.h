@@ -0,0 +1,185 @@
+/**
+ * @brief Band join operator.
+ * Joins two inputs on a pair of inequalities lo <= x <= hi with an integer
+ * attribute x of the left input and bounds lo and hi computed from the
+ * right input, e.g. for a.date between b.start and b.end. The left input
+ * is materialized and its tuples are ordered by x like for the merge join.
+ * Each right tuple locates the start of its range by binary search and
+ * then scans the ordered left tuples until they exceed the upper bound.
+ */
+class BandJoinOp : public RelOperator {
+
+public:
+
+    /* Lower bound (GE or GT) and upper bound (LE or LT) conditions with *
+     * the same attribute of the left child operator on the left side    *
+     * and an expression for the right child operator on the right side. */
+    Expr*       _lower;
+    Expr*       _upper;
+
+
+    /* Remember requested attributes to prune schema when the child operator's  *
+     * schemas are available in consume.                                        */
+    SymbolSet   _request;
+
+
+    /* state with the ordered left tuples during execution */
+    std::unique_ptr < MergeJoinState > _state;
+
+
+    /* end of the ordered left tuples */
+    ir_node*    _entriesEnd;
+
+
+    virtual std::string name() { return "BandJoin"; };
+
+
+    BandJoinOp ( Expr*         lower,
+                 Expr*         upper,
+                 RelOperator*  leftChild,
+                 RelOperator*  rightChild )
+         :  RelOperator ( RelOperator::BANDJOIN ),
+           _lower ( lower ),
+           _upper ( upper ) {
+
+        addChild ( new MaterializeOp ( leftChild ) );
+        addChild ( rightChild );
+    }
+
+
+    void defineExpressions ( ExpressionContext& ctx ) {
+        ctx.define ( _lower );
+        ctx.define ( _upper );
+    }
+
+
+    virtual size_t getSize () {
+        return _lChild->getSize() + _rChild->getSize();
+    }
+
+
+    virtual void resetState () {
+        _state->reset();
+    }
+
+
+    virtual void produceFlounder ( JitContextFlounder& ctx,
+                                   SymbolSet           request ) {
+
+        _request = request;
+        _state = std::make_unique < MergeJoinState > ( ctx.numThreads() );
+
+        Expr* leftKey = _lower->child;
+        if ( leftKey->tag != Expr::ATTRIBUTE ) {
+            throw ResqlError ( "Band join needs an attribute as left key." );
+        }
+
+        SymbolSet lowerReq = extractRequiredAttributes ( _lower );
+        SymbolSet upperReq = extractRequiredAttributes ( _upper );
+        SymbolSet joinReq  = symbolSetUnion ( lowerReq, upperReq );
+        SymbolSet allReq   = symbolSetUnion ( _request, joinReq );
+
+        _lChild->produceFlounder ( ctx, allReq );
+
+        /* locate key in materialized left tuples */
+        MaterializeOp* build = (MaterializeOp*) _lChild;
+        Schema& buildSchema = build->relOut->_schema;
+        _state->_build     = build->relOut.get();
+        _state->_keyType   = buildSchema.getTypeByName ( leftKey->symbol );
+        _state->_keyOffset = buildSchema.getOffsetInTuple ( leftKey->symbol );
+        if ( !MergeJoinOp::isMergeKeyType ( _state->_keyType ) ) {
+            throw ResqlError ( "Band join only supports integer keys." );
+        }
+
+        ir_node* foo = vreg64 ( "foo_prepare" );
+        ctx.request ( foo );
+        ctx.yield ( mcall1 ( foo, (void*) &MergeJoinState::prepare, constAddress ( _state.get() ) ) );
+        ctx.clear ( foo );
+
+        _rChild->produceFlounder ( ctx, allReq );
+    }
+
+
+    /* Evaluates a bound and widens it to 64 bit */
+    ir_node* emitBound ( JitContextFlounder& ctx, Expr* bound, const char* name ) {
+        ExprVec exprs = { bound->child->next };
+        ValueSet vals = evalExpressions ( exprs, ctx );
+        if ( !MergeJoinOp::isMergeKeyType ( vals[0].type ) ) {
+            throw ResqlError ( "Band join only supports integer keys." );
+        }
+        ir_node* res = ctx.request ( vreg64 ( name ) );
+        if ( vals[0].type.tag == SqlType::BIGINT ) {
+            ctx.yield ( mov ( res, vals[0].node ) );
+        }
+        else {
+            ctx.yield ( movsxd ( res, vals[0].node ) );
+        }
+        Values::clear ( vals, ctx );
+        return res;
+    }
+
+
+    virtual void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Band join probe" );
+
+        _schema = _lChild->_schema.join ( _rChild->_schema );
+        if ( ! ctx.requestAll ) {
+            _schema = _schema.prune ( _request );
+        }
+
+        ir_node* stateAddr = constAddress ( _state.get() );
+        _entriesEnd = vreg64 ( "bandEntriesEnd" );
+        ctx.yieldPipeHead ( request ( _entriesEnd ) );
+        ctx.yieldPipeHead ( mcall1 ( _entriesEnd, (void*) &MergeJoinState::end, stateAddr ) );
+
+        /* Evaluate the bounds, strict lower bounds are integer successors */
+        ir_node* lowerKey = emitBound ( ctx, _lower, "lowerKey" );
+        ir_node* upperKey = emitBound ( ctx, _upper, "upperKey" );
+        if ( _lower->tag == Expr::GT ) {
+            ctx.yield ( add ( lowerKey, constInt64 ( 1 ) ) );
+        }
+
+        /* Move to the first entry in the range */
+        ir_node* entry = ctx.request ( vreg64 ( "bandEntry" ) );
+        ctx.yield ( mcall2 ( entry, (void*) &MergeJoinState::lowerBound, stateAddr, lowerKey ) );
+        ctx.clear ( lowerKey );
+
+        /* Loop over entries with keys in the range */
+        WhileLoop whileLoop = WhileTrue ( ctx.codeTree ); {
+
+            /* update jump label for succeeding operators */
+            ctx.labelNextTuple = whileLoop.headLabel;
+
+            breakWhile ( whileLoop, isLargerEqual ( entry, _entriesEnd ) );
+            ir_node* entryKey = ctx.request ( vreg64 ( "entryKey" ) );
+            ctx.yield ( mov ( entryKey, Values::offsetMemAt ( entry, offsetof ( MergeJoinEntry, key ) ) ) );
+            if ( _upper->tag == Expr::LT ) {
+                breakWhile ( whileLoop, isLargerEqual ( entryKey, upperKey ) );
+            }
+            else {
+                breakWhile ( whileLoop, isLarger ( entryKey, upperKey ) );
+            }
+            ctx.clear ( entryKey );
+
+            /* Dematerialize the left tuple and step to the next entry */
+            ir_node* tuple = ctx.request ( vreg64 ( "bandTuple" ) );
+            ctx.yield ( mov ( tuple, Values::offsetMemAt ( entry, offsetof ( MergeJoinEntry, tuple ) ) ) );
+            ctx.yield ( add ( entry, constInt64 ( sizeof ( MergeJoinEntry ) ) ) );
+            ValueSet entryValues = Values::dematerialize ( tuple, _lChild->_schema, Values::relationMatConfig, ctx );
+            Values::addSymbols ( ctx, entryValues );
+            ctx.clear ( tuple );
+
+            /* Code from parent operator */
+            _parent->consumeFlounder ( ctx );
+
+            Values::clear ( entryValues, ctx );
+
+        } closeWhile ( whileLoop );
+
+        ctx.clear ( entry );
+        ctx.clear ( upperKey );
+
+        ctx.yieldPipeFoot ( clear ( _entriesEnd ) );
+    }
+};
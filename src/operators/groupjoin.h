@@ -0,0 +1,394 @@
+#include <barrier>
+
+
+
+struct GroupJoinState {
+
+    /* synchronization point after build is finished */
+    std::barrier<> _syncPointBuild;
+
+    /* accumulator updates during the probe are single threaded */
+    SingleThreadGuard guard;
+
+    GroupJoinState ( size_t numThreads ) : _syncPointBuild ( numThreads ),
+                                           guard ( numThreads ) {}
+
+    static void syncBuild ( GroupJoinState* state ) {
+        state->_syncPointBuild.arrive_and_wait();
+    }
+
+};
+
+
+
+/**
+ * @brief Groupjoin operator.
+ * Fuses a hash join with a grouped aggregation on the join key. The build
+ * side hash table entries hold the aggregate accumulators, which are updated
+ * in place during the probe. This saves the second hash table, hash
+ * computation and probe of a separate AggregationOp.
+ *
+ * Requires the build keys to be unique, i.e. each build tuple forms its own
+ * group. The grouping expressions have to be computable from the build side
+ * or be probe attributes that are equated with build attributes by one of
+ * the equalities. Groups without join partner are not part of the result.
+ */
+class GroupJoinOp : public RelOperator {
+
+public:
+
+    /* Aggregation expressions, e.g. sum(l_extendedprice) */
+    ExprVec     _aggExpr;
+
+
+    /* Same as _aggExpr with averages split up into sum and count */
+    ExprVec     _splitAggExpr;
+
+
+    /* Grouping expressions as requested by the query */
+    ExprVec     _groupExpr;
+
+
+    /* Grouping expressions evaluated on the build side. Probe side  *
+     * attributes are replaced by their build side equivalent.       */
+    ExprVec     _buildGroupExpr;
+
+
+    /* Equality conditions with build attributes on the left side and *
+     * probe attributes on the right side (same as for HashJoinOp).   */
+    ExprVec     _equalities;
+
+
+    /* Groupjoin hash table. Each entry holds:                       *
+     *  [ build keys | groups | build values | matches | aggregates ] */
+    HashTable*  _ht = nullptr;
+    ir_node*    _htAddr = nullptr;
+
+
+    /* Schemas of the entry segments */
+    Schema      _schemaBuildKeys;
+    Schema      _schemaGroups;
+    Schema      _schemaBuildValues;
+    Schema      _schemaAggregates;
+
+
+    /* Offsets of the entry segments */
+    size_t      _groupOffset = 0;
+    size_t      _buildValuesOffset = 0;
+    size_t      _matchesOffset = 0;
+    size_t      _aggregatesOffset = 0;
+
+
+    /* Number of times consumeFlounder(..) was called. Used to distinguish *
+     * between call from left child (first) and right child (second).      */
+    int         _nCall = 0;
+
+
+    /* state that concerns the groupjoin during execution */
+    std::unique_ptr < GroupJoinState > _state;
+
+
+    virtual std::string name() { return "GroupJoin"; };
+
+
+    GroupJoinOp ( ExprVec       aggExpr,
+                  ExprVec       groupExpr,
+                  ExprVec       equalities,
+                  RelOperator*  leftChild,
+                  RelOperator*  rightChild )
+         :  RelOperator ( RelOperator::GROUPJOIN ),
+            _aggExpr ( aggExpr ),
+            _groupExpr ( groupExpr ),
+            _equalities ( equalities )
+    {
+        addChild ( leftChild );
+        addChild ( rightChild );
+        _buildGroupExpr = buildSideGroupExpressions ( _groupExpr, _equalities );
+    }
+
+
+    virtual ~GroupJoinOp() {
+        if ( _ht != nullptr ) {
+            freeHashTable ( _ht );
+        }
+    }
+
+
+    /* Map probe attributes in the groups to the build attribute that *
+     * they are equated with.                                         */
+    static ExprVec buildSideGroupExpressions ( ExprVec&  groupExpr,
+                                               ExprVec&  equalities ) {
+        ExprVec res;
+        for ( auto grp : groupExpr ) {
+            Expr* buildGrp = grp;
+            if ( grp->tag == Expr::ATTRIBUTE ) {
+                for ( auto eq : equalities ) {
+                    Expr* left  = eq->child;
+                    Expr* right = eq->child->next;
+                    if ( right->tag == Expr::ATTRIBUTE &&
+                         left->tag  == Expr::ATTRIBUTE &&
+                         right->symbol == grp->symbol ) {
+                        buildGrp = ExprGen::attr ( left->symbol );
+                        break;
+                    }
+                }
+            }
+            res.push_back ( buildGrp );
+        }
+        return res;
+    }
+
+
+    void defineExpressions ( ExpressionContext& ctx ) {
+        _splitAggExpr = AggregationOp::splitAverages ( _aggExpr );
+        ctx.define ( _equalities );
+        ctx.define ( _buildGroupExpr );
+        ctx.define ( _splitAggExpr );
+        ctx.define ( _aggExpr );
+    }
+
+
+    virtual size_t getSize () {
+        return _lChild->getSize();
+    }
+
+
+    virtual void resetState () {
+        _state->guard.reset();
+        clearHashTable ( _ht );
+    }
+
+
+    virtual void produceFlounder ( JitContextFlounder& ctx,
+                                   SymbolSet           request ) {
+
+        _state = std::make_unique < GroupJoinState > ( ctx.numThreads() );
+
+        SymbolSet joinReq  = extractRequiredAttributes ( _equalities );
+        SymbolSet groupReq = extractRequiredAttributes ( _buildGroupExpr );
+        SymbolSet aggReq   = extractRequiredAttributes ( _aggExpr );
+        SymbolSet allReq   = symbolSetUnion ( joinReq, groupReq );
+        allReq = symbolSetUnion ( allReq, aggReq );
+
+        _lChild->produceFlounder ( ctx, allReq );
+
+        ir_node* foo = vreg64 ( "foo_sync" );
+        ctx.request ( foo );
+        ctx.yield ( mcall1 ( foo, (void*) &_state->syncBuild, constAddress ( _state.get() ) ) );
+        ctx.clear ( foo );
+
+        _rChild->produceFlounder ( ctx, allReq );
+
+        this->consumeGroupsFlounder ( ctx );
+    }
+
+
+    /* Build attributes that are used as aggregation inputs */
+    Schema buildValuesSchema ( ) {
+        SymbolSet aggReq = extractRequiredAttributes ( _aggExpr );
+        std::vector < Attribute > atts;
+        for ( auto& a : _lChild->_schema._attribs ) {
+            if ( aggReq.find ( a.name ) != aggReq.end() ) {
+                atts.push_back ( a );
+            }
+        }
+        return Schema ( atts, Values::htMatConfig.stringsByVal );
+    }
+
+
+    virtual void consumeBuildFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Groupjoin build" );
+
+        /* prepare hash build keys, groups and build values */
+        auto left = equalitiesLeftSide ( _equalities );
+        ValueSet buildKeys = evalExpressions ( left, ctx );
+        ValueSet groupVals = evalExpressions ( _buildGroupExpr, ctx );
+        for ( size_t i = 0; i < groupVals.size(); i++ ) {
+            addExpressionIds ( _groupExpr[i], &ctx.rel );
+            groupVals[i].symbol = getExpressionName ( _groupExpr[i] );
+        }
+        _schemaBuildValues = buildValuesSchema ( );
+        ValueSet buildVals = Values::get ( _schemaBuildValues, ctx );
+
+        /* compute entry layout */
+        bool byVal = Values::htMatConfig.stringsByVal;
+        _schemaBuildKeys   = Values::schema ( buildKeys, byVal );
+        _schemaGroups      = Values::schema ( groupVals, byVal );
+        _groupOffset       = _schemaBuildKeys._tupSize;
+        _buildValuesOffset = _groupOffset + _schemaGroups._tupSize;
+        _matchesOffset     = _buildValuesOffset + _schemaBuildValues._tupSize;
+        _aggregatesOffset  = _matchesOffset + sizeof ( int64_t );
+
+        /* the aggregate schema is only known after types were derived */
+        std::vector < Attribute > aggAtts;
+        for ( auto e : _splitAggExpr ) {
+            addExpressionIds ( e, &ctx.rel );
+            aggAtts.push_back ( { getExpressionName ( e ), e->type } );
+        }
+        _schemaAggregates = Schema ( aggAtts, byVal );
+
+        /* allocate hash table */
+        size_t entrySize = _aggregatesOffset + _schemaAggregates._tupSize;
+        _ht = allocateHashTable ( _lChild->getSize() * 5 / 3, entrySize );
+        _htAddr = constAddress ( _ht );
+
+        /* hash build keys and insert the hash */
+        ir_node* buildHash = Values::hash ( buildKeys, ctx );
+        ir_node* htEntry = ctx.request ( vreg64 ( "htEntry" ) );
+        ctx.yield ( mcall2 ( htEntry, (void*)&ht_put, _htAddr, buildHash ) );
+        ctx.clear ( buildHash );
+
+        /* Materialize keys, groups and build values */
+        Values::materialize ( buildKeys, htEntry, Values::htMatConfig, ctx );
+        Values::clear ( buildKeys, ctx );
+        ctx.yield ( add ( htEntry, constInt64 ( _groupOffset ) ) );
+        Values::materialize ( groupVals, htEntry, Values::htMatConfig, ctx );
+        Values::clear ( groupVals, ctx );
+        ctx.yield ( add ( htEntry, constInt64 ( _buildValuesOffset - _groupOffset ) ) );
+        Values::materialize ( buildVals, htEntry, Values::htMatConfig, ctx );
+
+        /* Group has no matches yet */
+        ir_node* zero = ctx.request ( vreg64 ( "zero" ) );
+        ctx.yield ( mov ( zero, constInt64 ( 0 ) ) );
+        ctx.yield ( mov ( Values::offsetMemAt ( htEntry, _matchesOffset - _buildValuesOffset ), zero ) );
+        ctx.clear ( zero );
+        ctx.clear ( htEntry );
+    }
+
+
+    virtual void consumeProbeFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Groupjoin probe" );
+
+        _state->guard.open ( ctx.pipeHeader );
+
+        /* Evaluate hash probe keys and hash them */
+        ExprVec right = equalitiesRightSide ( _equalities );
+        ValueSet probeKeys = evalExpressions ( right, ctx );
+        ir_node* probeHash = Values::hash ( probeKeys, ctx );
+
+        /* Find the (unique) matching build entry */
+        ir_node* htProbeEntry = ctx.request ( vreg64 ( "htProbeEntry" ) );
+        ctx.yield ( mov ( htProbeEntry, constAddress ( nullptr ) ) );
+        ir_node* foundMatch = idLabel ( "foundMatch" );
+        WhileLoop whileLoop = WhileTrue ( ctx.codeTree ); {
+            ctx.yield ( mcall3 ( htProbeEntry, (void*) &ht_get, _htAddr, probeHash, htProbeEntry ) );
+            ctx.yield ( cmp ( htProbeEntry, constAddress ( nullptr ) ) );
+            ctx.yield ( je ( ctx.labelNextTuple ) );
+            ValueSet entryKeys = Values::dematerialize ( htProbeEntry, _schemaBuildKeys, Values::htMatConfig, ctx );
+            Values::checkEqualityJumpIfTrue ( probeKeys, entryKeys, foundMatch, ctx );
+            Values::clear ( entryKeys, ctx );
+        } closeWhile ( whileLoop );
+        ctx.clear ( probeHash );
+        Values::clear ( probeKeys, ctx );
+        ctx.yield ( placeLabel ( foundMatch ) );
+
+        /* Make build values available to the aggregation inputs */
+        ctx.yield ( add ( htProbeEntry, constInt64 ( _buildValuesOffset ) ) );
+        ValueSet buildVals = Values::dematerialize ( htProbeEntry, _schemaBuildValues, Values::htMatConfig, ctx );
+        Values::addSymbols ( ctx, buildVals );
+        ValueSet aggVals = evalExpressions ( _splitAggExpr, ctx );
+        Values::clear ( buildVals, ctx );
+
+        /* Move to the accumulators and read the number of matches */
+        ctx.yield ( add ( htProbeEntry, constInt64 ( _aggregatesOffset - _buildValuesOffset ) ) );
+        ir_node* matches = ctx.request ( vreg64 ( "matches" ) );
+        ctx.yield ( mov ( matches, memAtSub ( htProbeEntry, constInt64 ( sizeof ( int64_t ) ) ) ) );
+
+        /* first match - initialize accumulators */
+        IfClause if1 = If ( isEqual ( matches, constInt64 ( 0 ) ), ctx.codeTree ); {
+            Values::MaterializeConfig mConf = { Values::htMatConfig.stringsByVal, false };
+            Values::materialize ( aggVals, htProbeEntry, mConf, ctx );
+        } closeIf ( if1 );
+
+        /* further matches - update accumulators */
+        IfClause if2 = If ( isNotEqual ( matches, constInt64 ( 0 ) ), ctx.codeTree ); {
+            ValueSet accumulators = Values::dematerialize ( htProbeEntry, aggVals, Values::htMatConfig, ctx );
+            AggregationOp::updateAggregates ( accumulators, _splitAggExpr, aggVals, ctx );
+            Values::materialize ( accumulators, htProbeEntry, Values::htMatConfig, ctx );
+            Values::clear ( accumulators, ctx );
+        } closeIf ( if2 );
+        Values::clear ( aggVals, ctx );
+
+        ctx.yield ( inc ( matches ) );
+        ctx.yield ( mov ( memAtSub ( htProbeEntry, constInt64 ( sizeof ( int64_t ) ) ), matches ) );
+        ctx.clear ( matches );
+        ctx.clear ( htProbeEntry );
+    }
+
+
+    virtual void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        _nCall++;
+
+        if ( _nCall > 2 ) {
+            error_msg ( CODEGEN_ERROR, "GroupJoin::consumeFlounder(..) called"
+                                       " more than 2 times." );
+        }
+
+        if ( _nCall == 1 ) {
+            consumeBuildFlounder ( ctx );
+        }
+        else if ( _nCall == 2 ) {
+            consumeProbeFlounder ( ctx );
+        }
+    }
+
+
+    virtual void consumeGroupsFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Scan groupjoin hash table" );
+
+        if ( ctx.rel.innerScanCount == 0 ) {
+            ctx.openPipeline();
+        }
+
+        /* Scan hash table */
+        ScanLoop scan = openScanLoop ( memAt ( constLoad ( constAddress ( &_ht->entries ) ) ),
+                                       memAt ( constLoad ( constAddress ( &_ht->entriesEnd ) ) ),
+                                       _ht->fullEntrySize,
+                                       ctx ); {
+
+            /* Skip empty buckets and groups without join partner */
+            ir_node* entryStatus = ctx.request ( vreg8 ( "htEntryStatus" ) );
+            ctx.yield ( mov ( entryStatus, memAt ( scan.tupleCursor ) ) );
+            ctx.yield ( cmp ( entryStatus, constInt8 ( 0 ) ) );
+            ctx.yield ( je ( scan.nextTuple ) );
+            ctx.clear ( entryStatus );
+            ir_node* tupleAddr = ctx.request ( vreg64 ( "tupleAddr" ) );
+            ctx.yield ( mov ( tupleAddr, constInt64 ( sizeof ( Entry ) ) ) );
+            ctx.yield ( add ( tupleAddr, scan.tupleCursor ) );
+            ir_node* matches = ctx.request ( vreg64 ( "matches" ) );
+            ctx.yield ( mov ( matches, Values::offsetMemAt ( tupleAddr, _matchesOffset ) ) );
+            ctx.yield ( cmp ( matches, constInt64 ( 0 ) ) );
+            ctx.yield ( je ( scan.nextTuple ) );
+            ctx.clear ( matches );
+
+            /* Dematerialize groups and aggregates */
+            ir_node* groupAddr = ctx.request ( vreg64 ( "groupAddr" ) );
+            Values::getOffset ( groupAddr, tupleAddr, _groupOffset, ctx );
+            ValueSet tableValues = Values::dematerialize ( groupAddr, _schemaGroups, Values::htMatConfig, ctx );
+            ctx.clear ( groupAddr );
+            ctx.yield ( add ( tupleAddr, constInt64 ( _aggregatesOffset ) ) );
+            ValueSet aggValues = Values::dematerialize ( tupleAddr, _schemaAggregates, Values::htMatConfig, ctx );
+            tableValues.insert ( tableValues.end(), aggValues.begin(), aggValues.end() );
+            ValueSet groupsAndAggregates = AggregationOp::mergeAverages ( _aggExpr, tableValues, _groupExpr.size(), ctx );
+            _schema = Values::schema ( groupsAndAggregates, true );
+
+            Values::addSymbols ( ctx, groupsAndAggregates );
+
+            _parent->consumeFlounder ( ctx );
+
+            Values::clear ( groupsAndAggregates, ctx );
+            ctx.clear ( tupleAddr );
+
+        } closeScanLoop ( scan, ctx );
+
+        _state->guard.close ( ctx.pipeFooter );
+
+        if ( ctx.rel.innerScanCount == 0 ) {
+            ctx.closePipeline();
+        }
+    }
+};
@@ -1,22 +1,129 @@
-#include <latch>
+#include <barrier>
+#include <deque>
 
 
+/* Build entries of a hash join that one thread staged before the hash *
+ * table is sized. Each entry holds the hash followed by the payload.  */
+struct HashBuildBuffer {
+
+    static constexpr size_t ChunkEntries = 4096;
+
+    size_t _entrySize;
+    size_t _count = 0;
+    std::vector < std::unique_ptr < Data[] > > _chunks;
+
+
+    HashBuildBuffer ( size_t payloadSize ) : _entrySize ( sizeof ( uint64_t ) + payloadSize ) {}
+
+
+    Data* entry ( size_t i ) {
+        return _chunks [ i / ChunkEntries ].get() + ( i % ChunkEntries ) * _entrySize;
+    }
+
+
+    /* Returns the payload address of a new entry */
+    static Data* put ( HashBuildBuffer* buffer, uint64_t hash ) {
+        if ( buffer->_count % ChunkEntries == 0 ) {
+            buffer->_chunks.emplace_back ( new Data [ ChunkEntries * buffer->_entrySize ] );
+        }
+        Data* entry = buffer->entry ( buffer->_count++ );
+        *(uint64_t*) entry = hash;
+        return entry + sizeof ( uint64_t );
+    }
+};
+
 
 struct HashJoinState {
 
+    /* join hash table that is sized when the build is finished */
+    HashTable* _ht = nullptr;
+
+    /* build entries staged by the threads */
+    std::deque < HashBuildBuffer > _buffers;
+    std::mutex _buffersMutex;
+    std::atomic < size_t > _nextFillBuffer = 0;
+
     /* synchronization point after build is finished */
-    std::latch _syncPointBuild;
+    std::barrier<> _syncPointBuild;
+
+    /* synchronization point after the hash table is sized and filled */
+    std::barrier<> _syncPointSized;
+    std::barrier<> _syncPointFilled;
+
+    std::atomic < bool > _sizeFlag = true;
 
-    HashJoinState ( size_t numThreads ) : _syncPointBuild ( numThreads ) {} 
+    HashJoinState ( size_t numThreads ) : _syncPointBuild ( numThreads ),
+                                          _syncPointSized ( numThreads ),
+                                          _syncPointFilled ( numThreads ) {} 
 
+
+    static HashBuildBuffer* buildBuffer ( HashJoinState* state ) {
+        const std::lock_guard < std::mutex > lock ( state->_buffersMutex );
+        return &state->_buffers.emplace_back ( state->_ht->payloadSize );
+    }
+
+
+    /* Sizes the hash table for the build entries of all threads with the *
+     * first thread. Then the threads insert the staged entries together.  */
     static void syncBuild ( HashJoinState* state ) {
         state->_syncPointBuild.arrive_and_wait();
+        bool expected = true;
+        if ( state->_sizeFlag.compare_exchange_strong ( expected, false ) ) {
+            size_t numEntries = 0;
+            for ( auto& buffer : state->_buffers ) {
+                numEntries += buffer._count;
+            }
+            reserveHashTable ( state->_ht, numEntries * 5 / 3 );
+        }
+        state->_syncPointSized.arrive_and_wait();
+
+        size_t payloadSize = state->_ht->payloadSize;
+        size_t b;
+        while ( ( b = state->_nextFillBuffer.fetch_add ( 1 ) ) < state->_buffers.size() ) {
+            HashBuildBuffer& buffer = state->_buffers [ b ];
+            for ( size_t i = 0; i < buffer._count; i++ ) {
+                Data* entry = buffer.entry ( i );
+                Data* payload = ht_put ( state->_ht, *(uint64_t*) entry );
+                memcpy ( payload, entry + sizeof ( uint64_t ), payloadSize );
+            }
+            buffer._chunks.clear();
+        }
+        state->_syncPointFilled.arrive_and_wait();
+    }
+
+
+    /* The hash table is sized again by the next build */
+    void reset () {
+        _buffers.clear();
+        _nextFillBuffer = 0;
+        _sizeFlag = true;
     }
 
 };
 
 
- 
+/* Allocates the hash table with the entry size of the build side. The *
+ * build pipeline stages its entries in a buffer per thread and returns *
+ * the payload address of the staged entry.                             */
+ir_node* emitHashBuildEntry ( HashJoinState*       state,
+                              size_t               entrySize,
+                              ir_node*             buildHash,
+                              JitContextFlounder&  ctx ) {
+
+    state->_ht = allocateHashTable ( 0, entrySize );
+
+    ir_node* buffer = vreg64 ( "htBuildBuffer" );
+    ctx.yieldPipeHead ( request ( buffer ) );
+    ctx.yieldPipeHead ( mcall1 ( buffer, (void*) &HashJoinState::buildBuffer, constAddress ( state ) ) );
+    ctx.yieldPipeFoot ( clear ( buffer ) );
+
+    ir_node* htEntry = ctx.request ( vreg64 ( "htEntry" ) );
+    ctx.yield ( mcall2 ( htEntry, (void*) &HashBuildBuffer::put, buffer, buildHash ) );
+    return htEntry;
+}
+
+
+
 /**
  * @brief Hash Join operator.
  */
@@ -81,7 +188,9 @@ public:
 
     
     virtual ~HashJoinOp() {
-        freeHashTable ( _ht );
+        if ( _ht != nullptr ) {
+            freeHashTable ( _ht );
+        }
     }
     
 
@@ -91,8 +200,17 @@ public:
 
     
     virtual size_t getSize () {
+        /* each probe tuple matches at most once */
+        if ( _singleMatch ) {
+            return _rChild->getSize();
+        }
         return _lChild->getSize() + _rChild->getSize() / 2;
     }
+
+
+    virtual void resetState () {
+        _state->reset();
+    }
     
     
     virtual void produceFlounder ( JitContextFlounder& ctx,
@@ -188,8 +306,9 @@ public:
              * check match with probe keys        */
             ValueSet entryKeys = Values::dematerialize ( htProbeEntry, _schemaBuildKeys, Values::htMatConfig, ctx );
             entryKeysByteSize = Values::byteSize ( entryKeys, Values::htMatConfig.stringsByVal );
-            Values::checkEqualityJumpIfTrue ( probeKeys, entryKeys, foundMatch, ctx );
+            Values::checkEqualityJump ( probeKeys, entryKeys, whileLoop.headLabel, ctx );
             Values::clear ( entryKeys, ctx );
+            ctx.yield ( jmp ( foundMatch ) );
         
         } closeWhile ( whileLoop );
         ctx.clear ( probeHash );
@@ -232,15 +351,13 @@ public:
             _schemaBuildKeys = Values::schema ( buildKeys, Values::htMatConfig.stringsByVal );
             ValueSet buildVals = Values::get ( _lChild->_schema, ctx ); 
 
-            /* allocate hash table */
+            /* hash build keys and stage the entry. The hash table is *
+             * sized for the staged entries when the build finished.  */
             size_t entrySize = Values::schema ( buildKeys, buildVals, Values::htMatConfig.stringsByVal )._tupSize;
-            _ht = allocateHashTable ( _lChild->getSize() * 5 / 3, entrySize ); 
-            _htAddr = constAddress ( _ht );
-
-            /* hash build keys and insert the hash */
             ir_node* buildHash = Values::hash ( buildKeys, ctx ); 
-            ir_node* htEntry = ctx.request ( vreg64 ( "htEntry" ) );
-            ctx.yield ( mcall2 ( htEntry, (void*)&ht_put, _htAddr, buildHash ) );
+            ir_node* htEntry = emitHashBuildEntry ( _state.get(), entrySize, buildHash, ctx );
+            _ht = _state->_ht;
+            _htAddr = constAddress ( _ht );
             ctx.clear ( buildHash );
 
             /* Materialize build keys into hash table *
@@ -53,7 +53,22 @@ public:
     void addLimit ( size_t limit ) {
         _hasLimitClause = true;
         _limit = limit;
-    } 
+    }
+
+
+    /* Empties the output relation in place, other operator states may *
+     * refer to it. A retrieved result is replaced by a new relation.   */
+    virtual void resetState () {
+        if ( _nCall == 0 ) return;
+        if ( relOut ) {
+            *relOut = Relation ( _schema );
+        }
+        else {
+            relOut = std::make_unique < Relation > ( _schema );
+        }
+        _appendIt = Relation::AppendIterator ( relOut.get() );
+        _readIt = Relation::ReadIterator ( relOut.get() );
+    }
 
     
     virtual size_t getSize () { 
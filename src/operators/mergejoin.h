@@ -0,0 +1,304 @@
+#include <barrier>
+
+
+struct MergeJoinEntry {
+    int64_t  key;
+    Data*    tuple;
+};
+
+
+struct MergeJoinState {
+
+    /* left tuples ordered by join key */
+    std::vector < MergeJoinEntry > _entries;
+
+    /* materialized left input */
+    Relation* _build;
+
+    /* location of the left join key in the materialized tuples */
+    size_t _keyOffset;
+    SqlType _keyType;
+
+    /* all threads materialized the left input */
+    std::barrier<> _syncBuild;
+
+    /* the entries are ordered before probing */
+    std::barrier<> _syncPrepare;
+
+    std::atomic < bool > _prepareFlag = true;
+
+
+    MergeJoinState ( size_t numThreads )
+        : _syncBuild ( numThreads ), _syncPrepare ( numThreads ) {}
+
+
+    /* Waits for the left input and orders its entries with the first thread. *
+     * With one thread a left input clustered by its key is already ordered.  */
+    static void prepare ( MergeJoinState* state ) {
+
+        state->_syncBuild.arrive_and_wait();
+        bool expected = true;
+        if ( state->_prepareFlag.compare_exchange_strong ( expected, false ) ) {
+            state->fillEntries();
+            auto keyOrder = [] ( const MergeJoinEntry& a, const MergeJoinEntry& b ) {
+                return a.key < b.key;
+            };
+            if ( !std::is_sorted ( state->_entries.begin(), state->_entries.end(), keyOrder ) ) {
+                std::sort ( state->_entries.begin(), state->_entries.end(), keyOrder );
+            }
+        }
+        state->_syncPrepare.arrive_and_wait();
+    }
+
+
+    void fillEntries () {
+        size_t tupSize = _build->_schema._tupSize;
+        _entries.reserve ( _build->tupleNum() );
+        for ( auto& block : _build->_dataBlocks ) {
+            for ( Data* tuple = block->begin(); tuple < block->end(); tuple += tupSize ) {
+                int64_t key;
+                if ( _keyType.tag == SqlType::BIGINT ) {
+                    key = *(int64_t*) ( tuple + _keyOffset );
+                }
+                else {
+                    key = *(int32_t*) ( tuple + _keyOffset );
+                }
+                _entries.push_back ( { key, tuple } );
+            }
+        }
+    }
+
+
+    /* The entries are filled again from the next left input */
+    void reset () {
+        _entries.clear();
+        _prepareFlag = true;
+    }
+
+
+    static MergeJoinEntry* begin ( MergeJoinState* state ) {
+        return state->_entries.data();
+    }
+
+
+    static MergeJoinEntry* end ( MergeJoinState* state ) {
+        return state->_entries.data() + state->_entries.size();
+    }
+
+
+    /* Returns the first entry with a key not less than key. The search    *
+     * continues at cursor, i.e. the result of the previous probe. Within  *
+     * an ordered morsel the cursor only moves forward with galloping      *
+     * steps. The first probe of each morsel, or any probe that moves      *
+     * backwards, repositions the cursor by binary search on the keys.     */
+    static MergeJoinEntry* seek ( MergeJoinState*  state,
+                                  MergeJoinEntry*  cursor,
+                                  int64_t          key ) {
+
+        auto keyLess = [] ( const MergeJoinEntry& e, int64_t k ) {
+            return e.key < k;
+        };
+        MergeJoinEntry* first = begin ( state );
+        MergeJoinEntry* last  = end ( state );
+        if ( cursor == last || cursor->key > key ) {
+            return std::lower_bound ( first, cursor, key, keyLess );
+        }
+        size_t step = 1;
+        while ( (size_t) ( last - cursor ) > step && cursor [ step ].key < key ) {
+            cursor += step;
+            step *= 2;
+        }
+        MergeJoinEntry* bound = (size_t) ( last - cursor ) > step ? cursor + step + 1 : last;
+        return std::lower_bound ( cursor, bound, key, keyLess );
+    }
+
+
+    /* Returns the first entry with a key not less than key */
+    static MergeJoinEntry* lowerBound ( MergeJoinState*  state,
+                                        int64_t          key ) {
+
+        auto keyLess = [] ( const MergeJoinEntry& e, int64_t k ) {
+            return e.key < k;
+        };
+        return std::lower_bound ( begin ( state ), end ( state ), key, keyLess );
+    }
+
+};
+
+
+/**
+ * @brief Merge join operator.
+ * Joins two inputs on a single integer key equality. The left input is
+ * materialized and its tuples are ordered by key, which is a linear check
+ * when the input is clustered by the key. The right input is probed in
+ * its pipeline with a cursor into the ordered left tuples. The morsels of
+ * the right input are range partitions on its key when it is ordered too.
+ * Each thread positions its cursor on the key boundary of a morsel and then
+ * merges forward without a hash table.
+ */
+class MergeJoinOp : public RelOperator {
+
+public:
+
+    /* Equality condition with an attribute of the left child operator *
+     * on the left side and an expression for the right child operator *
+     * on the right side.                                              */
+    Expr*       _equality;
+
+
+    /* Remember requested attributes to prune schema when the child operator's  *
+     * schemas are available in consume.                                        */
+    SymbolSet   _request;
+
+
+    /* state that concerns the merge join during execution */
+    std::unique_ptr < MergeJoinState > _state;
+
+
+    /* cursor into the ordered left tuples and end of the tuples */
+    ir_node*    _cursor;
+    ir_node*    _entriesEnd;
+
+
+    virtual std::string name() { return "MergeJoin"; };
+
+
+    MergeJoinOp ( Expr*         equality,
+                  RelOperator*  leftChild,
+                  RelOperator*  rightChild )
+         :  RelOperator ( RelOperator::MERGEJOIN ),
+           _equality ( equality ) {
+
+        addChild ( new MaterializeOp ( leftChild ) );
+        addChild ( rightChild );
+    }
+
+
+    void defineExpressions ( ExpressionContext& ctx ) {
+        ctx.define ( _equality );
+    }
+
+
+    virtual size_t getSize () {
+        return _lChild->getSize() + _rChild->getSize() / 2;
+    }
+
+
+    virtual void resetState () {
+        _state->reset();
+    }
+
+
+    static bool isMergeKeyType ( SqlType type ) {
+        return type.tag == SqlType::INT
+            || type.tag == SqlType::DATE
+            || type.tag == SqlType::BIGINT;
+    }
+
+
+    virtual void produceFlounder ( JitContextFlounder& ctx,
+                                   SymbolSet           request ) {
+
+        _request = request;
+        _state = std::make_unique < MergeJoinState > ( ctx.numThreads() );
+
+        Expr* leftKey = _equality->child;
+        if ( leftKey->tag != Expr::ATTRIBUTE ) {
+            throw ResqlError ( "Merge join needs an attribute as left key." );
+        }
+
+        SymbolSet joinReq = extractRequiredAttributes ( _equality );
+        SymbolSet allReq  = symbolSetUnion ( _request, joinReq );
+
+        _lChild->produceFlounder ( ctx, allReq );
+
+        /* locate key in materialized left tuples */
+        MaterializeOp* build = (MaterializeOp*) _lChild;
+        Schema& buildSchema = build->relOut->_schema;
+        _state->_build     = build->relOut.get();
+        _state->_keyType   = buildSchema.getTypeByName ( leftKey->symbol );
+        _state->_keyOffset = buildSchema.getOffsetInTuple ( leftKey->symbol );
+        if ( !isMergeKeyType ( _state->_keyType ) ) {
+            throw ResqlError ( "Merge join only supports integer keys." );
+        }
+
+        ir_node* foo = vreg64 ( "foo_prepare" );
+        ctx.request ( foo );
+        ctx.yield ( mcall1 ( foo, (void*) &MergeJoinState::prepare, constAddress ( _state.get() ) ) );
+        ctx.clear ( foo );
+
+        _rChild->produceFlounder ( ctx, allReq );
+    }
+
+
+    virtual void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Merge join probe" );
+
+        _schema = _lChild->_schema.join ( _rChild->_schema );
+        if ( ! ctx.requestAll ) {
+            _schema = _schema.prune ( _request );
+        }
+
+        ir_node* stateAddr = constAddress ( _state.get() );
+        _cursor = vreg64 ( "mergeCursor" );
+        ctx.yieldPipeHead ( request ( _cursor ) );
+        ctx.yieldPipeHead ( mcall1 ( _cursor, (void*) &MergeJoinState::begin, stateAddr ) );
+        _entriesEnd = vreg64 ( "mergeEntriesEnd" );
+        ctx.yieldPipeHead ( request ( _entriesEnd ) );
+        ctx.yieldPipeHead ( mcall1 ( _entriesEnd, (void*) &MergeJoinState::end, stateAddr ) );
+
+        /* Evaluate probe key and widen it to 64 bit */
+        ExprVec right = { _equality->child->next };
+        ValueSet probeKeys = evalExpressions ( right, ctx );
+        if ( !isMergeKeyType ( probeKeys[0].type ) ) {
+            throw ResqlError ( "Merge join only supports integer keys." );
+        }
+        ir_node* probeKey = ctx.request ( vreg64 ( "probeKey" ) );
+        if ( probeKeys[0].type.tag == SqlType::BIGINT ) {
+            ctx.yield ( mov ( probeKey, probeKeys[0].node ) );
+        }
+        else {
+            ctx.yield ( movsxd ( probeKey, probeKeys[0].node ) );
+        }
+        Values::clear ( probeKeys, ctx );
+
+        /* Move cursor to the first candidate */
+        ctx.yield ( mcall3 ( _cursor, (void*) &MergeJoinState::seek, stateAddr, _cursor, probeKey ) );
+        ir_node* entry = ctx.request ( vreg64 ( "mergeEntry" ) );
+        ctx.yield ( mov ( entry, _cursor ) );
+
+        /* Loop over entries with matching keys */
+        WhileLoop whileLoop = WhileTrue ( ctx.codeTree ); {
+
+            /* update jump label for succeeding operators */
+            ctx.labelNextTuple = whileLoop.headLabel;
+
+            breakWhile ( whileLoop, isLargerEqual ( entry, _entriesEnd ) );
+            ir_node* entryKey = ctx.request ( vreg64 ( "entryKey" ) );
+            ctx.yield ( mov ( entryKey, Values::offsetMemAt ( entry, offsetof ( MergeJoinEntry, key ) ) ) );
+            breakWhile ( whileLoop, isNotEqual ( entryKey, probeKey ) );
+            ctx.clear ( entryKey );
+
+            /* Dematerialize the left tuple and step to the next entry */
+            ir_node* tuple = ctx.request ( vreg64 ( "mergeTuple" ) );
+            ctx.yield ( mov ( tuple, Values::offsetMemAt ( entry, offsetof ( MergeJoinEntry, tuple ) ) ) );
+            ctx.yield ( add ( entry, constInt64 ( sizeof ( MergeJoinEntry ) ) ) );
+            ValueSet entryValues = Values::dematerialize ( tuple, _lChild->_schema, Values::relationMatConfig, ctx );
+            Values::addSymbols ( ctx, entryValues );
+            ctx.clear ( tuple );
+
+            /* Code from parent operator */
+            _parent->consumeFlounder ( ctx );
+
+            Values::clear ( entryValues, ctx );
+
+        } closeWhile ( whileLoop );
+
+        ctx.clear ( entry );
+        ctx.clear ( probeKey );
+
+        ctx.yieldPipeFoot ( clear ( _entriesEnd ) );
+        ctx.yieldPipeFoot ( clear ( _cursor ) );
+    }
+};
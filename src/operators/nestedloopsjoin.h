@@ -1,35 +1,139 @@
+#include <barrier>
+
+
+struct NestedLoopsTile {
+    Data* begin;
+    Data* end;
+};
+
+
+struct NestedLoopsJoinState {
+
+    /* An outer and an inner tile fit into a 256 KB L2 cache together */
+    static constexpr size_t TileBytes = 112 << 10;
+
+    Relation* _inner;
+    Relation* _outer;
+
+    std::vector < NestedLoopsTile > _innerTiles;
+    std::vector < NestedLoopsTile > _outerTiles;
+
+    /* outer tiles are distributed across threads */
+    std::atomic < size_t > _nextOuterTile = 0;
+
+    /* all threads materialized the inputs */
+    std::barrier<> _syncInput;
+
+    /* the tiles are computed before joining */
+    std::barrier<> _syncTiles;
+
+    std::atomic < bool > _tileFlag = true;
+
+
+    NestedLoopsJoinState ( size_t numThreads )
+        : _syncInput ( numThreads ), _syncTiles ( numThreads ) {}
+
+
+    /* Waits for the inputs and splits them into tiles with the first thread */
+    static void prepare ( NestedLoopsJoinState* state ) {
+        state->_syncInput.arrive_and_wait();
+        bool expected = true;
+        if ( state->_tileFlag.compare_exchange_strong ( expected, false ) ) {
+            state->_innerTiles = tiles ( state->_inner );
+            state->_outerTiles = tiles ( state->_outer );
+        }
+        state->_syncTiles.arrive_and_wait();
+    }
+
+
+    /* The tiles are computed again from the next inputs */
+    void reset () {
+        _innerTiles.clear();
+        _outerTiles.clear();
+        _nextOuterTile = 0;
+        _tileFlag = true;
+    }
+
+
+    static std::vector < NestedLoopsTile > tiles ( Relation* rel ) {
+        size_t tupSize = rel->_schema._tupSize;
+        size_t tileSize = std::max ( TileBytes / tupSize, (size_t) 1 ) * tupSize;
+        std::vector < NestedLoopsTile > res;
+        for ( auto& block : rel->_dataBlocks ) {
+            for ( Data* begin = block->begin(); begin < block->end(); begin += tileSize ) {
+                res.push_back ( { begin, std::min ( begin + tileSize, block->end() ) } );
+            }
+        }
+        return res;
+    }
+
+
+    static NestedLoopsTile* nextOuterTile ( NestedLoopsJoinState* state ) {
+        size_t tile = state->_nextOuterTile.fetch_add ( 1 );
+        if ( tile >= state->_outerTiles.size() ) {
+            return nullptr;
+        }
+        return &state->_outerTiles [ tile ];
+    }
+
+
+    static NestedLoopsTile* innerTilesBegin ( NestedLoopsJoinState* state ) {
+        return state->_innerTiles.data();
+    }
+
+
+    static NestedLoopsTile* innerTilesEnd ( NestedLoopsJoinState* state ) {
+        return state->_innerTiles.data() + state->_innerTiles.size();
+    }
+};
+
 
 /**
- * @brief Join operator.
+ * @brief Block nested loops join operator.
+ * Both inputs are split into tiles that fit into the L2 cache. Threads take
+ * tiles of the outer (right) input and join each with all inner (left) tiles,
+ * so every tile pair is joined while both tiles are cached. The left input
+ * is only materialized when it is not a base table scan.
  */
 class NestedLoopsJoinOp : public RelOperator {
-    
+
 public:
 
     Expr* _condition;
-    bool _materializeInner;
 
-    // Number of times consumeFlounder(..) was called.    
-    int _nCall;
+    /* inner relation if the left child is a scan, otherwise materialized */
+    Relation* _innerRelation;
+
+    /* Remember requested attributes for the unmaterialized left child */
+    SymbolSet _request;
+
+    /* state that concerns the join during execution */
+    std::unique_ptr < NestedLoopsJoinState > _state;
 
 
     virtual std::string name() { return "NestedLoopsJoin"; };
 
 
-    NestedLoopsJoinOp ( Expr* condition, 
-                        RelOperator* leftChild, 
+    NestedLoopsJoinOp ( Expr* condition,
+                        RelOperator* leftChild,
                         RelOperator* rightChild )
         : RelOperator ( RelOperator::NESTEDLOOPSJOIN ),
           _condition ( condition ),
-          _nCall ( 0 ) {
+          _innerRelation ( nullptr ) {
 
-        addChild ( new MaterializeOp ( leftChild ) );
+        if ( leftChild->tag == RelOperator::SCAN ) {
+            _innerRelation = ((ScanOp*)leftChild)->_rel;
+            addChild ( leftChild );
+        }
+        else {
+            addChild ( new MaterializeOp ( leftChild ) );
+        }
         addChild ( new MaterializeOp ( rightChild ) );
     }
 
-    
+
     virtual ~NestedLoopsJoinOp() {}
-    
+
 
     void defineExpressions ( ExpressionContext& ctx ) {
         if ( _condition != nullptr ) {
@@ -37,13 +141,13 @@ public:
         }
     }
 
-    
+
     virtual size_t getSize () {
         size_t lSz = _lChild->getSize();
         size_t rSz = _rChild->getSize();
 
         if ( ( lSz + rSz ) <= 10000 ) {
-            return lSz * rSz; 
+            return lSz * rSz;
         }
         else {
             return ( lSz + rSz )  * 2;
@@ -51,44 +155,132 @@ public:
     }
 
 
+    virtual void resetState () {
+        _state->reset();
+    }
+
+
+    bool isScanInner () {
+        return _lChild->tag == RelOperator::SCAN;
+    }
+
+
     virtual void produceFlounder ( JitContextFlounder& ctx,
                                    SymbolSet           request ) {
 
-        _lChild->produceFlounder ( ctx, request );
-        _rChild->produceFlounder ( ctx, request );
+        _request = request;
+        if ( _condition != nullptr ) {
+            SymbolSet condReq = extractRequiredAttributes ( _condition );
+            _request = symbolSetUnion ( _request, condReq );
+        }
+        _state = std::make_unique < NestedLoopsJoinState > ( ctx.numThreads() );
+
+        if ( !isScanInner() ) {
+            _lChild->produceFlounder ( ctx, _request );
+            _innerRelation = ((MaterializeOp*)_lChild)->relOut.get();
+        }
+        _rChild->produceFlounder ( ctx, _request );
+        _state->_inner = _innerRelation;
+        _state->_outer = ((MaterializeOp*)_rChild)->relOut.get();
+
+        ir_node* foo = vreg64 ( "foo_tiles" );
+        ctx.request ( foo );
+        ctx.yield ( mcall1 ( foo, (void*) &NestedLoopsJoinState::prepare, constAddress ( _state.get() ) ) );
+        ctx.clear ( foo );
 
         if ( ctx.rel.innerScanCount == 0 ) {
             ctx.openPipeline();
-        } 
+        }
+
+        produceTileLoops ( ctx );
 
-        ((MaterializeOp*)_rChild)->produceScanTable ( ctx );
-        
         if ( ctx.rel.innerScanCount == 0 ) {
             ctx.closePipeline();
-        } 
+        }
     }
 
 
-    virtual void consumeFlounder ( JitContextFlounder& ctx ) {
+    void produceTileLoops ( JitContextFlounder& ctx ) {
 
-        _nCall++; 
+        ctx.comment ( " --- Nested loops join tiles" );
+        ir_node* stateAddr = constAddress ( _state.get() );
+        Schema& outerSchema = _state->_outer->_schema;
+        Schema& innerSchema = _innerRelation->_schema;
+        SymbolSet innerReq = ( isScanInner() && !ctx.requestAll ) ? _request : SymbolSet();
 
-        if ( _nCall == 1 ) {
-            ctx.rel.innerScanCount++;
-            ((MaterializeOp*)_lChild)->produceScanTable ( ctx, true );
-            ctx.rel.innerScanCount--;
-        }
-        else if ( _nCall == 2 ) {
-            _schema = _lChild->_schema.join ( _rChild->_schema );
-            if ( _condition != nullptr ) {
-                addExpressionIds ( _condition, &ctx.rel );
-                ir_node* conditionResult = emitExpression ( ctx, _condition ); 
-                ctx.yield ( cmp ( conditionResult, constInt8 ( 0 ) ) );
-                ctx.yield ( je ( ctx.labelNextTuple ) );        
-                ctx.clear ( conditionResult );
-            }
-            _parent->consumeFlounder ( ctx );
+        /* loop over outer tiles of this thread */
+        ir_node* outerTile = ctx.request ( vreg64 ( "outerTile" ) );
+        ctx.yield ( mcall1 ( outerTile, (void*) &NestedLoopsJoinState::nextOuterTile, stateAddr ) );
+        WhileLoop outerTileLoop = While ( isNotEqual ( outerTile, constAddress ( nullptr ) ), ctx.codeTree ); {
+
+            /* loop over all inner tiles */
+            ir_node* innerTile = ctx.request ( vreg64 ( "innerTile" ) );
+            ir_node* innerTilesEnd = ctx.request ( vreg64 ( "innerTilesEnd" ) );
+            ctx.yield ( mcall1 ( innerTile, (void*) &NestedLoopsJoinState::innerTilesBegin, stateAddr ) );
+            ctx.yield ( mcall1 ( innerTilesEnd, (void*) &NestedLoopsJoinState::innerTilesEnd, stateAddr ) );
+            WhileLoop innerTileLoop = While ( isSmaller ( innerTile, innerTilesEnd ), ctx.codeTree ); {
+
+                /* join the tile pair */
+                ScanLoop outerScan = openScanLoop ( Values::offsetMemAt ( outerTile, offsetof ( NestedLoopsTile, begin ) ),
+                                                    Values::offsetMemAt ( outerTile, offsetof ( NestedLoopsTile, end ) ),
+                                                    outerSchema._tupSize,
+                                                    ctx ); {
+
+                    ValueSet outerVals = Values::dematerialize ( outerScan.tupleCursor,
+                                                                 outerSchema,
+                                                                 Values::relationMatConfig,
+                                                                 ctx );
+                    Values::addSymbols ( ctx, outerVals );
+
+                    ScanLoop innerScan = openScanLoop ( Values::offsetMemAt ( innerTile, offsetof ( NestedLoopsTile, begin ) ),
+                                                        Values::offsetMemAt ( innerTile, offsetof ( NestedLoopsTile, end ) ),
+                                                        innerSchema._tupSize,
+                                                        ctx ); {
+
+                        ValueSet innerVals = Values::dematerialize ( innerScan.tupleCursor,
+                                                                     innerSchema,
+                                                                     Values::relationMatConfig,
+                                                                     ctx,
+                                                                     innerReq );
+                        Values::addSymbols ( ctx, innerVals );
+
+                        Schema innerValSchema = Values::schema ( innerVals, true );
+                        _schema = innerValSchema.join ( outerSchema );
+                        consumeCondition ( ctx );
+
+                        Values::clear ( innerVals, ctx );
+
+                    } closeScanLoop ( innerScan, ctx );
+
+                    Values::clear ( outerVals, ctx );
+
+                } closeScanLoop ( outerScan, ctx );
+
+                ctx.yield ( add ( innerTile, constInt64 ( sizeof ( NestedLoopsTile ) ) ) );
+
+            } closeWhile ( innerTileLoop );
+            ctx.clear ( innerTile );
+            ctx.clear ( innerTilesEnd );
+
+            ctx.yield ( mcall1 ( outerTile, (void*) &NestedLoopsJoinState::nextOuterTile, stateAddr ) );
+
+        } closeWhile ( outerTileLoop );
+        ctx.clear ( outerTile );
+    }
+
+
+    void consumeCondition ( JitContextFlounder& ctx ) {
+        if ( _condition != nullptr ) {
+            addExpressionIds ( _condition, &ctx.rel );
+            ir_node* conditionResult = emitExpression ( ctx, _condition );
+            ctx.yield ( cmp ( conditionResult, constInt8 ( 0 ) ) );
+            ctx.yield ( je ( ctx.labelNextTuple ) );
+            ctx.clear ( conditionResult );
         }
+        _parent->consumeFlounder ( ctx );
     }
-};
 
+
+    /* The children are materialized or scanned by the tile loops */
+    virtual void consumeFlounder ( JitContextFlounder& ctx ) {}
+};
@@ -2,11 +2,273 @@
 #include "expressions.h"
 
 
+/* Adds ASC to order expressions without direction and defines them */
+static void defineOrderExpressions ( ExprVec& orderExpressions, ExpressionContext& ctx ) {
+
+    /* add ASC if unspecified */ 
+    for ( size_t i=0; i < orderExpressions.size(); i++) {
+        Expr* e = orderExpressions[i];
+        if ( e->tag != Expr::ASC && 
+             e->tag != Expr::DESC ) {
+            orderExpressions[i] = ExprGen::asc ( e );
+        }
+    }
+
+    ctx.define ( orderExpressions );
+}
+
+
+/* Maps order expressions to the tuple layout of schema */
+static std::vector < OrderRequest > orderRequests ( ExprVec& orderExpressions, Schema& schema ) {
+    std::vector < OrderRequest > requests;
+    requests.reserve ( orderExpressions.size() );
+    for ( Expr* e : orderExpressions ) {
+        std::string symbol = getExpressionName ( e->child );
+        if ( !schema.contains ( symbol ) ) {
+            throw ResqlError ( "Order By attribute not found." );
+        }
+        Attribute attr = schema.getAttributeByName ( symbol );
+        requests.push_back ( { 
+            (size_t) schema.getOffsetInTuple ( attr.name ), 
+            attr.type, 
+            e->tag != Expr::DESC
+        } );
+    }
+    return requests;
+}
+
+
+/**
+ * @brief Computes order by expressions that are not plain attributes.
+ * The keys are evaluated once per tuple in the materializing pipeline and
+ * appended to the tuple as hidden columns. Comparisons then read the keys
+ * like attributes. The sorting operator drops the columns from its result.
+ */
+class SortKeyOp : public RelOperator {
+
+public:
+
+    /* key expressions without ASC/DESC */
+    ExprVec _keys;
+
+
+    /* number of appended key columns */
+    size_t _numHidden;
+
+
+    SortKeyOp ( ExprVec       keys,
+                RelOperator*  child )
+        :  RelOperator ( RelOperator::PROJECTION ),
+           _keys ( keys ), _numHidden ( 0 ) {
+
+        addChild ( child );
+    }
+
+
+    /* Returns nullptr if all order expressions are attributes */
+    static SortKeyOp* create ( ExprVec& orderExpressions, RelOperator* child ) {
+        ExprVec keys;
+        for ( Expr* e : orderExpressions ) {
+            Expr* key = ( e->tag == Expr::ASC || e->tag == Expr::DESC ) ? e->child : e;
+            if ( key->tag != Expr::ATTRIBUTE ) {
+                keys.push_back ( key );
+            }
+        }
+        if ( keys.empty() ) {
+            return nullptr;
+        }
+        return new SortKeyOp ( keys, child );
+    }
+
+
+    std::string name() { return "SortKeys"; }
+
+
+    size_t getSize () {
+         return _child->getSize(); 
+    }
+
+
+    /* the keys are defined with the order expressions */
+    void defineExpressions ( ExpressionContext& ctx ) {}
+
+
+    void dropKeyColumns ( Relation& rel ) {
+        rel._schema.dropTrailingAttributes ( _numHidden );
+    }
+
+
+    void produceFlounder ( JitContextFlounder&  ctx, 
+                           SymbolSet            request ) {
+
+        SymbolSet req = extractRequiredAttributes ( _keys );
+        _child->produceFlounder ( ctx, symbolSetUnion ( req, request ) );
+    }
+
+
+    void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- Sort keys" );
+
+        /* keys that are already columns, e.g. from the *
+         * select clause, are not computed again        */
+        ValueSet keyVals;
+        Schema inputSchema = _child->_schema;
+        for ( Expr* key : _keys ) {
+            addExpressionIds ( key, &ctx.rel );
+            std::string name = getExpressionName ( key );
+            bool exists = inputSchema.contains ( name );
+            for ( Value& v : keyVals ) {
+                exists |= ( v.symbol == name );
+            }
+            if ( !exists ) {
+                for ( auto& symbol : extractRequiredAttributes ( key ) ) {
+                    if ( ctx.symbolTable.count ( symbol ) == 0 ) {
+                        throw ResqlError ( "Attribute " + symbol + " of order by expression is not available." );
+                    }
+                }
+                keyVals.push_back ( { emitExpression ( ctx, key ), key->type, name } );
+            }
+        }
+        _numHidden = keyVals.size();
+
+        Values::addSymbols ( ctx, keyVals );
+        Schema keySchema = Values::schema ( keyVals, true );
+        _schema = inputSchema.join ( keySchema );
+        _parent->consumeFlounder ( ctx );
+        Values::clear ( keyVals, ctx );
+    }
+
+};
+
+
+/* Comparator for specific order requests compiled from Flounder IR.      *
+ * Offsets, types and directions are constants in the generated code, so  *
+ * no type dispatch or loop over the order requests remains per call.     */
+struct JitComparator {
+
+    Emitter emitter;
+
+    TupleComparator function = nullptr;
+
+
+    JitComparator ( std::vector < OrderRequest >& orderRequests ) {
+
+        ir_node* root = irRoot();
+        ir_node* labelBefore    = idLabel ( "tupleBefore" );
+        ir_node* labelNotBefore = idLabel ( "tupleNotBefore" );
+        ir_node* labelEnd       = idLabel ( "compareEnd" );
+
+        /* The parameters are the first allocations and *
+         * receive callee-save registers (not rdi/rsi). */
+        ir_node* tupleA = vreg64 ( "tupleA" );
+        ir_node* tupleB = vreg64 ( "tupleB" );
+        addChild ( root, request ( tupleA ) );
+        addChild ( root, request ( tupleB ) );
+        addChild ( root, mov ( tupleA, reg64 ( RDI ) ) );
+        addChild ( root, mov ( tupleB, reg64 ( RSI ) ) );
+
+        for ( OrderRequest& req : orderRequests ) {
+            ir_node* less    = req.isAscending ? labelBefore : labelNotBefore;
+            ir_node* greater = req.isAscending ? labelNotBefore : labelBefore;
+            switch ( req.type.tag ) {
+                case SqlType::BOOL:
+                case SqlType::INT:
+                case SqlType::DATE:
+                case SqlType::BIGINT:
+                case SqlType::DECIMAL: {
+                    ir_node* val;
+                    if ( req.type.tag == SqlType::BOOL ) {
+                        val = vreg8 ( "cmpBool" );
+                    }
+                    else if ( req.type.tag == SqlType::INT || req.type.tag == SqlType::DATE ) {
+                        val = vreg32 ( "cmpInt" );
+                    }
+                    else {
+                        val = vreg64 ( "cmpBigint" );
+                    }
+                    addChild ( root, request ( val ) );
+                    addChild ( root, mov ( val, Values::offsetMemAt ( tupleA, req.offset ) ) );
+                    addChild ( root, cmp ( val, Values::offsetMemAt ( tupleB, req.offset ) ) );
+                    addChild ( root, clear ( val ) );
+                    break;
+                }
+                default: {
+                    /* strings and floats compare via function call */
+                    ir_node* addrA = vreg64 ( "cmpAddrA" );
+                    ir_node* addrB = vreg64 ( "cmpAddrB" );
+                    ir_node* res   = vreg8  ( "cmpRes" );
+                    addChild ( root, request ( addrA ) );
+                    addChild ( root, request ( addrB ) );
+                    addChild ( root, request ( res ) );
+                    addChild ( root, mov ( addrA, tupleA ) );
+                    addChild ( root, add ( addrA, constInt64 ( req.offset ) ) );
+                    addChild ( root, mov ( addrB, tupleB ) );
+                    addChild ( root, add ( addrB, constInt64 ( req.offset ) ) );
+                    void* func = req.type.tag == SqlType::FLOAT 
+                        ? (void*) &::compare < SqlType::FLOAT > 
+                        : (void*) &::compare < SqlType::VARCHAR >;
+                    addChild ( root, mcall2 ( res, func, addrA, addrB ) );
+                    addChild ( root, clear ( addrA ) );
+                    addChild ( root, clear ( addrB ) );
+                    addChild ( root, cmp ( res, constInt8 ( 0 ) ) );
+                    addChild ( root, clear ( res ) );
+                    break;
+                }
+            }
+            addChild ( root, jl ( less ) );
+            addChild ( root, jg ( greater ) );
+        }
+
+        /* equal tuples */
+        ir_node* result = vreg8 ( "cmpResult" );
+        addChild ( root, request ( result ) );
+        addChild ( root, jmp ( labelNotBefore ) );
+        addChild ( root, placeLabel ( labelBefore ) );
+        addChild ( root, mov ( result, constInt8 ( 1 ) ) );
+        addChild ( root, jmp ( labelEnd ) );
+        addChild ( root, placeLabel ( labelNotBefore ) );
+        addChild ( root, mov ( result, constInt8 ( 0 ) ) );
+        addChild ( root, placeLabel ( labelEnd ) );
+        addChild ( root, clear ( tupleA ) );
+        addChild ( root, clear ( tupleB ) );
+        addChild ( root, mov ( reg8 ( AL ), result ) );
+        addChild ( root, clear ( result ) );
+        addChild ( root, ret () );
+
+        translationPass ( root );
+        emitter.emit ( root );
+        function = (TupleComparator) emitter.function();
+    }
+
+
+    /* Compiles a comparator if machine code is emitted directly */
+    static std::unique_ptr < JitComparator > compile ( std::vector < OrderRequest >& orderRequests,
+                                                       JitContextFlounder&           ctx ) {
+        if ( !ctx.config.emitMachineCode ) {
+            return nullptr;
+        }
+        Timer tCompile = Timer();
+        auto comparator = std::make_unique < JitComparator > ( orderRequests );
+        ctx.report.comparatorCompilationTime += tCompile.get();
+        return comparator;
+    }
+};
+
+
 struct OrderByState {
     
-    SingleThreadGuard guard;
+    std::unique_ptr < JitComparator > comparator;
+
+    /* in-memory sort of the materialized input */
+    std::unique_ptr < ParallelSorter > sorter;
 
-    OrderByState ( size_t numThreads ) : guard ( numThreads ) {} 
+    /* sort with memory budget and spilled runs */
+    std::unique_ptr < ExternalSorter > externalSorter;
+
+    TupleComparator compareFunction () {
+        return comparator ? comparator->function : nullptr;
+    }
 };
 
 
@@ -32,11 +294,19 @@ public:
     bool   _hasLimitClause;
 
 
+    /* computes expression keys, nullptr for attribute keys */
+    SortKeyOp* _sortKeys;
+
+
     OrderByOp ( ExprVec&&     orderExpr, 
                 RelOperator*  child ) 
         :  RelOperator ( RelOperator::ORDERBY ),
            _orderExpressions ( orderExpr ), _hasLimitClause ( false ) {
   
+        _sortKeys = SortKeyOp::create ( _orderExpressions, child );
+        if ( _sortKeys != nullptr ) {
+            child = _sortKeys;
+        }
         addChild ( new MaterializeOp ( child ) );
     }
   
@@ -49,22 +319,7 @@ public:
 
     void defineExpressions ( ExpressionContext& ctx ) {
 
-        /* add ASC if unspecified */ 
-        for ( size_t i=0; i < _orderExpressions.size(); i++) {
-            Expr* e = _orderExpressions[i];
-            if ( e->tag != Expr::ASC && 
-                 e->tag != Expr::DESC ) {
-                _orderExpressions[i] = ExprGen::asc ( e );
-            }
-        }
-   
-        for ( Expr* e : _orderExpressions ) {
-            if ( e->child->tag != Expr::ATTRIBUTE ) {
-                throw ResqlError ( "Order by only supports attribute expressions currently." + serializeExpr ( e->child)  );
-            }
-        }
-
-        ctx.define ( _orderExpressions );
+        defineOrderExpressions ( _orderExpressions, ctx );
     }
   
   
@@ -84,58 +339,130 @@ public:
     }
 
 
+    /* The materialized input is reset before, the sorter takes its new relation */
+    virtual void resetState () {
+        if ( _state->externalSorter ) {
+            _state->externalSorter->reset();
+        }
+        else {
+            MaterializeOp* child = ( MaterializeOp* ) _child;
+            _state->sorter->reset ( child->relOut.get() );
+        }
+    }
+
+
     virtual std::unique_ptr < Relation > retrieveResult() {
         MaterializeOp* child = ( MaterializeOp* ) _child;
+        std::unique_ptr < Relation > result;
+        if ( _state->externalSorter ) {
+            _state->externalSorter->raiseError();
+            result = std::move ( _state->externalSorter->_result );
+        }
+        else {
+            result = std::move ( child->relOut );
+        }
         if ( _hasLimitClause ) {
-            child->relOut->applyLimit ( _limit );
+            result->applyLimit ( _limit );
         }
-        return std::move ( child->relOut );
+        if ( _sortKeys != nullptr ) {
+            _sortKeys->dropKeyColumns ( *result );
+        }
+        return result;
     }
 
 
     void produceFlounder ( JitContextFlounder&  ctx, 
                            SymbolSet            request ) {
   
-        _state = std::make_unique < OrderByState > ( ctx.numThreads() );
+        _state = std::make_unique < OrderByState > ();
 
-        _child->produceFlounder ( ctx, request );
+        if ( ctx.config.sortMemoryMB > 0 ) {
+            produceExternalSortFlounder ( ctx, request );
+            return;
+        }
 
-        _state->guard.open ( ctx.codeTree );
+        _child->produceFlounder ( ctx, request );
 
         /* Map orderby expressions to order requests */
         _schema = _child->_schema;
-        _orderRequests.reserve ( _orderExpressions.size() );
-        for ( Expr* e : _orderExpressions ) {
-            if ( !_schema.contains ( e->child->symbol ) ) {
-                throw ResqlError ( "Order By attribute not found." );
-            }
-            Attribute attr = _schema.getAttributeByName ( e->child->symbol );
-            _orderRequests.push_back ( { 
-                (size_t) _schema.getOffsetInTuple ( attr.name ), 
-                attr.type, 
-                e->tag != Expr::DESC
-            } );
-        }
+        _orderRequests = orderRequests ( _orderExpressions, _schema );
  
         /* Produce sort functionality in flounder */ 
         ctx.comment ( " --- Sort " );
         MaterializeOp* child = ( MaterializeOp* ) _child;
+        if ( !usesNormalizedKeys ( _orderRequests ) ) {
+            _state->comparator = JitComparator::compile ( _orderRequests, ctx );
+        }
+        _state->sorter = makeSorter ( child->relOut.get(), 
+                                      &_orderRequests, 
+                                      ctx.numThreads(),
+                                      _state->compareFunction() );
         ir_node* foo = ctx.request ( vreg64 ( "unused_return" ) );
 
-        /* call sort function */
+        /* all threads call the sort function and sort cooperatively */
         ctx.yield ( 
-            mcall2 ( foo,
-                     (void*) &sort,
-                     constLoad ( constAddress ( child->relOut.get() ) ),
-                     constLoad ( constAddress ( &_orderRequests ) )
+            mcall1 ( foo,
+                     (void*) &ParallelSorter::sort,
+                     constAddress ( _state->sorter.get() )
+            ) 
+        );
+        ctx.clear ( foo );
+    }
+
+
+    /* The input is not materialized. Instead, consumeFlounder(..) *
+     * passes tuples to the run buffers of the external sort.      */
+    void produceExternalSortFlounder ( JitContextFlounder&  ctx, 
+                                       SymbolSet            request ) {
+
+        RelOperator* input = _child->_child;
+        input->_parent = this;
+        input->produceFlounder ( ctx, request );
+
+        ctx.comment ( " --- Merge sorted runs" );
+        ir_node* foo = ctx.request ( vreg64 ( "unused_return" ) );
+        ctx.yield ( 
+            mcall1 ( foo,
+                     (void*) &ExternalSorter::finish,
+                     constAddress ( _state->externalSorter.get() )
             ) 
         );
         ctx.clear ( foo );
-        
-        _state->guard.close ( ctx.codeTree );
     }
  
  
-    void consumeFlounder ( JitContextFlounder& ctx ) { }
+    void consumeFlounder ( JitContextFlounder& ctx ) { 
+
+        ctx.comment ( " --- Sorted runs" );
+
+        _schema = _child->_child->_schema;
+        _orderRequests = orderRequests ( _orderExpressions, _schema );
+        _state->comparator = JitComparator::compile ( _orderRequests, ctx );
+        _state->externalSorter = std::make_unique < ExternalSorter > ( _schema,
+                                                                       &_orderRequests,
+                                                                       _state->compareFunction(),
+                                                                       ctx.numThreads(),
+                                                                       (size_t) ctx.config.sortMemoryMB << 20 );
+
+        /* each thread adds tuples to its own run buffer */
+        ir_node* builder = vreg64 ( "runBuilder" );
+        ctx.yieldPipeHead ( request ( builder ) );
+        ctx.yieldPipeHead ( mcall1 ( builder, 
+                                     (void*) &ExternalSorter::acquireBuilder, 
+                                     constAddress ( _state->externalSorter.get() ) ) );
+        ir_node* scratch = vreg64 ( "runScratch" );
+        ctx.yieldPipeHead ( request ( scratch ) );
+        ctx.yieldPipeHead ( mcall1 ( scratch, (void*) &ExternalSorter::RunBuilder::scratch, builder ) );
+
+        ValueSet matValues = Values::get ( _schema, ctx );
+        Values::materialize ( matValues, scratch, Values::relationMatConfig, ctx );
+        void (*addFunc)( ExternalSorter::RunBuilder* ) = ExternalSorter::RunBuilder::add;
+        ir_node* foo = ctx.request ( vreg64 ( "unused_return" ) );
+        ctx.yield ( mcall1 ( foo, (void*) addFunc, builder ) );
+        ctx.clear ( foo );
+
+        ctx.yieldPipeFoot ( clear ( scratch ) );
+        ctx.yieldPipeFoot ( clear ( builder ) );
+    }
   
 };
@@ -40,9 +40,20 @@ public:
     virtual void produceFlounder ( JitContextFlounder& ctx, 
                                    SymbolSet           request ) {
 
-        /* Projection with children */
+        /* Projection with children. Attributes that the parent  *
+         * requests besides the projected columns, e.g. for sort *
+         * keys, are passed through from the child.              */
         if ( _child != nullptr ) {
             SymbolSet req = extractRequiredAttributes ( _expr );
+            for ( auto& symbol : request ) {
+                bool projected = false;
+                for ( Expr* e : _expr ) {
+                    projected |= ( getExpressionName ( e ) == symbol );
+                }
+                if ( !projected ) {
+                    req.insert ( symbol );
+                }
+            }
             _child->produceFlounder ( ctx, req );
         }
  
@@ -1,4 +1,4 @@
-
+#include "qlib/filter.h"
 
 
 struct Dematerializer {
@@ -33,6 +33,12 @@ struct ScanLoop {
     ir_node* relationEnd;
     ir_node* nextTuple;
     WhileLoop loop;
+
+    /* batches of tuples that are prefiltered when a filter is set */
+    SimdFilter* filter = nullptr;
+    ir_node* batchCursor;
+    ir_node* selectionMask;
+    WhileLoop batchLoop;
 };
 
 
@@ -66,16 +72,70 @@ ScanLoop openScanLoop ( ir_node*             begin,
 }
 
 
+/* Scans batches of tuples and evaluates the filter for each batch. The loop *
+ * body only runs for the tuples in the resulting selection mask.           */
+ScanLoop openFilteredScanLoop ( ir_node*             begin,
+                                ir_node*             end,
+                                SimdFilter*          filter,
+                                JitContextFlounder&  ctx ) {
+    ScanLoop scan;
+    scan.step = filter->step;
+    scan.filter = filter;
+    scan.relationEnd = end;
+
+    scan.batchCursor = ctx.request ( vreg64 ( "batchCursor" ) );
+    ctx.yield ( mov ( scan.batchCursor, begin ) );
+
+    scan.nextTuple = idLabel ( "nextTuple" );
+    ctx.labelNextTuple = scan.nextTuple;
+
+    scan.batchLoop = While ( isSmaller ( scan.batchCursor, scan.relationEnd ), ctx.codeTree );
+    scan.selectionMask = ctx.request ( vreg64 ( "selectionMask" ) );
+    ctx.yield ( mcall3 ( scan.selectionMask,
+                         (void*) &SimdFilter::evaluate,
+                         constAddress ( filter ),
+                         scan.batchCursor,
+                         scan.relationEnd ) );
+
+    // tuple of the lowest bit in the selection mask
+    scan.loop = While ( isNotEqual ( scan.selectionMask, constInt64 ( 0 ) ), ctx.codeTree );
+    scan.tupleCursor = ctx.request ( vreg64 ( "tupleCursor" ) );
+    ctx.yield ( tzcnt ( scan.tupleCursor, scan.selectionMask ) );
+    ctx.yield ( imul ( scan.tupleCursor, constInt64 ( scan.step ) ) );
+    ctx.yield ( add ( scan.tupleCursor, scan.batchCursor ) );
+    return scan;
+}
+
+
 void closeScanLoop ( ScanLoop& scan, JitContextFlounder& ctx ) {
 
     ctx.comment ( " --- Scan loop tail" );
     ctx.yield ( placeLabel ( scan.nextTuple ) );
 
-    // move pointer to next tuple
-    ctx.yield ( add ( scan.tupleCursor, constInt64 ( scan.step ) ) );
-    closeWhile ( scan.loop );
+    if ( scan.filter != nullptr ) {
+        ctx.clear ( scan.tupleCursor );
+
+        // remove the lowest bit from the selection mask
+        ir_node* lowestBit = ctx.request ( vreg64 ( "lowestBit" ) );
+        ctx.yield ( mov ( lowestBit, scan.selectionMask ) );
+        ctx.yield ( sub ( lowestBit, constInt64 ( 1 ) ) );
+        ctx.yield ( and_ ( scan.selectionMask, lowestBit ) );
+        ctx.clear ( lowestBit );
+        closeWhile ( scan.loop );
+
+        // move pointer to next batch
+        ctx.clear ( scan.selectionMask );
+        ctx.yield ( add ( scan.batchCursor, constInt64 ( scan.step * SimdFilter::BatchSize ) ) );
+        closeWhile ( scan.batchLoop );
+        ctx.clear ( scan.batchCursor );
+    }
+    else {
+        // move pointer to next tuple
+        ctx.yield ( add ( scan.tupleCursor, constInt64 ( scan.step ) ) );
+        closeWhile ( scan.loop );
+        ctx.yield ( clear ( scan.tupleCursor ) );
+    }
 
-    ctx.yield ( clear ( scan.tupleCursor ) );
     if ( isVreg ( scan.relationEnd ) ) {
         ctx.yield ( clear ( scan.relationEnd ) );
     }
@@ -101,7 +161,9 @@ struct BlockScan {
     Data* (*blockEndFunc) ( DataBlock* ) = DataBlock::end;
 
 
-    BlockScan ( Relation::ReadIterator* readIt, JitContextFlounder& ctx ) : 
+    BlockScan ( Relation::ReadIterator* readIt, 
+                JitContextFlounder&     ctx,
+                SimdFilter*             filter = nullptr ) : 
         readIt ( readIt ), ctx ( ctx ) {
 
         _block = ctx.request ( vreg64 ( "inBlock" ) );
@@ -130,7 +192,13 @@ struct BlockScan {
                 )              
             ); 
 
-            _loopScan = openScanLoop ( _blockBegin, _blockEnd, readIt->Step, ctx ); {
+            if ( filter != nullptr ) {
+                _loopScan = openFilteredScanLoop ( _blockBegin, _blockEnd, filter, ctx );
+            }
+            else {
+                _loopScan = openScanLoop ( _blockBegin, _blockEnd, readIt->Step, ctx );
+            }
+            {
                  /*************
                   * loop body *
                   *************/
@@ -166,6 +234,150 @@ struct BlockScan {
 };
 
 
+/* Comparison of a conjunct with the attribute on the left side */
+static bool getFilterComparison ( Expr::Tag                     tag,
+                                  bool                          attributeLeft,
+                                  FilterPredicate::Comparison&  comparison ) {
+    switch ( tag ) {
+        case Expr::LT:  comparison = attributeLeft ? FilterPredicate::LT : FilterPredicate::GT; break;
+        case Expr::LE:  comparison = attributeLeft ? FilterPredicate::LE : FilterPredicate::GE; break;
+        case Expr::GT:  comparison = attributeLeft ? FilterPredicate::GT : FilterPredicate::LT; break;
+        case Expr::GE:  comparison = attributeLeft ? FilterPredicate::GE : FilterPredicate::LE; break;
+        case Expr::EQ:  comparison = FilterPredicate::EQ;  break;
+        case Expr::NEQ: comparison = FilterPredicate::NEQ; break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+
+/* Values of both types are compared as integers of the same scale */
+static bool isSameRepresentation ( SqlType& a, SqlType& b ) {
+    if ( a.tag != b.tag ) return false;
+    if ( a.tag == SqlType::DECIMAL ) {
+        return a.decimalSpec().scale == b.decimalSpec().scale;
+    }
+    return true;
+}
+
+
+/* Evaluates an expression of integer constants in the representation *
+ * of its type. Fails for expressions that would need a division.      */
+static bool evaluateFilterConstant ( Expr*     expr,
+                                     int64_t&  value ) {
+
+    SqlType& type = expr->type;
+    switch ( expr->tag ) {
+
+        case Expr::CONSTANT:
+            switch ( type.tag ) {
+                case SqlType::INT:     value = expr->value.intData;              return true;
+                case SqlType::DATE:    value = (int32_t) expr->value.dateData;   return true;
+                case SqlType::BIGINT:  value = expr->value.bigintData;           return true;
+                case SqlType::DECIMAL: value = expr->value.decimalData;          return true;
+                default:
+                    return false;
+            }
+
+        case Expr::TYPECAST: {
+            SqlType& from = expr->child->type;
+            if ( !evaluateFilterConstant ( expr->child, value ) ) return false;
+            if ( type.tag == SqlType::BIGINT ) {
+                return from.tag == SqlType::INT || from.tag == SqlType::BIGINT;
+            }
+            if ( type.tag != SqlType::DECIMAL ) return false;
+            int fromScale = 0;
+            if ( from.tag == SqlType::DECIMAL ) {
+                fromScale = from.decimalSpec().scale;
+            }
+            else if ( from.tag != SqlType::BIGINT ) {
+                return false;
+            }
+            int scale = type.decimalSpec().scale;
+            if ( fromScale > scale || scale - fromScale > 8 ) return false;
+            return !__builtin_mul_overflow ( value, (int64_t) factorsDECIMAL [ scale - fromScale ], &value );
+        }
+
+        case Expr::ADD:
+        case Expr::SUB: {
+            if ( type.tag != SqlType::BIGINT && type.tag != SqlType::DECIMAL ) return false;
+            int64_t left, right;
+            for ( Expr* child = expr->child; child != nullptr; child = child->next ) {
+                if ( !isSameRepresentation ( child->type, type ) ) return false;
+            }
+            if ( !evaluateFilterConstant ( expr->child, left ) ) return false;
+            if ( !evaluateFilterConstant ( expr->child->next, right ) ) return false;
+            if ( expr->tag == Expr::ADD ) {
+                return !__builtin_add_overflow ( left, right, &value );
+            }
+            return !__builtin_sub_overflow ( left, right, &value );
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+/* Value of a constant expression compared with an attribute of type */
+static bool getFilterConstant ( Expr*     expr,
+                                SqlType&  type,
+                                int64_t&  value ) {
+
+    return isSameRepresentation ( expr->type, type ) && evaluateFilterConstant ( expr, value );
+}
+
+
+/* Adds the conjuncts of a condition that compare an integer attribute of *
+ * the schema with a constant and collects them in terms. The others are  *
+ * left to the scalar evaluation of the condition.                        */
+static void addFilterPredicates ( Expr*                   condition,
+                                  Schema&                 schema,
+                                  SimdFilter&             filter,
+                                  std::vector < Expr* >&  terms ) {
+
+    if ( condition->tag == Expr::AND ) {
+        for ( Expr* child = condition->child; child != nullptr; child = child->next ) {
+            addFilterPredicates ( child, schema, filter, terms );
+        }
+        return;
+    }
+    if ( condition->child == nullptr || condition->child->next == nullptr ) return;
+
+    Expr* left = condition->child;
+    Expr* right = condition->child->next;
+    bool attributeLeft = left->tag == Expr::ATTRIBUTE;
+    Expr* attribute = attributeLeft ? left : right;
+    Expr* constant = attributeLeft ? right : left;
+    if ( attribute->tag != Expr::ATTRIBUTE || !schema.contains ( attribute->symbol ) ) return;
+
+    FilterPredicate predicate;
+    if ( !getFilterComparison ( condition->tag, attributeLeft, predicate.comparison ) ) return;
+
+    for ( auto& a : schema._attribs ) {
+        if ( a.name != attribute->symbol ) continue;
+        if ( !isSameRepresentation ( a.type, attribute->type ) ) return;
+        switch ( a.type.tag ) {
+            case SqlType::INT:
+            case SqlType::DATE:
+                predicate.width = 4;
+                break;
+            case SqlType::BIGINT:
+            case SqlType::DECIMAL:
+                predicate.width = 8;
+                break;
+            default:
+                return;
+        }
+        if ( !getFilterConstant ( constant, a.type, predicate.value ) ) return;
+    }
+    predicate.offset = schema.getOffsetInTuple ( attribute->symbol );
+    filter.predicates.push_back ( predicate );
+    terms.push_back ( condition );
+}
+
+
 /**
  * @brief Operator for scanning a relation.
  */
@@ -181,6 +393,14 @@ public:
 
     ExprVec _scanExpr;
 
+    /* Condition of a selection on the scan. Its comparisons of attributes *
+     * with constants prefilter batches of tuples before the loop body.    */
+    Expr* _filterCondition = nullptr;
+    SimdFilter _filter;
+
+    /* Above this estimated selectivity the filter costs more than it saves */
+    static constexpr double MaxFilterSelectivity = 0.1;
+
     virtual std::string name() { 
         std::string name;
         if ( relationName.length() == 0 ) name = "Scan";
@@ -222,6 +442,16 @@ public:
     virtual size_t getSize () {
         return _rel->tupleNum();
     }
+
+
+    virtual ColumnStatistics* columnStatistics ( const std::string& attribute ) {
+        return _rel->_statistics.column ( attribute );
+    }
+
+
+    virtual void resetState () {
+        _readIt.refresh();
+    }
    
  
     virtual void produceFlounder ( JitContextFlounder& ctx,
@@ -236,8 +466,22 @@ public:
         } 
 
 
+        _filter.step = _readIt.Step;
+        _filter.predicates.clear();
+        if ( _filterCondition != nullptr ) {
+            Schema schema ( _rel->_schema._attribs, Values::relationMatConfig.stringsByVal );
+            std::vector < Expr* > terms;
+            addFilterPredicates ( _filterCondition, schema, _filter, terms );
+            StatisticsLookup lookup = [this] ( const std::string& attribute ) {
+                return columnStatistics ( attribute );
+            };
+            if ( terms.empty() || estimateConjunctionSelectivity ( terms, lookup ) > MaxFilterSelectivity ) {
+                _filter.predicates.clear();
+            }
+        }
+
         // scan loop        
-        { BlockScan scan ( &_readIt, ctx );
+        { BlockScan scan ( &_readIt, ctx, _filter.predicates.empty() ? nullptr : &_filter );
 
             // read tuple into registers
             auto scanVals = Values::dematerialize ( scan.tupleCursor(), 
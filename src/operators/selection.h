@@ -31,8 +31,20 @@ public:
     }
 
     
+    /* Estimates the selectivity from the statistics of the condition's *
+     * attributes and halves the input without statistics.              */
     virtual size_t getSize () {
-        return children[0]->getSize() / 2;
+        size_t childSize = children[0]->getSize();
+        for ( auto& attribute : extractRequiredAttributes ( _condition ) ) {
+            if ( _child->columnStatistics ( attribute ) == nullptr ) {
+                return childSize / 2;
+            }
+        }
+        StatisticsLookup lookup = [this] ( const std::string& attribute ) {
+            return _child->columnStatistics ( attribute );
+        };
+        double sel = estimateSelectivity ( _condition, lookup );
+        return (size_t) std::ceil ( childSize * sel );
     }
 
  
@@ -44,6 +56,12 @@ public:
         _request = request;
         SymbolSet selectionReq = extractRequiredAttributes ( _condition ); 
 
+        /* Let a scan prefilter its tuples with the condition */
+        if ( _child->tag == RelOperator::SCAN ) {
+            ScanOp* scan = (ScanOp*) _child;
+            scan->_filterCondition = ctx.config.simdSelection ? _condition : nullptr;
+        }
+
         /* Request attributes from child */
         _child->produceFlounder ( ctx, symbolSetUnion ( _request, selectionReq ) );
     }
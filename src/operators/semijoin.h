@@ -0,0 +1,225 @@
+/**
+ * @brief Semi join and anti join operator.
+ * Filters the tuples of the right (probe) child operator by the existence
+ * of a matching tuple in the left (build) child operator. The hash table
+ * only holds the build keys and never the build payload. Each probe stops
+ * at the first matching entry. The semi join passes the probe tuple on to
+ * the parent at that point, the anti join skips it. Used for EXISTS and IN
+ * subqueries and their negations.
+ */
+class SemiJoinOp : public RelOperator {
+
+public:
+
+    /* join hash table and ir_node that holds the address of the hash table     *
+     * data structure (jit constant).                                           */
+    HashTable*  _ht = nullptr;
+    ir_node*    _htAddr = nullptr;
+
+
+    /* Remember schema of the build keys to access them later during probe.     */
+    Schema      _schemaBuildKeys;
+
+
+    /* Pass probe tuples without a match instead of tuples with a match.        */
+    bool        _anti;
+
+
+    /* Equality conditions with the left child operator's attributes on the    *
+     * left side and the right child operator's attributes on the right side.   */
+    ExprVec     _equalities;
+
+
+    /* Remember requested attributes to prune schema when the child operator's  *
+     * schemas are available in consume.                                        */
+    SymbolSet   _request;
+
+
+    /* Number of times consumeFlounder(..) was called. Used to distinguish      *
+     * between call from left child (first) and right child (second).           */
+    int         _nCall = 0;
+
+
+    /* state that concerns the join during execution */
+    std::unique_ptr < HashJoinState > _state;
+
+
+    virtual std::string name() { return _anti ? "AntiJoin" : "SemiJoin"; };
+
+
+    SemiJoinOp ( std::vector < Expr* > equalities,
+                 bool                  anti,
+                 RelOperator*          leftChild,
+                 RelOperator*          rightChild )
+         :  RelOperator ( RelOperator::SEMIJOIN ),
+           _anti ( anti ),
+           _equalities ( equalities )
+    {
+        addChild ( leftChild );
+        addChild ( rightChild );
+    }
+
+
+    virtual ~SemiJoinOp() {
+        if ( _ht != nullptr ) {
+            freeHashTable ( _ht );
+        }
+    }
+
+
+    void defineExpressions ( ExpressionContext& ctx ) {
+        ctx.define ( _equalities );
+    }
+
+
+    virtual size_t getSize () {
+        return _rChild->getSize();
+    }
+
+
+    virtual void resetState () {
+        _state->reset();
+    }
+
+
+    virtual void produceFlounder ( JitContextFlounder& ctx,
+                                   SymbolSet           request ) {
+
+        _request = request;
+
+        _state = std::make_unique < HashJoinState > ( ctx.numThreads() );
+
+        /* the build side only provides keys */
+        ExprVec left  = equalitiesLeftSide ( _equalities );
+        ExprVec right = equalitiesRightSide ( _equalities );
+        SymbolSet buildReq = extractRequiredAttributes ( left );
+        SymbolSet probeReq = extractRequiredAttributes ( right );
+        probeReq = symbolSetUnion ( _request, probeReq );
+
+        _lChild->produceFlounder ( ctx, buildReq );
+
+        ir_node* foo = vreg64 ( "foo_sync" );
+        ctx.request ( foo );
+        ctx.yield ( mcall1 ( foo, (void*) &_state->syncBuild, constAddress ( _state.get() ) ) );
+        ctx.clear ( foo );
+
+        _rChild->produceFlounder ( ctx, probeReq );
+    }
+
+
+    void consumeSemiProbe ( ir_node*             probeHash,
+                            ValueSet&            probeKeys,
+                            JitContextFlounder&  ctx ) {
+
+        ir_node* htProbeEntry = ctx.request ( vreg64 ( "htProbeEntry" ) );
+        ctx.yield ( mov ( htProbeEntry, constAddress ( nullptr ) ) );
+
+        /* Loop over ht entries with matching hash values */
+        WhileLoop whileLoop = WhileTrue ( ctx.codeTree ); {
+
+            /* Probe hash table and go to next tuple when no match */
+            ctx.yield ( mcall3 ( htProbeEntry, (void*) &ht_get, _htAddr, probeHash, htProbeEntry ) );
+            ctx.yield ( cmp ( htProbeEntry, constAddress ( nullptr ) ) );
+            ctx.yield ( je ( ctx.labelNextTuple ) );
+
+            /* Exit loop at the first matching keys */
+            ValueSet entryKeys = Values::dematerialize ( htProbeEntry, _schemaBuildKeys, Values::htMatConfig, ctx );
+            Values::checkEqualityJump ( probeKeys, entryKeys, whileLoop.headLabel, ctx );
+            Values::clear ( entryKeys, ctx );
+            ctx.yield ( jmp ( whileLoop.footLabel ) );
+
+        } closeWhile ( whileLoop );
+        ctx.clear ( htProbeEntry );
+        ctx.clear ( probeHash );
+        Values::clear ( probeKeys, ctx );
+
+        /* Code from parent operator */
+        _parent->consumeFlounder ( ctx );
+    }
+
+
+    void consumeAntiProbe ( ir_node*             probeHash,
+                            ValueSet&            probeKeys,
+                            JitContextFlounder&  ctx ) {
+
+        ir_node* htProbeEntry = ctx.request ( vreg64 ( "htProbeEntry" ) );
+        ctx.yield ( mov ( htProbeEntry, constAddress ( nullptr ) ) );
+
+        /* Loop over ht entries with matching hash values */
+        WhileLoop whileLoop = WhileTrue ( ctx.codeTree ); {
+
+            /* Probe hash table and exit loop when no match */
+            ctx.yield ( mcall3 ( htProbeEntry, (void*) &ht_get, _htAddr, probeHash, htProbeEntry ) );
+            breakWhile ( whileLoop, isEqual ( htProbeEntry, constAddress ( nullptr ) ) );
+
+            /* Go to next tuple at the first matching keys */
+            ValueSet entryKeys = Values::dematerialize ( htProbeEntry, _schemaBuildKeys, Values::htMatConfig, ctx );
+            Values::checkEqualityJump ( probeKeys, entryKeys, whileLoop.headLabel, ctx );
+            Values::clear ( entryKeys, ctx );
+            ctx.yield ( jmp ( ctx.labelNextTuple ) );
+
+        } closeWhile ( whileLoop );
+        ctx.clear ( htProbeEntry );
+        ctx.clear ( probeHash );
+        Values::clear ( probeKeys, ctx );
+
+        /* Code from parent operator */
+        _parent->consumeFlounder ( ctx );
+    }
+
+
+    virtual void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        _nCall++;
+
+        if ( _nCall > 2 ) {
+            error_msg ( CODEGEN_ERROR, "SemiJoin::consumeFlounder(..) called"
+                                       " more than 2 times." );
+        }
+
+        if ( _nCall == 1 ) {
+            ctx.comment ( " --- Semi join build" );
+
+            /* prepare hash build keys */
+            auto left = equalitiesLeftSide ( _equalities );
+            ValueSet buildKeys = evalExpressions ( left, ctx );
+            _schemaBuildKeys = Values::schema ( buildKeys, Values::htMatConfig.stringsByVal );
+
+            /* hash build keys and stage them for the hash table */
+            size_t entrySize = _schemaBuildKeys._tupSize;
+            ir_node* buildHash = Values::hash ( buildKeys, ctx );
+            ir_node* htEntry = emitHashBuildEntry ( _state.get(), entrySize, buildHash, ctx );
+            _ht = _state->_ht;
+            _htAddr = constAddress ( _ht );
+            ctx.clear ( buildHash );
+
+            /* Materialize build keys into hash table */
+            Values::materialize ( buildKeys, htEntry, Values::htMatConfig, ctx );
+            Values::clear ( buildKeys, ctx );
+            ctx.clear ( htEntry );
+        }
+
+        else if ( _nCall == 2 ) {
+
+            ctx.comment ( " --- Semi join probe" );
+            _schema = _rChild->_schema;
+            if ( ! ctx.requestAll ) {
+                _schema = _schema.prune ( _request );
+            }
+
+            /* Evaluate hash probe keys..    */
+            ExprVec right = equalitiesRightSide ( _equalities );
+            ValueSet probeKeys = evalExpressions ( right, ctx );
+
+            /* ..and hash them.              */
+            ir_node* probeHash = Values::hash ( probeKeys, ctx );
+
+            if ( _anti ) {
+                consumeAntiProbe ( probeHash, probeKeys, ctx );
+            }
+            else {
+                consumeSemiProbe ( probeHash, probeKeys, ctx );
+            }
+        }
+    }
+};
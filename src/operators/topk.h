@@ -0,0 +1,231 @@
+#include <barrier>
+
+
+struct TopKState {
+
+    /* one heap per worker thread */
+    std::vector < std::unique_ptr < TopKHeap > > _heaps;
+
+    std::atomic < size_t > _nextHeap = 0;
+
+    /* all threads offered their tuples before merging */
+    std::barrier<> _syncMerge;
+
+    std::atomic < bool > _mergeFlag = true;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    std::unique_ptr < JitComparator > _comparator;
+
+    size_t _limit;
+
+    size_t _numThreads;
+
+    Schema _schema;
+
+    std::unique_ptr < Relation > _result;
+
+
+    TopKState ( Schema&                          schema,
+                std::vector < OrderRequest >*    orderRequests,
+                std::unique_ptr < JitComparator > comparator,
+                size_t                           limit,
+                size_t                           numThreads )
+        : _syncMerge ( numThreads ), _orderRequests ( orderRequests ), 
+          _comparator ( std::move ( comparator ) ), _limit ( limit ),
+          _numThreads ( numThreads ), _schema ( schema ) {
+
+        reset();
+    }
+
+
+    /* Empty heaps and result for the next execution */
+    void reset () {
+        TupleComparator compare = _comparator ? _comparator->function : nullptr;
+        _heaps.clear();
+        for ( size_t t = 0; t < _numThreads; t++ ) {
+            _heaps.push_back ( std::make_unique < TopKHeap > ( _limit, _schema._tupSize, _orderRequests, compare ) );
+        }
+        _nextHeap = 0;
+        _mergeFlag = true;
+        _result = std::make_unique < Relation > ( _schema );
+    }
+
+
+    static TopKHeap* acquireHeap ( TopKState* state ) {
+        return state->_heaps [ state->_nextHeap.fetch_add ( 1 ) ].get();
+    }
+
+
+    /* Waits for all threads and merges the heaps with the first thread */
+    static void merge ( TopKState* state ) {
+
+        state->_syncMerge.arrive_and_wait();
+        bool expected = true;
+        if ( !state->_mergeFlag.compare_exchange_strong ( expected, false ) ) {
+            return;
+        }
+
+        std::vector < Data* > tuples;
+        for ( auto& heap : state->_heaps ) {
+            for ( size_t s : heap->_heap ) {
+                tuples.push_back ( heap->slot ( s ) );
+            }
+        }
+        TopKHeap* heap = state->_heaps[0].get();
+        std::sort ( tuples.begin(), tuples.end(), [&] ( Data* a, Data* b ) {
+            return heap->before ( a, b );
+        } );
+        tuples.resize ( std::min ( tuples.size(), state->_limit ) );
+
+        Relation& rel = *state->_result;
+        size_t tupSize = rel._schema._tupSize;
+        size_t tuplesPerBlock = DataBlock::Size / tupSize;
+        for ( size_t i = 0; i < tuples.size(); i++ ) {
+            if ( i % tuplesPerBlock == 0 ) {
+                rel.addBlock();
+            }
+            DataBlock* block = rel._dataBlocks.back().get();
+            std::memcpy ( block->end(), tuples[i], tupSize );
+            block->updateContentSize ( block->end() + tupSize );
+        }
+        state->_heaps.clear();
+    }
+};
+
+
+/**
+ * @brief Top-K operator.
+ * Computes order by with limit without materializing and sorting the
+ * whole input. Each worker thread offers its tuples to a bounded heap
+ * that keeps the first k tuples. After the pipeline, the heaps are merged
+ * into the result relation.
+ */
+class TopKOp : public RelOperator {
+
+public:
+
+    /* Order by expressions */
+    ExprVec _orderExpressions;
+
+
+    /* Converted expressions */
+    std::vector < OrderRequest > _orderRequests;
+
+
+    /* number of tuples in the result */
+    size_t _limit;
+
+
+    std::unique_ptr < TopKState > _state;
+
+
+    ir_node* _heap;
+
+
+    ir_node* _scratch;
+
+
+    /* computes expression keys, nullptr for attribute keys */
+    SortKeyOp* _sortKeys;
+
+
+    TopKOp ( ExprVec&&     orderExpr,
+             size_t        limit,
+             RelOperator*  child )
+        :  RelOperator ( RelOperator::TOPK ),
+           _orderExpressions ( orderExpr ), _limit ( limit ) {
+
+        _sortKeys = SortKeyOp::create ( _orderExpressions, child );
+        if ( _sortKeys != nullptr ) {
+            child = _sortKeys;
+        }
+        addChild ( child );
+    }
+
+
+    std::string name() { return "TopK"; }
+
+
+    void defineExpressions ( ExpressionContext& ctx ) {
+        defineOrderExpressions ( _orderExpressions, ctx );
+    }
+
+
+    size_t getSize () {
+         return std::min ( _limit, _child->getSize() );
+    }
+
+
+    virtual bool isMaterializedOperator() {
+        return true;
+    }
+
+
+    virtual void addLimit ( size_t limit ) {
+        _limit = limit;
+    }
+
+
+    virtual void resetState () {
+        _state->reset();
+    }
+
+
+    virtual std::unique_ptr < Relation > retrieveResult() {
+        if ( _sortKeys != nullptr ) {
+            _sortKeys->dropKeyColumns ( *_state->_result );
+        }
+        return std::move ( _state->_result );
+    }
+
+
+    void produceFlounder ( JitContextFlounder&  ctx,
+                           SymbolSet            request ) {
+
+        _child->produceFlounder ( ctx, request );
+
+        ctx.comment ( " --- TopK merge" );
+        ir_node* foo = ctx.request ( vreg64 ( "unused_return" ) );
+        ctx.yield (
+            mcall1 ( foo,
+                     (void*) &TopKState::merge,
+                     constAddress ( _state.get() )
+            )
+        );
+        ctx.clear ( foo );
+    }
+
+
+    void consumeFlounder ( JitContextFlounder& ctx ) {
+
+        ctx.comment ( " --- TopK" );
+
+        _schema = _child->_schema;
+        _orderRequests = orderRequests ( _orderExpressions, _schema );
+        _state = std::make_unique < TopKState > ( _schema, 
+                                                  &_orderRequests, 
+                                                  JitComparator::compile ( _orderRequests, ctx ),
+                                                  _limit, 
+                                                  ctx.numThreads() );
+
+        /* each thread offers to its own heap via the scratch tuple */
+        _heap = vreg64 ( "topkHeap" );
+        ctx.yieldPipeHead ( request ( _heap ) );
+        ctx.yieldPipeHead ( mcall1 ( _heap, (void*) &TopKState::acquireHeap, constAddress ( _state.get() ) ) );
+        _scratch = vreg64 ( "topkScratch" );
+        ctx.yieldPipeHead ( request ( _scratch ) );
+        ctx.yieldPipeHead ( mcall1 ( _scratch, (void*) &TopKHeap::scratch, _heap ) );
+
+        ValueSet matValues = Values::get ( _schema, ctx );
+        Values::materialize ( matValues, _scratch, Values::relationMatConfig, ctx );
+        void (*offerFunc)( TopKHeap* ) = TopKHeap::offer;
+        ir_node* foo = ctx.request ( vreg64 ( "unused_return" ) );
+        ctx.yield ( mcall1 ( foo, (void*) offerFunc, _heap ) );
+        ctx.clear ( foo );
+
+        ctx.yieldPipeFoot ( clear ( _scratch ) );
+        ctx.yieldPipeFoot ( clear ( _heap ) );
+    }
+
+};
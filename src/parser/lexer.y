@@ -72,6 +72,14 @@ ID       [a-z][a-z0-9_]*
     return BULK_INSERT_TK;
 }
 
+"primary key" {
+    return PRIMARY_KEY_TK;
+}
+
+"unique" {
+    return UNIQUE_TK;
+}
+
 "fieldterminator" {
     return FIELDTERMINATOR_TK;
 }
@@ -84,6 +92,14 @@ ID       [a-z][a-z0-9_]*
     return WITH_TK;
 }
 
+"prepare" {
+    return PREPARE_TK;
+}
+
+"execute" {
+    return EXECUTE_TK;
+}
+
 "sum" {
     return SUM_TK;
 }
@@ -160,6 +176,10 @@ ID       [a-z][a-z0-9_]*
     return COMMA;
 }
 
+"?" {
+    return PARAMETER_TK;
+}
+
 "::" {
     return TYPECAST_TK;
 }
@@ -172,6 +192,14 @@ ID       [a-z][a-z0-9_]*
     return IN_TK;
 }
 
+"not" {
+    return NOT_TK;
+}
+
+"exists" {
+    return EXISTS_TK;
+}
+
 "like" {
     return LIKE_TK;
 }
@@ -36,7 +36,9 @@ struct Query {
         CONTROL,
         SELECT,
         CREATE_TABLE,
-        BULK_INSERT
+        BULK_INSERT,
+        PREPARE,
+        EXECUTE
     };
     Tag tag;
 
@@ -53,6 +55,9 @@ struct Query {
     /* Create table statement */
     Expr* schemaExpr;
 
+    /* Attributes of primary key and unique constraints */
+    std::vector < std::vector < std::string > > uniqueKeys;
+
     /* Bulk insert statement */
     std::string fileName;
     std::string fieldTerminator;
@@ -79,6 +84,11 @@ struct Query {
     bool useLimit;
     size_t limit;
 
+    /* Prepared statements */
+    std::string statementName;
+    Expr*       argumentExpr;
+    size_t      numParameters;
+
 };
 
 
@@ -135,6 +145,7 @@ Query parseSql ( std::string sql ) {
         nullptr, 
         "", 
         nullptr, 
+        {},
         "",
         ",",
         0,
@@ -145,6 +156,9 @@ Query parseSql ( std::string sql ) {
         {},
         false,
         false,
+        0,
+        "",
+        nullptr,
         0
     };
 
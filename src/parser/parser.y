@@ -12,7 +12,7 @@
 %left LT_TK GT_TK LE_TK GE_TK.
 %left EQ_TK NEQ_TK.
 %left BETWEEN_TK.
-%left IN_TK.
+%left IN_TK NOT_TK.
 %left PLUS_TK MINUS_TK.
 %left MUL_TK DIV_TK.
 %left LIKE_TK.
@@ -41,6 +41,30 @@ entry ::= select from where groupby orderby limit.
 }
 
 
+/* prepared statements */
+entry ::= PREPARE_TK IDENTIFIER(A) AS_TK select from where groupby orderby limit.
+{
+    query->tag = Query::PREPARE;
+    query->statementName = A->symbol;
+}
+
+entry ::= EXECUTE_TK IDENTIFIER(A) LPAREN valueList(B) RPAREN.
+{
+    query->tag = Query::EXECUTE;
+    query->statementName = A->symbol;
+    query->argumentExpr = B;
+}
+
+entry ::= EXECUTE_TK IDENTIFIER(A).
+{
+    query->tag = Query::EXECUTE;
+    query->statementName = A->symbol;
+}
+
+valueList(A) ::= value(B) COMMA valueList(C).     { B->next = C; A = B; }
+valueList(A) ::= value(B).                        { A = B; }
+
+
 importWith  ::= .
 importWith  ::= WITH_TK LPAREN csvSpecList RPAREN.
 csvSpecList ::= csvSpec COMMA csvSpecList.
@@ -50,7 +74,29 @@ csvSpec     ::= FIELDTERMINATOR_TK EQ_TK STRING_CONSTANT(A). { query->fieldTermi
 
 schema(A)      ::= schemaElem(B) COMMA schema(C).  { B->next = C; A = B; } 
 schema(A)      ::= schemaElem(B).                  { A = B; }
+schema(A)      ::= keySpec COMMA schema(B).        { A = B; }
+schema(A)      ::= keySpec.                        { A = nullptr; }
 schemaElem(A)  ::= IDENTIFIER(B) type(C).          { A = ExprGen::attr ( B->symbol ); A->type = C->type; } 
+schemaElem(A)  ::= IDENTIFIER(B) type(C) keyType.
+{
+    A = ExprGen::attr ( B->symbol ); 
+    A->type = C->type; 
+    query->uniqueKeys.push_back ( { B->symbol } );
+} 
+
+/* primary key and unique constraints */
+keyType        ::= PRIMARY_KEY_TK.
+keyType        ::= UNIQUE_TK.
+keySpec        ::= keyType LPAREN keyList(A) RPAREN.
+{
+    std::vector < std::string > key;
+    for ( Expr* e = A; e != nullptr; e = e->next ) {
+        key.push_back ( e->symbol );
+    }
+    query->uniqueKeys.push_back ( key );
+}
+keyList(A)     ::= IDENTIFIER(B) COMMA keyList(C). { B->next = C; A = B; }
+keyList(A)     ::= IDENTIFIER(B).                  { A = B; }
 
 select      ::= SELECT_TK namableExprList(A).      { query->selectExpr = A; }
 select      ::= SELECT_TK MUL_TK.                  { query->selectExpr = ExprGen::star(); }
@@ -60,7 +106,7 @@ where       ::= WHERE   expr(A).                   { query->whereExpr  = A; }
 where       ::= .
 groupby     ::= GROUPBY exprList(A).               { query->groupbyExpr  = A; }
 groupby     ::= .
-orderby     ::= ORDERBY exprList(A).               { query->orderbyExpr  = A; }
+orderby     ::= ORDERBY orderList(A).              { query->orderbyExpr  = A; }
 orderby     ::= .
 limit       ::= LIMIT_TK INTEGER_CONSTANT(A).      { 
     query->useLimit = true; 
@@ -116,11 +162,12 @@ expr(A)     ::= COUNT_TK LPAREN starOrExpr(B) RPAREN.
 expr(A)     ::= LPAREN expr(B) RPAREN.            { A = B; }
 expr(A)     ::= IDENTIFIER.                       { A = ExprGen::attr ( A->symbol ); }
 expr(A)     ::= value(B).                         { A = B; }
-expr(A)     ::= IDENTIFIER ASC_TK.                { A = ExprGen::asc  ( ExprGen::attr ( A->symbol ) ); }
-expr(A)     ::= IDENTIFIER DESC_TK.               { A = ExprGen::desc ( ExprGen::attr ( A->symbol ) ); }
-/*todo..*/
-/*expr(A)     ::= expr(B) ASC_TK.                { A = ExprGen::asc  ( child ); }*/
-/*expr(A)     ::= expr(B) DESC_TK.               { A = ExprGen::desc ( child ); }*/
+
+orderList(A) ::= orderExpr(B) COMMA orderList(C). { B->next = C; A = B; }
+orderList(A) ::= orderExpr(B).                    { A = B; }
+orderExpr(A) ::= expr(B).                         { A = B; }
+orderExpr(A) ::= expr(B) ASC_TK.                  { A = ExprGen::asc  ( B ); }
+orderExpr(A) ::= expr(B) DESC_TK.                 { A = ExprGen::desc ( B ); }
 
 starOrExpr(A) ::= MUL_TK.                         { A = ExprGen::star ( ); }
 starOrExpr(A) ::= expr(B).                        { A = B; }
@@ -138,6 +185,22 @@ expr(A) ::= expr(B) IN_TK LPAREN exprList(C) RPAREN. {
     A = res;
 }
 
+/* subqueries */
+expr(A) ::= expr(B) IN_TK LPAREN subquery(C) RPAREN.         { A = ExprGen::inSubquery    ( B, C ); }
+expr(A) ::= expr(B) NOT_TK IN_TK LPAREN subquery(C) RPAREN.  { A = ExprGen::notInSubquery ( B, C ); }
+expr(A) ::= EXISTS_TK LPAREN subquery(B) RPAREN.             { A = ExprGen::exists        ( B ); }
+expr(A) ::= NOT_TK EXISTS_TK LPAREN subquery(B) RPAREN.      { A = ExprGen::notExists     ( B ); }
+subquery(A) ::= SELECT_TK MUL_TK FROM tableList(B) subqueryWhere(C).  
+{ 
+    A = ExprGen::subquery ( ExprGen::star(), B, C ); 
+}
+subquery(A) ::= SELECT_TK expr(B) FROM tableList(C) subqueryWhere(D). 
+{ 
+    A = ExprGen::subquery ( B, C, D ); 
+}
+subqueryWhere(A) ::= .                            { A = nullptr; }
+subqueryWhere(A) ::= WHERE expr(B).               { A = B; }
+
 /* case */
 expr(A) ::= CASE_TK whenThenList(B) else(C) END_TK. {
     B->next = C;
@@ -158,6 +221,7 @@ value       ::= DECIMAL_CONSTANT.
 value       ::= FLOAT_CONSTANT.
 value       ::= STRING_CONSTANT.
 value(A)    ::= DATE_TK STRING_CONSTANT(B).       { A = ExprGen::constant ( B->symbol, SqlType::DATE ); }
+value(A)    ::= PARAMETER_TK.                     { A = ExprGen::parameter ( query->numParameters++ ); }
 
 /* types for typecast and schemas */
 type(A)     ::= INT_TK.                          { A = ExprGen::type ( TypeInit::INT() ); }
@@ -7,8 +7,6 @@
 #pragma once
 
 
-
-
 Expr* matchAndUnify ( Expr*   select,
                       Expr*   group ) {
     
@@ -168,8 +166,6 @@ bool getNameOfMatchingTable ( std::vector < std::string >&  symbols,
 }
 
 
-
-
 /* returns the remaining selection conditions */
 ExprVec pushDownSelection ( ExprVec&   from, 
                             ExprVec&   where, 
@@ -215,28 +211,27 @@ struct JoinMapElement {
 
 
 
-bool isUniqueAttribute ( Expr*      expr,
-                         Database&  db ) {
+/* Returns whether the attributes contain a primary key or unique *
+ * constraint of a table and thus match at most one of its tuples. */
+bool isUniqueKey ( SymbolSet&  attributes,
+                   Database&   db ) {
 
-    if ( expr->tag == Expr::ATTRIBUTE ) {
-   
-        if ( expr->symbol.compare ( "o_orderkey" ) == 0 ) {
-            return true;
-        }
-        if ( expr->symbol.compare ( "p_partkey" ) == 0 ) {
-            return true;
-        }
-        if ( expr->symbol.compare ( "s_suppkey" ) == 0 ) {
-            return true;
-        }
-        if ( expr->symbol.compare ( "n_nationkey" ) == 0 ) {
-            return true;
-        }
-        if ( expr->symbol.compare ( "r_regionkey" ) == 0 ) {
+    for ( auto& rel : db.relations ) {
+        if ( rel.second.hasUniqueKey ( attributes ) ) {
             return true;
         }
     }
+    return false;
+}
+
 
+bool isUniqueAttribute ( Expr*      expr,
+                         Database&  db ) {
+
+    if ( expr->tag == Expr::ATTRIBUTE ) {
+        SymbolSet attributes = { expr->symbol };
+        return isUniqueKey ( attributes, db );
+    }
     return false;
 }
 
@@ -251,30 +246,385 @@ Expr* conjunction ( ExprVec vec ) {
 }
 
 
-typedef std::pair < std::string, std::string > RelationPair;
 typedef std::pair < Expr*, Expr* > ExprPair;
 
 
+/* Attributes on one side of equalities */
+SymbolSet equalityAttributes ( std::vector < ExprPair >&  equalities,
+                               bool                       firstSide ) {
+    SymbolSet res;
+    for ( auto& eq : equalities ) {
+        Expr* e = firstSide ? eq.first : eq.second;
+        if ( e->tag == Expr::ATTRIBUTE ) {
+            res.insert ( e->symbol );
+        }
+    }
+    return res;
+}
+
+
+/* Scans keep the storage order of a table within each morsel */
+bool isOrderedScan ( RelOperator* op ) {
+    if ( op->tag == RelOperator::SELECTION ) {
+        op = op->_child;
+    }
+    return op->tag == RelOperator::SCAN;
+}
 
-/* returns the remaining selection conditions */
+
+/* A merge join replaces the hash join when both tables are clustered *
+ * by a single integer join key and are not joined yet.               */
+bool isMergeJoinCandidate ( std::vector < ExprPair >&  equalities,
+                            std::string&               nameA,
+                            std::string&               nameB,
+                            Query&                     query,
+                            Database&                  db ) {
+
+    if ( equalities.size() != 1 ) return false;
+    Expr* a = equalities[0].first;
+    Expr* b = equalities[0].second;
+    if ( a->tag != Expr::ATTRIBUTE || b->tag != Expr::ATTRIBUTE ) return false;
+
+    Relation& relA = db.relations [ nameA ];
+    Relation& relB = db.relations [ nameB ];
+    if ( !relA.isSortedBy ( a->symbol ) || !relB.isSortedBy ( b->symbol ) ) return false;
+
+    RelOperator* opA = query.planTables [ nameA ].op;
+    RelOperator* opB = query.planTables [ nameB ].op;
+    return opA != opB && isOrderedScan ( opA ) && isOrderedScan ( opB );
+}
+
+
+/* Exhaustive join enumeration up to this number of tables, greedy above */
+const size_t MaxJoinEnumerationTables = 12;
+
+
+/* Join graph with one node per table and the equalities between tables */
+struct JoinGraph {
+
+    std::vector < std::string > tables;
+
+    /* estimated cardinality of each table after selections */
+    std::vector < double > cardinalities;
+
+    /* equalities between table i and table j oriented as (i, j) with i < j */
+    std::map < std::pair < size_t, size_t >, std::vector < ExprPair > > edges;
+};
+
+
+/* Best join tree for a set of tables */
+struct JoinPlan {
+    double    cardinality;
+    double    cost;
+    uint64_t  left;
+    uint64_t  right;
+};
+
+
+/* Rough selectivity of selection conditions without statistics */
+double estimateTableCardinality ( RelOperator*  op,
+                                  Relation&     rel ) {
+    double card = rel.tupleNum();
+    if ( op->tag == RelOperator::SELECTION ) {
+        StatisticsLookup lookup = [&rel] ( const std::string& attribute ) {
+            return rel._statistics.column ( attribute );
+        };
+        card *= estimateSelectivity ( ((SelectionOp*)op)->_condition, lookup );
+    }
+    return std::max ( card, 1.0 );
+}
+
+
+/* Statistics of an attribute of a table or nullptr */
+ColumnStatistics* attributeStatistics ( Expr*         expr,
+                                        std::string&  name,
+                                        Database&     db ) {
+    if ( expr->tag != Expr::ATTRIBUTE ) return nullptr;
+    return db.relations [ name ]._statistics.column ( expr->symbol );
+}
+
+
+/* Selectivity of the equalities between two tables. Each equality with  *
+ * a unique attribute matches one tuple of its table. Other equalities   *
+ * match 1 / max ( distinct values ) with statistics and are otherwise   *
+ * assumed to match one tuple of the larger table. The most selective    *
+ * equality is used, because multi-attribute keys correlate.             */
+double estimateEdgeSelectivity ( std::vector < ExprPair >&  equalities,
+                                 std::string&               nameA,
+                                 std::string&               nameB,
+                                 Database&                  db ) {
+
+    double sizeA = std::max ( (double) db.relations [ nameA ].tupleNum(), 1.0 );
+    double sizeB = std::max ( (double) db.relations [ nameB ].tupleNum(), 1.0 );
+    double sel = 1.0;
+    for ( auto& eq : equalities ) {
+        double eqSel = 1.0 / std::max ( sizeA, sizeB );
+        ColumnStatistics* statsA = attributeStatistics ( eq.first, nameA, db );
+        ColumnStatistics* statsB = attributeStatistics ( eq.second, nameB, db );
+        if ( statsA != nullptr && statsB != nullptr ) {
+            eqSel = 1.0 / std::max ( statsA->distinct, statsB->distinct );
+        }
+        if ( isUniqueAttribute ( eq.first, db ) ) {
+            eqSel = 1.0 / sizeA;
+        }
+        else if ( isUniqueAttribute ( eq.second, db ) ) {
+            eqSel = 1.0 / sizeB;
+        }
+        sel = std::min ( sel, eqSel );
+    }
+
+    /* composite keys */
+    SymbolSet attributesA = equalityAttributes ( equalities, true );
+    SymbolSet attributesB = equalityAttributes ( equalities, false );
+    if ( isUniqueKey ( attributesA, db ) ) {
+        sel = std::min ( sel, 1.0 / sizeA );
+    }
+    if ( isUniqueKey ( attributesB, db ) ) {
+        sel = std::min ( sel, 1.0 / sizeB );
+    }
+    return sel;
+}
+
+
+double estimateJoinCardinality ( JoinGraph&  graph,
+                                 uint64_t    set,
+                                 Database&   db ) {
+    double card = 1.0;
+    for ( size_t i = 0; i < graph.tables.size(); i++ ) {
+        if ( set & ( 1ull << i ) ) card *= graph.cardinalities [ i ];
+    }
+    for ( auto& edge : graph.edges ) {
+        uint64_t edgeSet = ( 1ull << edge.first.first ) | ( 1ull << edge.first.second );
+        if ( ( set & edgeSet ) == edgeSet ) {
+            card *= estimateEdgeSelectivity ( edge.second,
+                                              graph.tables [ edge.first.first ],
+                                              graph.tables [ edge.first.second ],
+                                              db );
+        }
+    }
+    return std::max ( card, 1.0 );
+}
+
+
+bool isConnected ( JoinGraph&  graph,
+                   uint64_t    setA,
+                   uint64_t    setB ) {
+    for ( auto& edge : graph.edges ) {
+        uint64_t i = 1ull << edge.first.first;
+        uint64_t j = 1ull << edge.first.second;
+        if ( ( ( setA & i ) && ( setB & j ) ) || ( ( setA & j ) && ( setB & i ) ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Enumerates bushy join trees of connected subsets by dynamic programming *
+ * over the subsets of the tables. The cost of a tree is the sum of its    *
+ * intermediate result cardinalities. Cross products are not considered,  *
+ * so each connected component of the join graph gets its own tree.       */
+std::map < uint64_t, JoinPlan > enumerateJoinsDP ( JoinGraph&  graph,
+                                                   Database&   db ) {
+
+    std::map < uint64_t, JoinPlan > plans;
+    size_t n = graph.tables.size();
+    for ( size_t i = 0; i < n; i++ ) {
+        plans [ 1ull << i ] = { graph.cardinalities [ i ], 0.0, 0, 0 };
+    }
+    for ( uint64_t set = 1; set < ( 1ull << n ); set++ ) {
+        if ( __builtin_popcountll ( set ) < 2 ) continue;
+        uint64_t lowest = set & ( ~set + 1 );
+        double card = -1.0;
+
+        /* pairs of connected subsets that contain the lowest table on the left */
+        for ( uint64_t left = ( set - 1 ) & set; left > 0; left = ( left - 1 ) & set ) {
+            if ( ( left & lowest ) == 0 ) continue;
+            uint64_t right = set & ~left;
+            if ( plans.count ( left ) == 0 || plans.count ( right ) == 0 ) continue;
+            if ( !isConnected ( graph, left, right ) ) continue;
+            if ( card < 0.0 ) {
+                card = estimateJoinCardinality ( graph, set, db );
+            }
+            double cost = plans [ left ].cost + plans [ right ].cost + card;
+            if ( plans.count ( set ) == 0 || cost < plans [ set ].cost ) {
+                plans [ set ] = { card, cost, left, right };
+            }
+        }
+    }
+    return plans;
+}
+
+
+/* Greedy operator ordering for queries with many tables. Repeatedly joins *
+ * the two connected trees with the smallest result cardinality.           */
+std::map < uint64_t, JoinPlan > enumerateJoinsGreedy ( JoinGraph&  graph,
+                                                       Database&   db ) {
+
+    std::map < uint64_t, JoinPlan > plans;
+    std::vector < uint64_t > trees;
+    for ( size_t i = 0; i < graph.tables.size(); i++ ) {
+        plans [ 1ull << i ] = { graph.cardinalities [ i ], 0.0, 0, 0 };
+        trees.push_back ( 1ull << i );
+    }
+    while ( true ) {
+        double bestCard = -1.0;
+        size_t bestA = 0;
+        size_t bestB = 0;
+        for ( size_t a = 0; a < trees.size(); a++ ) {
+            for ( size_t b = a + 1; b < trees.size(); b++ ) {
+                if ( !isConnected ( graph, trees [ a ], trees [ b ] ) ) continue;
+                double card = estimateJoinCardinality ( graph, trees [ a ] | trees [ b ], db );
+                if ( bestCard < 0.0 || card < bestCard ) {
+                    bestCard = card;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+        if ( bestCard < 0.0 ) break;
+        uint64_t left  = trees [ bestA ];
+        uint64_t right = trees [ bestB ];
+        double cost = plans [ left ].cost + plans [ right ].cost + bestCard;
+        plans [ left | right ] = { bestCard, cost, left, right };
+        trees [ bestA ] = left | right;
+        trees.erase ( trees.begin() + bestB );
+    }
+    return plans;
+}
+
+
+/* Splits a join set of the enumerated plans into build side (left) and *
+ * probe side (right). The input with the smaller estimated cardinality *
+ * becomes the build side.                                              */
+void joinSides ( uint64_t                          set,
+                 std::map < uint64_t, JoinPlan >&  plans,
+                 uint64_t&                         left,
+                 uint64_t&                         right ) {
+
+    JoinPlan& plan = plans [ set ];
+    left  = plan.left;
+    right = plan.right;
+    if ( plans [ left ].cardinality > plans [ right ].cardinality ) {
+        std::swap ( left, right );
+    }
+}
+
+
+/* Equalities between both sides with the build side's expression first */
+std::vector < ExprPair > joinEqualities ( uint64_t     left,
+                                          uint64_t     right,
+                                          JoinGraph&   graph ) {
+
+    std::vector < ExprPair > equalities;
+    for ( auto& edge : graph.edges ) {
+        uint64_t i = 1ull << edge.first.first;
+        uint64_t j = 1ull << edge.first.second;
+        for ( auto& eq : edge.second ) {
+            if ( ( left & i ) && ( right & j ) ) {
+                equalities.push_back ( eq );
+            }
+            else if ( ( left & j ) && ( right & i ) ) {
+                equalities.push_back ( std::make_pair ( eq.second, eq.first ) );
+            }
+        }
+    }
+    return equalities;
+}
+
+
+/* Attributes are unique in the result of a join set when they contain a *
+ * declared key of one of its tables and the table is only on the probe  *
+ * side of joins that match a unique build key.                         */
+bool isUniqueInJoinSet ( uint64_t                          set,
+                         SymbolSet&                        attributes,
+                         std::map < uint64_t, JoinPlan >&  plans,
+                         JoinGraph&                        graph,
+                         Database&                         db ) {
+
+    if ( __builtin_popcountll ( set ) == 1 ) {
+        auto rel = db.relations.find ( graph.tables [ __builtin_ctzll ( set ) ] );
+        return rel != db.relations.end() && rel->second.hasUniqueKey ( attributes );
+    }
+    uint64_t left, right;
+    joinSides ( set, plans, left, right );
+    std::vector < ExprPair > equalities = joinEqualities ( left, right, graph );
+    SymbolSet buildAttributes = equalityAttributes ( equalities, true );
+    return isUniqueInJoinSet ( left, buildAttributes, plans, graph, db )
+        && isUniqueInJoinSet ( right, attributes, plans, graph, db );
+}
+
+
+/* Creates the join operators for a tree of the enumerated plans. */
+RelOperator* createJoinTree ( uint64_t                          set,
+                              std::map < uint64_t, JoinPlan >&  plans,
+                              JoinGraph&                        graph,
+                              Query&                            query,
+                              Database&                         db ) {
+
+    if ( __builtin_popcountll ( set ) == 1 ) {
+        size_t table = __builtin_ctzll ( set );
+        return query.planTables [ graph.tables [ table ] ].op;
+    }
+
+    uint64_t left, right;
+    joinSides ( set, plans, left, right );
+    std::vector < ExprPair > equalities = joinEqualities ( left, right, graph );
+
+    /* each probe matches at most one build tuple when the build side's *
+     * attributes contain a declared key that stays unique in the build *
+     * side's joins                                                     */
+    SymbolSet buildAttributes = equalityAttributes ( equalities, true );
+    bool singleMatch = isUniqueInJoinSet ( left, buildAttributes, plans, graph, db );
+    ExprVec cond;
+    for ( auto& eq : equalities ) {
+        eq.second->next = nullptr;
+        cond.push_back ( ExprGen::eq ( eq.first, eq.second ) );
+    }
+
+    RelOperator* a = createJoinTree ( left, plans, graph, query, db );
+    RelOperator* b = createJoinTree ( right, plans, graph, query, db );
+
+    bool isBaseJoin = __builtin_popcountll ( left ) == 1 && __builtin_popcountll ( right ) == 1;
+    if ( isBaseJoin ) {
+        std::string nameA = graph.tables [ __builtin_ctzll ( left ) ];
+        std::string nameB = graph.tables [ __builtin_ctzll ( right ) ];
+        if ( isMergeJoinCandidate ( equalities, nameA, nameB, query, db ) ) {
+            return new MergeJoinOp ( cond[0], a, b );
+        }
+    }
+    HashJoinOp* hj = new HashJoinOp ( cond, a, b );
+    hj->_singleMatch = singleMatch;
+    return hj;
+}
+
+
+/* Joins the tables with equality conditions in the order of the join *
+ * enumeration. Returns the remaining selection conditions.          */
 ExprVec addEqualityHashJoins ( ExprVec&   from, 
                                ExprVec&   where, 
                                Query&     query, 
                                Database&  db ) {
-    ExprVec equalities;
+
+    if ( query.planTables.size() > 64 ) {
+        throw ResqlError ( "Queries with more than 64 tables are not supported." );
+    }
+
+    JoinGraph graph;
+    std::map < std::string, size_t > tableIds;
+    for ( auto& pt : query.planTables ) {
+        tableIds [ pt.first ] = graph.tables.size();
+        graph.tables.push_back ( pt.first );
+        graph.cardinalities.push_back ( estimateTableCardinality ( pt.second.op, db.relations [ pt.first ] ) );
+    }
+
+    /* Match equality conditions with tables in 'from'-clause */
     ExprVec remaining;
     for ( Expr* eq : where ) {
         if ( eq->tag != Expr::EQ ) {
             remaining.push_back ( eq );
             continue;
         }
-        equalities.push_back ( eq );
-    }
-
-    std::map < RelationPair, std::vector <ExprPair> >  joinMap;
-
-    /* Match equality conditions with tables in 'from'-clause */
-    for ( Expr* eq : equalities ) {
         std::vector < std::string > leftAttr = collectAttributes ( eq->child );
         std::vector < std::string > rightAttr = collectAttributes ( eq->child->next ); 
         std::string nameA = "";
@@ -285,108 +635,178 @@ ExprVec addEqualityHashJoins ( ExprVec&   from,
 
         /* Could not find a single table that contains all attributes *
          * on one or both sides of the condition                      */
-        if ( (!matchA) || (!matchB) ) {
+        if ( (!matchA) || (!matchB) || nameA == nameB ) {
             remaining.push_back ( eq );
             continue;
         }
 
+        size_t i = tableIds [ nameA ];
+        size_t j = tableIds [ nameB ];
         Expr* a = eq->child;
         Expr* b = eq->child->next;
-
-        /* Move smaller relation to left (build) side */
-        if ( db.relations[nameA].tupleNum() >= db.relations[nameB].tupleNum() ) {
-            std::swap ( nameA, nameB );
+        if ( i > j ) {
+            std::swap ( i, j );
             std::swap ( a, b );
         }
+        graph.edges [ std::make_pair ( i, j ) ].push_back ( std::make_pair ( a, b ) );
+    }
+    if ( graph.edges.size() == 0 ) {
+        return remaining;
+    }
 
-        joinMap [ std::make_pair ( nameA, nameB ) ].push_back ( std::make_pair ( a, b ) ); 
-    }
-
-    /* Compute join order */
-    std::vector <std::pair <RelationPair, std::vector <ExprPair> > >  joinList;
-    for ( auto& join : joinMap ) {
-        joinList.push_back ( join );
-    }
-    std::sort ( 
-        joinList.begin(), 
-        joinList.end(),
-        [&db,&query] ( const std::pair <RelationPair, std::vector <ExprPair> > a, 
-                       const std::pair <RelationPair, std::vector <ExprPair> > b ) -> bool
-        { 
-            /* Compare two pairs of relations with their selection *
-             * predicates ontop: A and B.                          */
-            auto& relsA = a.first; // names
-            auto& relsB = b.first; 
-            RelOperator *opAR, *opAS, *opBR, *opBS; // get root of each plan piece
-            opAR = query.planTables [ relsA.first ].op;
-            opAS = query.planTables [ relsA.second ].op;
-            opBR = query.planTables [ relsB.first ].op;
-            opBS = query.planTables [ relsB.second ].op;
-            int numSelectionsA = 0;
-            int numSelectionsB = 0;
-            if ( opAR->tag == RelOperator::SELECTION ) numSelectionsA++;
-            if ( opAS->tag == RelOperator::SELECTION ) numSelectionsA++;
-            if ( opBR->tag == RelOperator::SELECTION ) numSelectionsB++;
-            if ( opBS->tag == RelOperator::SELECTION ) numSelectionsB++;
-            
-            if ( ( numSelectionsA > 0 || numSelectionsB > 0 )
-               && (numSelectionsA != numSelectionsB ) ){
-                /* Take pair that has more selection operators.   *
-                 * (two at most i.e. one selection ontop of each  *
-                 * relation)                                      */
-                return numSelectionsA > numSelectionsB;
-            } 
-            else {
-                /* Take pair with smaller right-hand size. *
-                 * The right-hand relation already is the  *
-                 * larger (probe) relation.                */
-                return ( db.relations [ relsA.second ].tupleNum() < db.relations [ relsB.second ].tupleNum() );
-            }
-        }
-    );
+    std::map < uint64_t, JoinPlan > plans;
+    if ( graph.tables.size() <= MaxJoinEnumerationTables ) {
+        plans = enumerateJoinsDP ( graph, db );
+    }
+    else {
+        plans = enumerateJoinsGreedy ( graph, db );
+    }
 
-    /* Genrate hash joins for tables that were matched by equality conditions */
-    for ( auto& join : joinList ) {
-        std::string nameA = join.first.first;
-        std::string nameB = join.first.second;
-       
-        bool singleMatch = false; 
-        ExprVec cond;
-        for ( auto eq : join.second ) {
-            if ( isUniqueAttribute ( eq.first, db ) ) {
-                singleMatch = true;
+    /* Create a join tree for each connected component. Supersets *
+     * have larger bitsets, so components come before their parts. */
+    std::vector < uint64_t > components;
+    for ( auto it = plans.rbegin(); it != plans.rend(); it++ ) {
+        bool covered = false;
+        for ( uint64_t c : components ) {
+            if ( ( c & it->first ) == it->first ) covered = true;
+        }
+        if ( !covered && __builtin_popcountll ( it->first ) > 1 ) {
+            components.push_back ( it->first );
+        }
+    }
+    for ( uint64_t component : components ) {
+        RelOperator* root = createJoinTree ( component, plans, graph, query, db );
+        for ( size_t i = 0; i < graph.tables.size(); i++ ) {
+            if ( component & ( 1ull << i ) ) {
+                PlanOperator& pt = query.planTables [ graph.tables [ i ] ];
+                query.planPieces.erase ( pt.op );
+                pt.op = root;
             }
-            cond.push_back ( ExprGen::eq ( eq.first, eq.second ) ); 
-            eq.second->next = nullptr;
         }
+        query.planPieces.insert ( root );
+        query.plan = root;
+    }
+    return remaining;
+}
 
-        RelOperator* a = query.planTables [ nameA ].op;
-        RelOperator* b = query.planTables [ nameB ].op;
 
-        /* already joined: add condition to existing join */
-        if ( a == b ) {
-            RelOperator* hj = query.planTables [ nameA ].op;
-            if ( hj->tag != RelOperator::HASHJOIN ) {
-                throw ResqlError ( "Planner expects operator to be hash join that is " + hj->name() );
-            }
-            ExprVec& eqs = ((HashJoinOp*)hj)->_equalities;
-            eqs.insert ( eqs.begin(), cond.begin(), cond.end() );
-            continue;
+struct BandBound {
+    Expr*  cond;
+    Expr*  key;
+    Expr*  bound;
+    bool   strict;
+};
+
+
+/* (key table, bound table, key attribute) -> lower and upper bounds */
+typedef std::tuple < std::string, std::string, std::string > BandKey;
+typedef std::pair < std::vector < BandBound >, std::vector < BandBound > > BandBounds;
+
+
+bool isBandJoinCandidate ( BandKey&    band,
+                           BandBound&  lower,
+                           BandBound&  upper,
+                           Query&      query,
+                           Database&   db ) {
+
+    Schema& keySchema   = db.relations [ std::get<0> ( band ) ]._schema;
+    Schema& boundSchema = db.relations [ std::get<1> ( band ) ]._schema;
+    SqlType types[] = { keySchema.getTypeByName ( lower.key->symbol ),
+                        boundSchema.getTypeByName ( lower.bound->symbol ),
+                        boundSchema.getTypeByName ( upper.bound->symbol ) };
+    int numDates = 0;
+    for ( SqlType& t : types ) {
+        if ( !MergeJoinOp::isMergeKeyType ( t ) ) return false;
+        if ( t.tag == SqlType::DATE ) numDates++;
+    }
+    if ( numDates != 0 && numDates != 3 ) return false;
+
+    RelOperator* opKey   = query.planTables [ std::get<0> ( band ) ].op;
+    RelOperator* opBound = query.planTables [ std::get<1> ( band ) ].op;
+    return opKey != opBound;
+}
+
+
+/* Combines plan pieces with band joins for conditions lo <= x <= hi  *
+ * that bound an integer attribute x of one table by attributes of    *
+ * another table. Returns the remaining selection conditions.         */
+ExprVec addBandJoins ( ExprVec&   where,
+                       Query&     query,
+                       Database&  db ) {
+
+    /* Each inequality bounds the attributes on both of its sides */
+    std::map < BandKey, BandBounds > bandMap;
+    for ( Expr* e : where ) {
+        bool isGreater = ( e->tag == Expr::GT || e->tag == Expr::GE );
+        bool isLess    = ( e->tag == Expr::LT || e->tag == Expr::LE );
+        if ( !isGreater && !isLess ) continue;
+
+        Expr* a = e->child;
+        Expr* b = e->child->next;
+        if ( a->tag != Expr::ATTRIBUTE || b->tag != Expr::ATTRIBUTE ) continue;
+
+        std::vector < std::string > symA = { a->symbol };
+        std::vector < std::string > symB = { b->symbol };
+        std::string nameA = "";
+        std::string nameB = "";
+        if ( !getNameOfMatchingTable ( symA, query, nameA ) ) continue;
+        if ( !getNameOfMatchingTable ( symB, query, nameB ) ) continue;
+        if ( nameA == nameB ) continue;
+
+        bool strict = ( e->tag == Expr::GT || e->tag == Expr::LT );
+        BandBounds& boundsA = bandMap [ std::make_tuple ( nameA, nameB, a->symbol ) ];
+        BandBounds& boundsB = bandMap [ std::make_tuple ( nameB, nameA, b->symbol ) ];
+        if ( isGreater ) {
+            boundsA.first.push_back  ( { e, a, b, strict } );
+            boundsB.second.push_back ( { e, b, a, strict } );
         }
+        else {
+            boundsA.second.push_back ( { e, a, b, strict } );
+            boundsB.first.push_back  ( { e, b, a, strict } );
+        }
+    }
 
-        RelOperator* hj = (RelOperator*) new HashJoinOp ( cond, a, b );
-        ((HashJoinOp*)hj)->_singleMatch = singleMatch;
-        query.planTables [ nameA ].op = hj;
-        query.planTables [ nameB ].op = hj;
-        query.planPieces.insert ( hj );
+    std::set < Expr* > used;
+    for ( auto& band : bandMap ) {
+        BandKey key = band.first;
+        auto& lowers = band.second.first;
+        auto& uppers = band.second.second;
+        if ( lowers.size() != 1 || uppers.size() != 1 ) continue;
+
+        BandBound lower = lowers[0];
+        BandBound upper = uppers[0];
+        if ( used.count ( lower.cond ) > 0 || used.count ( upper.cond ) > 0 ) continue;
+        if ( !isBandJoinCandidate ( key, lower, upper, query, db ) ) continue;
+        used.insert ( lower.cond );
+        used.insert ( upper.cond );
+
+        /* normalize to x >= lo and x <= hi */
+        lower.bound->next = nullptr;
+        upper.bound->next = nullptr;
+        Expr* lowerCond = lower.strict ? ExprGen::gt ( lower.key, lower.bound )
+                                       : ExprGen::ge ( lower.key, lower.bound );
+        Expr* upperCond = upper.strict ? ExprGen::lt ( upper.key, upper.bound )
+                                       : ExprGen::le ( upper.key, upper.bound );
+
+        RelOperator* a = query.planTables [ std::get<0> ( key ) ].op;
+        RelOperator* b = query.planTables [ std::get<1> ( key ) ].op;
+        RelOperator* bj = new BandJoinOp ( lowerCond, upperCond, a, b );
+        query.planPieces.insert ( bj );
         query.planPieces.erase ( a );
         query.planPieces.erase ( b );
         // update map tableName -> RelOperator*
         for ( auto& pt : query.planTables ) {
-            if ( pt.second.op == a ) pt.second.op = hj;
-            if ( pt.second.op == b ) pt.second.op = hj;
+            if ( pt.second.op == a ) pt.second.op = bj;
+            if ( pt.second.op == b ) pt.second.op = bj;
+        }
+        query.plan = bj;
+    }
+
+    ExprVec remaining;
+    for ( Expr* e : where ) {
+        if ( used.count ( e ) == 0 ) {
+            remaining.push_back ( e );
         }
-        query.plan = hj;
     }
     return remaining;
 }
@@ -404,30 +824,228 @@ std::map < std::string, SqlType > mapIdentifierTypes ( Database& db ) {
 }
 
 
+bool planContainsAttribute ( RelOperator*  op,
+                             std::string&  symbol ) {
+
+    if ( op->tag == RelOperator::SCAN ) {
+        return ((ScanOp*)op)->_rel->_schema.contains ( symbol );
+    }
+    for ( auto c : op->children ) {
+        if ( planContainsAttribute ( c, symbol ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* A hash join with aggregation ontop can be fused to a groupjoin when *
+ * the groups are determined by a unique build key and all groups can  *
+ * be computed from the build side.                                    */
+bool isGroupJoinCandidate ( RelOperator*  plan,
+                            ExprVec&      aggregations,
+                            ExprVec&      groupby,
+                            Database&     db ) {
+
+    if ( plan->tag != RelOperator::HASHJOIN ) return false;
+    HashJoinOp* hj = (HashJoinOp*) plan;
+    if ( !hj->_singleMatch ) return false;
+    if ( aggregations.size() == 0 || groupby.size() == 0 ) return false;
+
+    std::map < std::string, SqlType > types = mapIdentifierTypes ( db );
+    bool groupsContainUniqueKey = false;
+    for ( Expr* grp : groupby ) {
+        if ( grp->tag != Expr::ATTRIBUTE ) return false;
+        bool isBuildAttribute = planContainsAttribute ( hj->_lChild, grp->symbol );
+        for ( Expr* eq : hj->_equalities ) {
+            Expr* left  = eq->child;
+            Expr* right = eq->child->next;
+            if ( left->tag != Expr::ATTRIBUTE ) continue;
+            bool matchLeft  = ( left->symbol == grp->symbol );
+            bool matchRight = ( right->tag == Expr::ATTRIBUTE && right->symbol == grp->symbol );
+            if ( matchRight && equalTypes ( types [ left->symbol ], types [ right->symbol ] ) ) {
+                isBuildAttribute = true;
+            }
+            if ( ( matchLeft || matchRight ) && isUniqueAttribute ( left, db ) ) {
+                groupsContainUniqueKey = true;
+            }
+        }
+        if ( !isBuildAttribute ) return false;
+    }
+    return groupsContainUniqueKey;
+}
 
 
-void buildQuery ( Query& query, Database& db ) {
-    
-    /* Prepare query elements */
-    ExprVec select  = exprListToVector ( query.selectExpr ); 
-    ExprVec from    = exprListToVector ( query.fromExpr ); 
-    ExprVec where   = collectChildrenOfTopLevelConjunctions ( query.whereExpr );
-    ExprVec groupby = exprListToVector ( query.groupbyExpr ); 
-    ExprVec orderby = exprListToVector ( query.orderbyExpr );
-   
-    if ( query.selectExpr->tag == Expr::STAR ) {
-        query.requestAll = true;
-        if ( from.size() == 0 ) throw ResqlError ( "Need from-clause for 'select *'" );     
-    }    
+RelOperator* addAggregation ( ExprVec&      aggregations,
+                              ExprVec&      groupby,
+                              RelOperator*  plan,
+                              Database&     db ) {
 
-    /* Use same Expr* in 'select' and 'groupby' clause */
-    unifySelectAndGroupby ( select, groupby );
-    
-    /* Use same Expr* in 'select' and 'orderby' clause */
-    // todo:
+    if ( !isGroupJoinCandidate ( plan, aggregations, groupby, db ) ) {
+        return new AggregationOp ( aggregations, groupby, plan );
+    }
 
-    /* Extract aggregations from 'select' caluse */
-    ExprVec aggregations = filterExprVec ( select, &isAggregationExpr );
+    HashJoinOp* hj = (HashJoinOp*) plan;
+    RelOperator* gj = new GroupJoinOp ( aggregations,
+                                        groupby,
+                                        hj->_equalities,
+                                        hj->_lChild,
+                                        hj->_rChild );
+    hj->children.clear();
+    delete hj;
+    return gj;
+}
+
+
+bool isSubqueryExpr ( Expr* e ) {
+    return e->tag == Expr::EXISTS
+        || e->tag == Expr::NOT_EXISTS
+        || e->tag == Expr::IN_SUBQUERY
+        || e->tag == Expr::NOT_IN_SUBQUERY;
+}
+
+
+bool isAttributeOfTables ( const std::string&  symbol,
+                           ExprVec&            tables,
+                           Database&           db ) {
+
+    for ( Expr* tbl : tables ) {
+        if ( db.relations.count ( tbl->symbol ) > 0
+          && db.relations [ tbl->symbol ]._schema.contains ( symbol ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Checks whether all attributes of an expression belong to the tables */
+bool isExprOnTables ( Expr*       expr,
+                      ExprVec&    tables,
+                      Database&   db ) {
+
+    for ( auto& sym : collectAttributes ( expr ) ) {
+        if ( !isAttributeOfTables ( sym, tables, db ) ) return false;
+    }
+    return true;
+}
+
+
+RelOperator* buildJoinTree ( ExprVec&   from,
+                             ExprVec&   where,
+                             Query&     query,
+                             Database&  db );
+
+
+/* Rewrites an EXISTS or IN subquery to a semi join and NOT EXISTS or NOT IN *
+ * to an anti join ontop of the plan piece with the correlated table. The    *
+ * correlation conditions have to be equalities between an expression on    *
+ * the subquery tables and an expression on one table of the query. IN adds *
+ * the equality of the select expression and the probe expression.          */
+void addSubqueryJoin ( Expr*      subqueryCond,
+                       Query&     query,
+                       Database&  db ) {
+
+    bool anti = ( subqueryCond->tag == Expr::NOT_EXISTS 
+               || subqueryCond->tag == Expr::NOT_IN_SUBQUERY );
+    bool isIn = ( subqueryCond->tag == Expr::IN_SUBQUERY 
+               || subqueryCond->tag == Expr::NOT_IN_SUBQUERY );
+
+    Expr* probe = isIn ? subqueryCond->child : nullptr;
+    Expr* subquery = isIn ? probe->next : subqueryCond->child;
+    Expr* select = subquery->child;
+
+    /* children of the subquery: select, tables.., where */
+    ExprVec tables;
+    Expr* child = select->next;
+    while ( child != nullptr && child->tag == Expr::TABLE ) {
+        tables.push_back ( child );
+        child = child->next;
+    }
+    ExprVec where = collectChildrenOfTopLevelConjunctions ( child );
+    if ( isIn ) {
+        if ( select->tag == Expr::STAR ) {
+            throw ResqlError ( "IN subquery needs a select expression." );
+        }
+        select->next = nullptr;
+        probe->next = nullptr;
+        where.push_back ( ExprGen::eq ( select, probe ) );
+    }
+
+    /* Separate conditions within the subquery from correlations */
+    ExprVec inner;
+    ExprVec correlations;
+    SymbolSet outerSymbols;
+    for ( Expr* cond : where ) {
+        if ( isSubqueryExpr ( cond ) || isExprOnTables ( cond, tables, db ) ) {
+            inner.push_back ( cond );
+            continue;
+        }
+        if ( cond->tag == Expr::EQ ) {
+            Expr* a = cond->child;
+            Expr* b = cond->child->next;
+            if ( isExprOnTables ( b, tables, db ) ) {
+                std::swap ( a, b );
+            }
+            auto outerAttr = collectAttributes ( b );
+            bool isCorrelation = isExprOnTables ( a, tables, db );
+            for ( auto& sym : outerAttr ) {
+                isCorrelation &= !isAttributeOfTables ( sym, tables, db );
+            }
+            if ( isCorrelation && outerAttr.size() > 0 ) {
+                outerSymbols.insert ( outerAttr.begin(), outerAttr.end() );
+                b->next = nullptr;
+                correlations.push_back ( ExprGen::eq ( a, b ) );
+                continue;
+            }
+        }
+        throw ResqlError ( "Correlated subquery conditions have to be equalities." );
+    }
+    if ( correlations.size() == 0 ) {
+        throw ResqlError ( "Subquery needs a correlated equality condition." );
+    }
+
+    std::vector < std::string > symbols ( outerSymbols.begin(), outerSymbols.end() );
+    std::string tableName = "";
+    if ( !getNameOfMatchingTable ( symbols, query, tableName ) ) {
+        throw ResqlError ( "Correlated subquery attributes have to be from one table." );
+    }
+
+    /* Plan the subquery as build side */
+    Query subqueryPlan = {};
+    RelOperator* build = buildJoinTree ( tables, inner, subqueryPlan, db );
+
+    RelOperator* a = query.planTables [ tableName ].op;
+    RelOperator* sj = new SemiJoinOp ( correlations, anti, build, a );
+    query.planPieces.insert ( sj );
+    query.planPieces.erase ( a );
+    // update map tableName -> RelOperator*
+    for ( auto& pt : query.planTables ) {
+        if ( pt.second.op == a ) pt.second.op = sj;
+    }
+    query.plan = sj;
+}
+
+
+/* Creates the plan for the tables in 'from' with the 'where' conditions *
+ * as joins and selections. Returns the root of the plan.               */
+RelOperator* buildJoinTree ( ExprVec&   from,
+                             ExprVec&   where,
+                             Query&     query,
+                             Database&  db ) {
+
+    /* Subqueries are joined after the tables of the query */
+    ExprVec subqueries;
+    ExprVec conditions;
+    for ( Expr* e : where ) {
+        if ( isSubqueryExpr ( e ) ) {
+            subqueries.push_back ( e );
+        }
+        else {
+            conditions.push_back ( e );
+        }
+    }
+    where = conditions;
 
     /* add scans */
     for ( Expr* e : from ) {
@@ -448,6 +1066,14 @@ void buildQuery ( Query& query, Database& db ) {
     /* Creates plan pieces with hash joins */
     where = addEqualityHashJoins ( from, where, query, db );
 
+    /* Creates plan pieces with band joins for range conditions */
+    where = addBandJoins ( where, query, db );
+
+    /* Creates plan pieces with semi joins and anti joins for subqueries */
+    for ( Expr* e : subqueries ) {
+        addSubqueryJoin ( e, query, db );
+    }
+
     /* Combine plan pieces that were not joined yet *
      * with nested loops.                           */
     if ( query.planPieces.size() > 0 ) {
@@ -467,10 +1093,56 @@ void buildQuery ( Query& query, Database& db ) {
     if ( where.size() > 0 ) {
         query.plan = new SelectionOp ( conjunction ( where ), query.plan );
     }
+    return query.plan;
+}
+
+
+void buildQuery ( Query& query, Database& db ) {
+    
+    /* Prepare query elements */
+    ExprVec select  = exprListToVector ( query.selectExpr ); 
+    ExprVec from    = exprListToVector ( query.fromExpr ); 
+    ExprVec where   = collectChildrenOfTopLevelConjunctions ( query.whereExpr );
+    ExprVec groupby = exprListToVector ( query.groupbyExpr ); 
+    ExprVec orderby = exprListToVector ( query.orderbyExpr );
+   
+    if ( query.selectExpr->tag == Expr::STAR ) {
+        query.requestAll = true;
+        if ( from.size() == 0 ) throw ResqlError ( "Need from-clause for 'select *'" );     
+    }    
+
+    /* Use same Expr* in 'select' and 'groupby' clause */
+    unifySelectAndGroupby ( select, groupby );
+    
+    /* Use same Expr* in 'select' and 'orderby' clause */
+    // todo:
+
+    /* Extract aggregations from 'select' caluse */
+    ExprVec aggregations = filterExprVec ( select, &isAggregationExpr );
+
+    /* Above an aggregation only its groups and the columns of *
+     * the select clause are available to order by expressions */
+    if ( ( groupby.size() > 0 || aggregations.size() > 0 ) && query.selectExpr->tag != Expr::STAR ) {
+        SymbolSet columns;
+        for ( Expr* e : select ) {
+            columns.insert ( getExpressionName ( e ) );
+        }
+        for ( Expr* e : groupby ) {
+            columns.insert ( getExpressionName ( e ) );
+        }
+        for ( auto& symbol : extractRequiredAttributes ( orderby ) ) {
+            if ( columns.count ( symbol ) == 0 ) {
+                throw ResqlError ( "Order by attribute " + symbol + " is not grouped or selected." );
+            }
+        }
+    }
+
+    /* Join the tables in 'from' and apply the 'where' conditions */
+    buildJoinTree ( from, where, query, db );
 
     /* group by clause */
     if ( groupby.size() > 0 || aggregations.size() > 0 ) {
-        query.plan = new AggregationOp ( aggregations, groupby, query.plan );
+        query.plan = addAggregation ( aggregations, groupby, query.plan, db );
     }
 
     /* Select clause */
@@ -480,8 +1152,11 @@ void buildQuery ( Query& query, Database& db ) {
         }
     }
     
-    /* order by clause */
-    if (orderby.empty() == false) {
+    /* order by clause, with limit only the first tuples are kept */
+    if ( orderby.empty() == false && query.useLimit ) {
+        query.plan = new TopKOp ( std::move ( orderby ), query.limit, query.plan );
+    }
+    else if (orderby.empty() == false) {
         query.plan = new OrderByOp (std::move(orderby), query.plan);
     }
    
@@ -0,0 +1,218 @@
+/**
+ * @file
+ * Vectorized evaluation of selection predicates on batches of tuples.
+ * @author Henning Funke <henning.funke@cs.tu-dortmund.de>
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+#include "../util/defs.h"
+
+
+/* Comparison of a 4 or 8 byte integer attribute with a constant */
+struct FilterPredicate {
+
+    enum Comparison {
+        LT,
+        LE,
+        GT,
+        GE,
+        EQ,
+        NEQ
+    };
+
+    size_t      offset;
+    size_t      width;
+    Comparison  comparison;
+    int64_t     value;
+};
+
+
+/* Conjunction of predicates that is evaluated for batches of tuples */
+struct SimdFilter {
+
+    static const int BatchSize = 64;
+
+    size_t step;
+
+    std::vector < FilterPredicate > predicates;
+
+
+    /* Returns a mask with bit i set when the tuple at 'tuple + i * step'     *
+     * satisfies all predicates. Considers up to BatchSize tuples before end. */
+    static uint64_t evaluate ( SimdFilter* filter, Data* tuple, Data* end ) {
+        size_t n = ( end - tuple ) / filter->step;
+        if ( n > BatchSize ) n = BatchSize;
+        uint64_t mask = ( n == 64 ) ? ~0ULL : ( ( 1ULL << n ) - 1 );
+
+        for ( auto& p : filter->predicates ) {
+            if ( p.width == 4 ) {
+                mask &= evaluatePredicate < int32_t > ( p, tuple + p.offset, filter->step, n );
+            }
+            else {
+                mask &= evaluatePredicate < int64_t > ( p, tuple + p.offset, filter->step, n );
+            }
+            if ( mask == 0 ) break;
+        }
+        return mask;
+    }
+
+
+private:
+
+    template < typename T >
+    static bool compare ( T a, FilterPredicate::Comparison comparison, T b ) {
+        switch ( comparison ) {
+            case FilterPredicate::LT:  return a <  b;
+            case FilterPredicate::LE:  return a <= b;
+            case FilterPredicate::GT:  return a >  b;
+            case FilterPredicate::GE:  return a >= b;
+            case FilterPredicate::EQ:  return a == b;
+            case FilterPredicate::NEQ: return a != b;
+        }
+        return false;
+    }
+
+
+    /* Evaluates the tuples from 'first' to n one by one */
+    template < typename T >
+    static uint64_t evaluateScalar ( FilterPredicate&  p,
+                                     Data*             attribute,
+                                     size_t            step,
+                                     size_t            first,
+                                     size_t            n ) {
+        uint64_t mask = 0;
+        T value = (T) p.value;
+        for ( size_t i = first; i < n; i++ ) {
+            T a = *( (T*) ( attribute + i * step ) );
+            mask |= (uint64_t) compare ( a, p.comparison, value ) << i;
+        }
+        return mask;
+    }
+
+
+#if defined ( __AVX512F__ )
+
+    template < int Predicate >
+    static uint64_t gatherCompare32 ( Data* attribute, size_t step, size_t n, int32_t value ) {
+        __m512i index = _mm512_mullo_epi32 ( _mm512_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ),
+                                             _mm512_set1_epi32 ( (int32_t) step ) );
+        __m512i constant = _mm512_set1_epi32 ( value );
+        uint64_t mask = 0;
+        size_t i = 0;
+        for ( ; i + 16 <= n; i += 16 ) {
+            __m512i v = _mm512_mask_i32gather_epi32 ( _mm512_setzero_si512(), 0xFFFF, index, attribute + i * step, 1 );
+            mask |= (uint64_t) _mm512_cmp_epi32_mask ( v, constant, Predicate ) << i;
+        }
+        return mask;
+    }
+
+
+    template < int Predicate >
+    static uint64_t gatherCompare64 ( Data* attribute, size_t step, size_t n, int64_t value ) {
+        __m256i index = _mm256_mullo_epi32 ( _mm256_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7 ),
+                                             _mm256_set1_epi32 ( (int32_t) step ) );
+        __m512i constant = _mm512_set1_epi64 ( value );
+        uint64_t mask = 0;
+        size_t i = 0;
+        for ( ; i + 8 <= n; i += 8 ) {
+            __m512i v = _mm512_mask_i32gather_epi64 ( _mm512_setzero_si512(), 0xFF, index, attribute + i * step, 1 );
+            mask |= (uint64_t) _mm512_cmp_epi64_mask ( v, constant, Predicate ) << i;
+        }
+        return mask;
+    }
+
+
+    template < typename T >
+    static uint64_t evaluatePredicate ( FilterPredicate& p, Data* attribute, size_t step, size_t n ) {
+        static const size_t lanes = 64 / sizeof ( T );
+        uint64_t mask = 0;
+        if ( sizeof ( T ) == 4 ) {
+            int32_t value = (int32_t) p.value;
+            switch ( p.comparison ) {
+                case FilterPredicate::LT:  mask = gatherCompare32 < _MM_CMPINT_LT  > ( attribute, step, n, value ); break;
+                case FilterPredicate::LE:  mask = gatherCompare32 < _MM_CMPINT_LE  > ( attribute, step, n, value ); break;
+                case FilterPredicate::GT:  mask = gatherCompare32 < _MM_CMPINT_NLE > ( attribute, step, n, value ); break;
+                case FilterPredicate::GE:  mask = gatherCompare32 < _MM_CMPINT_NLT > ( attribute, step, n, value ); break;
+                case FilterPredicate::EQ:  mask = gatherCompare32 < _MM_CMPINT_EQ  > ( attribute, step, n, value ); break;
+                case FilterPredicate::NEQ: mask = gatherCompare32 < _MM_CMPINT_NE  > ( attribute, step, n, value ); break;
+            }
+        }
+        else {
+            switch ( p.comparison ) {
+                case FilterPredicate::LT:  mask = gatherCompare64 < _MM_CMPINT_LT  > ( attribute, step, n, p.value ); break;
+                case FilterPredicate::LE:  mask = gatherCompare64 < _MM_CMPINT_LE  > ( attribute, step, n, p.value ); break;
+                case FilterPredicate::GT:  mask = gatherCompare64 < _MM_CMPINT_NLE > ( attribute, step, n, p.value ); break;
+                case FilterPredicate::GE:  mask = gatherCompare64 < _MM_CMPINT_NLT > ( attribute, step, n, p.value ); break;
+                case FilterPredicate::EQ:  mask = gatherCompare64 < _MM_CMPINT_EQ  > ( attribute, step, n, p.value ); break;
+                case FilterPredicate::NEQ: mask = gatherCompare64 < _MM_CMPINT_NE  > ( attribute, step, n, p.value ); break;
+            }
+        }
+        return mask | evaluateScalar < T > ( p, attribute, step, n - n % lanes, n );
+    }
+
+#elif defined ( __AVX2__ )
+
+    /* Compares gathered values with a constant. The greater-than and equal *
+     * masks are combined and inverted to derive the other comparisons.     */
+    static uint64_t compareMask ( FilterPredicate::Comparison comparison,
+                                  uint64_t                    gt,
+                                  uint64_t                    lt,
+                                  uint64_t                    eq,
+                                  uint64_t                    lanes ) {
+        switch ( comparison ) {
+            case FilterPredicate::LT:  return lt;
+            case FilterPredicate::LE:  return ~gt & lanes;
+            case FilterPredicate::GT:  return gt;
+            case FilterPredicate::GE:  return ~lt & lanes;
+            case FilterPredicate::EQ:  return eq;
+            case FilterPredicate::NEQ: return ~eq & lanes;
+        }
+        return 0;
+    }
+
+
+    template < typename T >
+    static uint64_t evaluatePredicate ( FilterPredicate& p, Data* attribute, size_t step, size_t n ) {
+        static const size_t lanes = 32 / sizeof ( T );
+        uint64_t mask = 0;
+        size_t i = 0;
+        if ( sizeof ( T ) == 4 ) {
+            __m256i index = _mm256_mullo_epi32 ( _mm256_setr_epi32 ( 0, 1, 2, 3, 4, 5, 6, 7 ),
+                                                 _mm256_set1_epi32 ( (int32_t) step ) );
+            __m256i constant = _mm256_set1_epi32 ( (int32_t) p.value );
+            for ( ; i + lanes <= n; i += lanes ) {
+                __m256i v = _mm256_i32gather_epi32 ( (const int*) ( attribute + i * step ), index, 1 );
+                uint64_t gt = _mm256_movemask_ps ( _mm256_castsi256_ps ( _mm256_cmpgt_epi32 ( v, constant ) ) );
+                uint64_t lt = _mm256_movemask_ps ( _mm256_castsi256_ps ( _mm256_cmpgt_epi32 ( constant, v ) ) );
+                uint64_t eq = _mm256_movemask_ps ( _mm256_castsi256_ps ( _mm256_cmpeq_epi32 ( v, constant ) ) );
+                mask |= compareMask ( p.comparison, gt, lt, eq, 0xFF ) << i;
+            }
+        }
+        else {
+            __m128i index = _mm_mullo_epi32 ( _mm_setr_epi32 ( 0, 1, 2, 3 ),
+                                              _mm_set1_epi32 ( (int32_t) step ) );
+            __m256i constant = _mm256_set1_epi64x ( p.value );
+            for ( ; i + lanes <= n; i += lanes ) {
+                __m256i v = _mm256_i32gather_epi64 ( (const long long*) ( attribute + i * step ), index, 1 );
+                uint64_t gt = _mm256_movemask_pd ( _mm256_castsi256_pd ( _mm256_cmpgt_epi64 ( v, constant ) ) );
+                uint64_t lt = _mm256_movemask_pd ( _mm256_castsi256_pd ( _mm256_cmpgt_epi64 ( constant, v ) ) );
+                uint64_t eq = _mm256_movemask_pd ( _mm256_castsi256_pd ( _mm256_cmpeq_epi64 ( v, constant ) ) );
+                mask |= compareMask ( p.comparison, gt, lt, eq, 0xF ) << i;
+            }
+        }
+        return mask | evaluateScalar < T > ( p, attribute, step, i, n );
+    }
+
+#else
+
+    template < typename T >
+    static uint64_t evaluatePredicate ( FilterPredicate& p, Data* attribute, size_t step, size_t n ) {
+        return evaluateScalar < T > ( p, attribute, step, 0, n );
+    }
+
+#endif
+};
@@ -24,6 +24,8 @@ struct HashTable;
 
 static HashTable* allocateHashTable ( size_t minSize, int payloadSize );
 static void growHashTable ( HashTable* ht );
+static void reserveHashTable ( HashTable* ht, size_t minSize );
+static void clearHashTable ( HashTable* ht );
 static void freeHashTable ( HashTable* ht );
 static Data* ht_put ( HashTable* ht, uint64_t hash );
 void showHashTable ( HashTable* ht );
@@ -365,6 +367,22 @@ static void growHashTable ( HashTable* ht ) {
 } 
 
 
+// Replace the entries of an empty hash table by entries for minSize elements
+static void reserveHashTable ( HashTable* ht, size_t minSize ) {
+    HashTable* sizedHt = allocateHashTable ( minSize, ht->payloadSize );
+    free ( ht->entries );
+    memcpy ( ht, sizedHt, sizeof ( HashTable ) );
+    free ( sizedHt );
+}
+
+
+// Remove all entries and keep the allocated size
+static void clearHashTable ( HashTable* ht ) {
+    initHashTableWorker ( ht, 0, ht->numEntries );
+    ht->numInserts = 0;
+}
+
+
 // Free all resources allocated for ht 
 static void freeHashTable ( HashTable* ht ) {
     #ifdef HT_METRICS
@@ -441,7 +459,11 @@ static Data* ht_get ( HashTable*  ht,
     else {
         // subsequent (linear) probe
         // get first address after payload
+        // and wrap around after the last entry
         entryLoc = dataLoc + table.payloadSize;
+        if ( entryLoc >= table.entriesEnd ) {
+            entryLoc = table.entries;
+        }
     }
 
     // Perform Linear probing and check hash values 
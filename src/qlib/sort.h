@@ -2,6 +2,13 @@
 #include <vector>
 #include <tuple>
 #include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <barrier>
+#include <mutex>
+#include <functional>
+#include <cstdio>
+#include <algorithm>
 #include "../types.h"
 #include "../dbdata.h"
 #include "qlib.h"
@@ -17,157 +24,1083 @@ struct OrderRequest {
     bool     isAscending;
 };
 
-    
-class Quicksorter
-{
-public:
-  Quicksorter(Relation* relation, const std::size_t len, std::vector<OrderRequest>* order_requests)
-      : _temp_storage(std::malloc(relation->_schema._tupSize)), _relation(relation), _len(len), _order_requests(order_requests)
-  {
-    _randIt = Relation::RandomAccessIterator ( relation );
-  }
-
-  ~Quicksorter()
-  {
-    std::free(_temp_storage);
-  }
-
-  void operator()()
-  {
-    sort(0, _len - 1);
-  }
-
-  void sort(const std::int64_t low_index, const std::int64_t high_index)
-  {
-    if (low_index < high_index)
-    {
-      const auto pivot = partition(low_index, high_index);
-
-      sort(low_index, pivot - 1);
-      sort(pivot + 1, high_index);
-    }
-  }
-private:
-  void *_temp_storage {nullptr};
-  Relation* _relation;
-  Relation::RandomAccessIterator _randIt;
-  const std::size_t _len;
-  std::vector<OrderRequest>* _order_requests;
-
-  /**
-   * Swaps two records at the given indices.
-   * @param i
-   * @param j
-   */
-  void swap(const std::size_t i, const std::size_t j)
-  {
-    if (i == j)
-    {
-      return;
-    }
-
-    auto *dest_i = static_cast<void*>(record(i));
-    auto *dest_j = static_cast<void*>(record(j));
-
-    std::memmove(_temp_storage, dest_i, _relation->_schema._tupSize);
-    std::memmove(dest_i, dest_j, _relation->_schema._tupSize); // i <- j
-    std::memmove(dest_j, _temp_storage, _relation->_schema._tupSize); // j <- i
-  }
-
-  std::size_t partition(const std::int64_t low_index, const std::int64_t high_index)
-  {
-    auto *pivot_element = record(high_index);
-    auto i = low_index;
-
-    for (auto j = low_index; j < high_index; ++j)
-    {
-      if (compare(record(j), pivot_element))
-      {
-        swap(std::size_t(i), std::size_t(j));
-        ++i;
-      }
-    }
-    swap(std::size_t(i), std::size_t(high_index));
-    return std::size_t(i);
-  }
-
-  /**
-   * Returns True, when first should be ordered BEFORE second.
-   *
-   * @param first
-   * @param second
-   * @return
-   */
-  bool compare(Data *first, Data *second)
-  {
-    for(const auto& order_item : *_order_requests)
-    {
-      const auto c = compare ( order_item.type, 
-                               &first  [ order_item.offset ], 
-                               &second [ order_item.offset ] );
-
-      if (order_item.isAscending) // ASC
-      {
-        if (c < 0)
-        {
-          return true;
-        }
-
-        if (c > 0)
-        {
-          return false;
-        }
-      }
-      else // DESC
-      {
-        if (c > 0)
-        {
-          return true;
-        }
-
-        if (c < 0)
-        {
-          return false;
-        }
-      }
+
+/* Function that returns true when the first tuple precedes   *
+ * the second tuple, e.g. compiled for specific order requests */
+typedef bool (*TupleComparator) ( Data*, Data* );
+
+
+/* Compact sort entry that is moved instead of the tuple.    *
+ * The prefix holds the first order key normalized such that *
+ * unsigned comparison yields the requested order.           */
+struct SortEntry {
+    uint64_t  prefix;
+    Data*     tuple;
+};
+
+
+static std::int8_t compareAttribute ( const SqlType& type, Data* left, Data* right ) {
+    switch ( type.tag ) {
+        case SqlType::BIGINT:  return ::compare < SqlType::BIGINT >  ( left, right );
+        case SqlType::INT:     return ::compare < SqlType::INT >     ( left, right );
+        case SqlType::BOOL:    return ::compare < SqlType::BOOL >    ( left, right );
+        case SqlType::DATE:    return ::compare < SqlType::DATE >    ( left, right );
+        case SqlType::DECIMAL: return ::compare < SqlType::DECIMAL > ( left, right );
+        case SqlType::FLOAT:   return ::compare < SqlType::FLOAT >   ( left, right );
+        case SqlType::CHAR:    return ::compare < SqlType::CHAR >    ( left, right );
+        case SqlType::VARCHAR: return ::compare < SqlType::VARCHAR > ( left, right );
+        default:               return 0;
     }
+}
+
 
+/* Returns true when tuple a precedes tuple b according to *
+ * the order requests starting with index first.           */
+static bool isOrderedBefore ( Data*                               a, 
+                              Data*                               b, 
+                              const std::vector < OrderRequest >& orderRequests,
+                              size_t                              first = 0 ) {
+    for ( size_t i = first; i < orderRequests.size(); i++ ) {
+        const OrderRequest& req = orderRequests[i];
+        std::int8_t c = compareAttribute ( req.type, a + req.offset, b + req.offset );
+        if ( c != 0 ) {
+            return req.isAscending ? c < 0 : c > 0;
+        }
+    }
     return false;
-  }
-
-  std::int8_t compare(const SqlType& type, Data* left, Data* right)
-  {
-    switch (type.tag) {
-    case SqlType::BIGINT:
-      return ::compare<SqlType::BIGINT>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::INT:
-      return ::compare<SqlType::INT>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::BOOL:
-      return ::compare<SqlType::BOOL>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::DATE:
-      return ::compare<SqlType::DATE>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::DECIMAL:
-      return ::compare<SqlType::DECIMAL>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::FLOAT:
-      return ::compare<SqlType::FLOAT>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::CHAR:
-      return ::compare<SqlType::CHAR>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    case SqlType::VARCHAR:
-      return ::compare<SqlType::VARCHAR>(reinterpret_cast<void*>(left), reinterpret_cast<void*>(right));
-    default:
-      return 0;
-    }
-  }
-
-
-  Data* record(const std::size_t index)
-  {
-    return _randIt.get ( index );
-  }
+}
+
+
+/* Returns true when the prefix fully determines the order of the key */
+static bool isExactSortPrefix ( const SqlType& type ) {
+    return type.tag != SqlType::CHAR && type.tag != SqlType::VARCHAR;
+}
+
+
+/* Maps the order key at req.offset to an unsigned integer that *
+ * preserves the order. Strings contribute their first 8 bytes. */
+static uint64_t sortPrefix ( Data* tuple, const OrderRequest& req ) {
+
+    Data* key = tuple + req.offset;
+    uint64_t prefix = 0;
+
+    switch ( req.type.tag ) {
+        case SqlType::BIGINT:
+        case SqlType::DECIMAL: {
+            int64_t v;
+            std::memcpy ( &v, key, sizeof ( v ) );
+            prefix = (uint64_t) v ^ ( 1ull << 63 );
+            break;
+        }
+        case SqlType::INT:
+        case SqlType::DATE: {
+            int32_t v;
+            std::memcpy ( &v, key, sizeof ( v ) );
+            prefix = (uint64_t) ( (uint32_t) v ^ 0x80000000u ) << 32;
+            break;
+        }
+        case SqlType::BOOL: {
+            prefix = *reinterpret_cast < bool* > ( key ) ? 1 : 0;
+            break;
+        }
+        case SqlType::FLOAT: {
+            uint64_t bits;
+            std::memcpy ( &bits, key, sizeof ( bits ) );
+            prefix = ( bits & ( 1ull << 63 ) ) ? ~bits : bits ^ ( 1ull << 63 );
+            break;
+        }
+        case SqlType::CHAR:
+        case SqlType::VARCHAR: {
+            char* str = reinterpret_cast < char* > ( key );
+            for ( int i = 0; i < 8 && str[i] != '\0'; i++ ) {
+                prefix |= (uint64_t) (uint8_t) str[i] << ( 56 - 8 * i );
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    return req.isAscending ? prefix : ~prefix;
+}
+
+
+/* Entry representation with the first order key as prefix. *
+ * Equal prefixes are resolved by comparing the tuples.      */
+struct PrefixCodec {
+
+    using Entry = SortEntry;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    /* index of the first order request not covered by the prefix */
+    size_t _firstFullCompare;
+
+    /* specialized comparator for equal prefixes (optional) */
+    TupleComparator _compare;
+
+
+    PrefixCodec ( std::vector < OrderRequest >* orderRequests, TupleComparator compare ) 
+        : _orderRequests ( orderRequests ),
+          _firstFullCompare ( isExactSortPrefix ( (*orderRequests)[0].type ) ? 1 : 0 ),
+          _compare ( compare ) {}
+
+
+    Entry make ( Data* tuple ) const {
+        return { sortPrefix ( tuple, (*_orderRequests)[0] ), tuple };
+    }
+
+
+    bool before ( const Entry& a, const Entry& b ) const {
+        if ( a.prefix != b.prefix ) {
+            return a.prefix < b.prefix;
+        }
+        if ( _compare != nullptr ) {
+            return _compare ( a.tuple, b.tuple );
+        }
+        return isOrderedBefore ( a.tuple, b.tuple, *_orderRequests, _firstFullCompare );
+    }
+
+
+    void sortRun ( Entry* begin, Entry* end ) const {
+        std::sort ( begin, end, [this] ( const Entry& a, const Entry& b ) { return before ( a, b ); } );
+    }
+};
+
+
+/* Maximum length of normalized keys in bytes. Longer keys use the PrefixCodec. */
+static const size_t MaxNormalizedKeyBytes = 64;
+
+
+/* Number of bytes of the order key in a normalized key */
+static size_t normalizedKeyBytes ( SqlType type ) {
+    switch ( type.tag ) {
+        case SqlType::BOOL:    return 1;
+        case SqlType::INT:
+        case SqlType::DATE:    return 4;
+        case SqlType::BIGINT:
+        case SqlType::DECIMAL:
+        case SqlType::FLOAT:   return 8;
+        case SqlType::CHAR:    return type.charSpec().num;
+        case SqlType::VARCHAR: return type.varcharSpec().num;
+        default:               return 0;
+    }
+}
+
+
+static size_t normalizedKeyBytes ( std::vector < OrderRequest >& orderRequests ) {
+    size_t bytes = 0;
+    for ( OrderRequest& req : orderRequests ) {
+        bytes += normalizedKeyBytes ( req.type );
+    }
+    return bytes;
+}
+
+
+template < size_t W >
+struct NormalizedKeyEntry {
+    uint64_t  key [ W ];
+    Data*     tuple;
 };
 
-void sort(struct Relation* relation, std::vector<OrderRequest>* order_requests)
+
+/* Entry representation with all order keys encoded into W words   *
+ * that compare lexicographically as unsigned integers, i.e. like  *
+ * memcmp on the big-endian bytes. Integers are sign-flipped,      *
+ * strings padded with '\0' and descending keys bit-inverted. Runs *
+ * are sorted by MSD radix sort on the key bytes.                  */
+template < size_t W >
+struct NormalizedKeyCodec {
+
+    using Entry = NormalizedKeyEntry < W >;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    /* bytes of each order key and of the whole key */
+    std::vector < size_t > _lengths;
+
+    size_t _keyBytes;
+
+
+    NormalizedKeyCodec ( std::vector < OrderRequest >* orderRequests, TupleComparator ) 
+        : _orderRequests ( orderRequests ),
+          _keyBytes ( normalizedKeyBytes ( *orderRequests ) ) {
+
+        for ( OrderRequest& req : *orderRequests ) {
+            _lengths.push_back ( normalizedKeyBytes ( req.type ) );
+        }
+    }
+
+
+    Entry make ( Data* tuple ) const {
+
+        uint8_t bytes [ W * 8 ] = {};
+        size_t pos = 0;
+        for ( size_t r = 0; r < _orderRequests->size(); r++ ) {
+            const OrderRequest& req = (*_orderRequests)[r];
+            Data* val = tuple + req.offset;
+            size_t len = _lengths[r];
+            switch ( req.type.tag ) {
+                case SqlType::CHAR:
+                case SqlType::VARCHAR:
+                    for ( size_t i = 0; i < len && val[i] != '\0'; i++ ) {
+                        bytes [ pos + i ] = val[i];
+                    }
+                    break;
+                case SqlType::BOOL:
+                    bytes [ pos ] = *reinterpret_cast < bool* > ( val ) ? 1 : 0;
+                    break;
+                default: {
+                    /* most significant bytes of the ascending prefix */
+                    OrderRequest asc = { req.offset, req.type, true };
+                    uint64_t prefix = sortPrefix ( tuple, asc );
+                    for ( size_t i = 0; i < len; i++ ) {
+                        bytes [ pos + i ] = (uint8_t) ( prefix >> ( 56 - 8 * i ) );
+                    }
+                    break;
+                }
+            }
+            if ( !req.isAscending ) {
+                for ( size_t i = 0; i < len; i++ ) {
+                    bytes [ pos + i ] = ~bytes [ pos + i ];
+                }
+            }
+            pos += len;
+        }
+
+        Entry e;
+        for ( size_t w = 0; w < W; w++ ) {
+            uint64_t word;
+            std::memcpy ( &word, &bytes [ w * 8 ], sizeof ( word ) );
+            e.key[w] = __builtin_bswap64 ( word );
+        }
+        e.tuple = tuple;
+        return e;
+    }
+
+
+    bool before ( const Entry& a, const Entry& b ) const {
+        for ( size_t w = 0; w < W; w++ ) {
+            if ( a.key[w] != b.key[w] ) {
+                return a.key[w] < b.key[w];
+            }
+        }
+        return false;
+    }
+
+
+    static uint8_t keyByte ( const Entry& e, size_t byte ) {
+        return (uint8_t) ( e.key [ byte / 8 ] >> ( 56 - 8 * ( byte % 8 ) ) );
+    }
+
+
+    void radixSort ( Entry* entries, Entry* tmp, size_t num, size_t byte ) const {
+
+        const size_t comparisonSortSize = 64;
+
+        while ( byte < _keyBytes ) {
+            if ( num <= comparisonSortSize ) {
+                std::sort ( entries, entries + num, 
+                            [this] ( const Entry& a, const Entry& b ) { return before ( a, b ); } );
+                return;
+            }
+
+            size_t counts [ 256 ] = {};
+            for ( size_t i = 0; i < num; i++ ) {
+                counts [ keyByte ( entries[i], byte ) ]++;
+            }
+
+            /* all entries share this byte */
+            if ( counts [ keyByte ( entries[0], byte ) ] == num ) {
+                byte++;
+                continue;
+            }
+
+            size_t offsets [ 256 ];
+            size_t sum = 0;
+            for ( size_t b = 0; b < 256; b++ ) {
+                offsets[b] = sum;
+                sum += counts[b];
+            }
+            for ( size_t i = 0; i < num; i++ ) {
+                tmp [ offsets [ keyByte ( entries[i], byte ) ]++ ] = entries[i];
+            }
+            std::copy ( tmp, tmp + num, entries );
+
+            size_t start = 0;
+            for ( size_t b = 0; b < 256; b++ ) {
+                if ( counts[b] > 1 ) {
+                    radixSort ( entries + start, tmp + start, counts[b], byte + 1 );
+                }
+                start += counts[b];
+            }
+            return;
+        }
+    }
+
+
+    void sortRun ( Entry* begin, Entry* end ) const {
+        std::vector < Entry > tmp ( end - begin );
+        radixSort ( begin, tmp.data(), end - begin, 0 );
+    }
+};
+
+
+/* Parallel sort of a materialized relation.                      *
+ *                                                                *
+ * Every worker thread calls ParallelSorter::sort (..) once. The  *
+ * threads sort runs of compact entries that point to the tuples, *
+ * split the key range with splitters sampled from the runs, and  *
+ * each merges one key range directly into a new relation.       *
+ * Finally, the new relation replaces the input relation.         */
+struct ParallelSorter {
+
+    Relation* _relation;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    size_t _numThreads;
+
+    std::atomic < size_t > _nextThreadId = 0;
+
+    std::barrier<> _barrier;
+
+    size_t _numTuples = 0;
+
+    /* run of thread t is [_runBounds[t], _runBounds[t+1]) */
+    std::vector < size_t > _runBounds;
+
+    Relation::RandomAccessIterator _randIt;
+
+    Relation _sorted;
+
+    size_t _tuplesPerBlock = 0;
+
+
+    ParallelSorter ( Relation*                     relation,
+                     std::vector < OrderRequest >* orderRequests,
+                     size_t                        numThreads )
+        : _relation ( relation ), _orderRequests ( orderRequests ),
+          _numThreads ( numThreads ), _barrier ( numThreads ) {}
+
+
+    virtual ~ParallelSorter() = default;
+
+
+    static void sort ( ParallelSorter* sorter ) {
+        sorter->run ( sorter->_nextThreadId.fetch_add ( 1 ) );
+    }
+
+
+    /* Prepares sorting another relation with the same layout */
+    void reset ( Relation* relation ) {
+        _relation = relation;
+        _nextThreadId = 0;
+    }
+
+
+    /* entry representation specific phases */
+    virtual void allocateEntries () = 0;
+    virtual void fillEntries ( DataBlock* block, size_t first ) = 0;
+    virtual void sortRun ( size_t threadId ) = 0;
+    virtual void selectSplitters () = 0;
+    virtual void mergeAndGather ( size_t threadId ) = 0;
+    virtual void freeEntries () = 0;
+
+
+    void run ( size_t threadId ) {
+
+        /* all threads finished materializing the input */
+        _barrier.arrive_and_wait();
+        if ( threadId == 0 ) {
+            setup();
+        }
+        _barrier.arrive_and_wait();
+
+        if ( _numTuples == 0 ) return;
+
+        /* fill entries block-wise and sort own run */
+        for ( size_t b = threadId; b < _relation->_dataBlocks.size(); b += _numThreads ) {
+            fillEntries ( _relation->_dataBlocks[b].get(), _randIt._blockStarts[b] );
+        }
+        _barrier.arrive_and_wait();
+        sortRun ( threadId );
+        _barrier.arrive_and_wait();
+
+        if ( threadId == 0 ) {
+            selectSplitters();
+        }
+        _barrier.arrive_and_wait();
+
+        mergeAndGather ( threadId );
+        _barrier.arrive_and_wait();
+
+        if ( threadId == 0 ) {
+            *_relation = std::move ( _sorted );
+            freeEntries();
+        }
+    }
+
+
+    void setup () {
+        _randIt = Relation::RandomAccessIterator ( _relation );
+        _numTuples = _randIt._len;
+
+        allocateEntries();
+        _runBounds.resize ( _numThreads + 1 );
+        for ( size_t t = 0; t <= _numThreads; t++ ) {
+            _runBounds[t] = _numTuples * t / _numThreads;
+        }
+
+        /* pre-allocate output such that threads can write in parallel */
+        size_t tupSize = _relation->_schema._tupSize;
+        _sorted = Relation ( _relation->_schema );
+        _tuplesPerBlock = DataBlock::Size / tupSize;
+        for ( size_t written = 0; written < _numTuples; written += _tuplesPerBlock ) {
+            _sorted.addBlock();
+            size_t num = std::min ( _tuplesPerBlock, _numTuples - written );
+            _sorted._dataBlocks.back()->updateContentSize ( num * tupSize );
+        }
+    }
+
+
+    Data* outputTuple ( size_t pos ) {
+        return _sorted._dataBlocks [ pos / _tuplesPerBlock ]->begin()
+               + ( pos % _tuplesPerBlock ) * _relation->_schema._tupSize;
+    }
+};
+
+
+template < class Codec >
+struct CodecSorter : public ParallelSorter {
+
+    using Entry = typename Codec::Entry;
+
+    Codec _codec;
+
+    std::vector < Entry > _entries;
+
+    std::vector < Entry > _splitters;
+
+
+    CodecSorter ( Relation*                     relation,
+                  std::vector < OrderRequest >* orderRequests,
+                  size_t                        numThreads,
+                  TupleComparator               compare )
+        : ParallelSorter ( relation, orderRequests, numThreads ),
+          _codec ( orderRequests, compare ) {}
+
+
+    void allocateEntries () {
+        _entries.resize ( _numTuples );
+    }
+
+
+    void freeEntries () {
+        _entries = {};
+    }
+
+
+    void fillEntries ( DataBlock* block, size_t first ) {
+        size_t tupSize = _relation->_schema._tupSize;
+        size_t num = block->_contentSize / tupSize;
+        Entry* dst = &_entries [ first ];
+        for ( size_t i = 0; i < num; i++ ) {
+            dst[i] = _codec.make ( block->begin() + i * tupSize );
+        }
+    }
+
+
+    void sortRun ( size_t threadId ) {
+        _codec.sortRun ( _entries.data() + _runBounds [ threadId ],
+                         _entries.data() + _runBounds [ threadId + 1 ] );
+    }
+
+
+    void selectSplitters () {
+        const size_t samplesPerRun = 16;
+        std::vector < Entry > samples;
+        for ( size_t t = 0; t < _numThreads; t++ ) {
+            size_t len = _runBounds[t+1] - _runBounds[t];
+            size_t num = std::min ( samplesPerRun, len );
+            for ( size_t i = 0; i < num; i++ ) {
+                samples.push_back ( _entries [ _runBounds[t] + ( i * len ) / num ] );
+            }
+        }
+        std::sort ( samples.begin(), samples.end(),
+                    [this] ( const Entry& a, const Entry& b ) { return _codec.before ( a, b ); } );
+
+        _splitters.clear();
+        for ( size_t t = 1; t < _numThreads; t++ ) {
+            _splitters.push_back ( samples [ ( t * samples.size() ) / _numThreads ] );
+        }
+    }
+
+
+    /* Merges key range threadId of all runs into the sorted relation */
+    void mergeAndGather ( size_t threadId ) {
+
+        auto before = [this] ( const Entry& a, const Entry& b ) {
+            return _codec.before ( a, b );
+        };
+
+        /* boundaries of the key range in each run and output position */
+        std::vector < std::pair < size_t, size_t > > pieces;
+        size_t outPos = 0;
+        for ( size_t r = 0; r < _numThreads; r++ ) {
+            auto runBegin = _entries.begin() + _runBounds[r];
+            auto runEnd   = _entries.begin() + _runBounds[r+1];
+            auto lower = runBegin;
+            auto upper = runEnd;
+            if ( threadId > 0 ) {
+                lower = std::lower_bound ( runBegin, runEnd, _splitters [ threadId - 1 ], before );
+            }
+            if ( threadId < _numThreads - 1 ) {
+                upper = std::lower_bound ( runBegin, runEnd, _splitters [ threadId ], before );
+            }
+            outPos += lower - runBegin;
+            if ( lower < upper ) {
+                pieces.push_back ( { lower - _entries.begin(), upper - _entries.begin() } );
+            }
+        }
+
+        /* k-way merge with a min-heap on the piece heads */
+        auto heapOrder = [&] ( size_t a, size_t b ) {
+            return before ( _entries [ pieces[b].first ], _entries [ pieces[a].first ] );
+        };
+        std::vector < size_t > heap;
+        for ( size_t p = 0; p < pieces.size(); p++ ) {
+            heap.push_back ( p );
+        }
+        std::make_heap ( heap.begin(), heap.end(), heapOrder );
+
+        size_t tupSize = _relation->_schema._tupSize;
+        while ( !heap.empty() ) {
+            std::pop_heap ( heap.begin(), heap.end(), heapOrder );
+            auto& piece = pieces [ heap.back() ];
+
+            std::memcpy ( outputTuple ( outPos ), _entries [ piece.first ].tuple, tupSize );
+            outPos++;
+
+            piece.first++;
+            if ( piece.first < piece.second ) {
+                std::push_heap ( heap.begin(), heap.end(), heapOrder );
+            }
+            else {
+                heap.pop_back();
+            }
+        }
+    }
+};
+
+
+/* Returns true when sorting uses normalized keys */
+static bool usesNormalizedKeys ( std::vector < OrderRequest >& orderRequests ) {
+    return normalizedKeyBytes ( orderRequests ) <= MaxNormalizedKeyBytes;
+}
+
+
+/* Uses normalized keys if they fit into MaxNormalizedKeyBytes. *
+ * Otherwise, compare is used for tuples with equal prefixes.   */
+static std::unique_ptr < ParallelSorter > makeSorter ( Relation*                     relation,
+                                                       std::vector < OrderRequest >* orderRequests,
+                                                       size_t                        numThreads,
+                                                       TupleComparator               compare = nullptr ) {
+    size_t bytes = normalizedKeyBytes ( *orderRequests );
+    if ( !usesNormalizedKeys ( *orderRequests ) ) {
+        return std::make_unique < CodecSorter < PrefixCodec > > ( relation, orderRequests, numThreads, compare );
+    }
+    switch ( ( bytes + 7 ) / 8 ) {
+        case 1: return std::make_unique < CodecSorter < NormalizedKeyCodec < 1 > > > ( relation, orderRequests, numThreads, compare );
+        case 2: return std::make_unique < CodecSorter < NormalizedKeyCodec < 2 > > > ( relation, orderRequests, numThreads, compare );
+        case 3: return std::make_unique < CodecSorter < NormalizedKeyCodec < 3 > > > ( relation, orderRequests, numThreads, compare );
+        case 4: return std::make_unique < CodecSorter < NormalizedKeyCodec < 4 > > > ( relation, orderRequests, numThreads, compare );
+        case 5: return std::make_unique < CodecSorter < NormalizedKeyCodec < 5 > > > ( relation, orderRequests, numThreads, compare );
+        case 6: return std::make_unique < CodecSorter < NormalizedKeyCodec < 6 > > > ( relation, orderRequests, numThreads, compare );
+        case 7: return std::make_unique < CodecSorter < NormalizedKeyCodec < 7 > > > ( relation, orderRequests, numThreads, compare );
+        case 8: return std::make_unique < CodecSorter < NormalizedKeyCodec < 8 > > > ( relation, orderRequests, numThreads, compare );
+        default: return std::make_unique < CodecSorter < PrefixCodec > > ( relation, orderRequests, numThreads, compare );
+    }
+}
+
+
+/* Sorts relation with the calling thread only */
+void sort ( struct Relation* relation, std::vector<OrderRequest>* order_requests )
 {
-  auto sorter = Quicksorter{relation, relation->tupleNum(), order_requests};
-  sorter();
+    auto sorter = makeSorter ( relation, order_requests, 1 );
+    ParallelSorter::sort ( sorter.get() );
 }
+
+
+/* Bounded heap that keeps the first k tuples in order. The   *
+ * root holds the last kept tuple, which is replaced when a   *
+ * preceding tuple is offered. Tuples are offered by writing  *
+ * them to the scratch tuple.                                 */
+struct TopKHeap {
+
+    size_t _k;
+
+    size_t _tupSize;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    /* tuple storage, grows up to k tuples */
+    std::vector < Data > _tuples;
+
+    /* heap of slot indices into _tuples */
+    std::vector < size_t > _heap;
+
+    std::unique_ptr < Data[] > _scratch;
+
+    /* specialized comparator (optional) */
+    TupleComparator _compare;
+
+
+    TopKHeap ( size_t                        k, 
+               size_t                        tupSize, 
+               std::vector < OrderRequest >* orderRequests, 
+               TupleComparator               compare = nullptr )
+        : _k ( k ), _tupSize ( tupSize ), _orderRequests ( orderRequests ),
+          _scratch ( std::make_unique < Data[] > ( tupSize ) ), _compare ( compare ) {}
+
+
+    bool before ( Data* a, Data* b ) {
+        if ( _compare != nullptr ) {
+            return _compare ( a, b );
+        }
+        return isOrderedBefore ( a, b, *_orderRequests );
+    }
+
+
+    Data* slot ( size_t i ) {
+        return _tuples.data() + i * _tupSize;
+    }
+
+
+    static Data* scratch ( TopKHeap* heap ) {
+        return heap->_scratch.get();
+    }
+
+
+    static void offer ( TopKHeap* heap ) {
+        heap->offer();
+    }
+
+
+    void offer () {
+        auto slotBefore = [this] ( size_t a, size_t b ) {
+            return before ( slot ( a ), slot ( b ) );
+        };
+        if ( _heap.size() < _k ) {
+            size_t s = _heap.size();
+            _tuples.resize ( ( s + 1 ) * _tupSize );
+            std::memcpy ( slot ( s ), _scratch.get(), _tupSize );
+            _heap.push_back ( s );
+            std::push_heap ( _heap.begin(), _heap.end(), slotBefore );
+        }
+        else if ( _k > 0 && before ( _scratch.get(), slot ( _heap.front() ) ) ) {
+            std::pop_heap ( _heap.begin(), _heap.end(), slotBefore );
+            std::memcpy ( slot ( _heap.back() ), _scratch.get(), _tupSize );
+            std::push_heap ( _heap.begin(), _heap.end(), slotBefore );
+        }
+    }
+};
+
+
+/* Sorted run of an external sort. Runs are spilled to a temporary *
+ * file as consecutive tuples or kept in memory as a relation.     */
+struct SortedRun {
+
+    FILE* file = nullptr;
+
+    size_t numTuples = 0;
+
+    std::unique_ptr < Relation > relation;
+};
+
+
+/* Streams the tuples of a sorted run in chunks */
+struct RunReader {
+
+    SortedRun* _run;
+
+    size_t _tupSize;
+
+    /* tuples in the current chunk and position within */
+    Data*  _chunk = nullptr;
+    size_t _chunkLen = 0;
+    size_t _pos = 0;
+
+    size_t _remaining;
+    size_t _blockIndex = 0;
+
+    std::vector < Data > _buffer;
+
+    /* reading the file failed, the reader ends its run early */
+    bool _failed = false;
+
+
+    RunReader ( SortedRun* run, size_t tupSize, size_t chunkBytes ) 
+        : _run ( run ), _tupSize ( tupSize ), _remaining ( run->numTuples ) {
+        if ( run->file != nullptr ) {
+            _buffer.resize ( std::max ( chunkBytes / tupSize, (size_t) 1 ) * tupSize );
+            std::rewind ( run->file );
+        }
+        loadChunk();
+    }
+
+
+    Data* current () {
+        return _pos < _chunkLen ? _chunk + _pos * _tupSize : nullptr;
+    }
+
+
+    void next () {
+        _pos++;
+        if ( _pos == _chunkLen ) {
+            loadChunk();
+        }
+    }
+
+
+    void loadChunk () {
+        _pos = 0;
+        _chunkLen = 0;
+        if ( _remaining == 0 ) return;
+        if ( _run->file != nullptr ) {
+            size_t num = std::min ( _buffer.size() / _tupSize, _remaining );
+            if ( std::fread ( _buffer.data(), _tupSize, num, _run->file ) != num ) {
+                _failed = true;
+                _remaining = 0;
+                return;
+            }
+            _chunk = _buffer.data();
+            _chunkLen = num;
+        }
+        else {
+            DataBlock* block = _run->relation->_dataBlocks [ _blockIndex++ ].get();
+            _chunk = block->begin();
+            _chunkLen = block->_contentSize / _tupSize;
+        }
+        _remaining -= _chunkLen;
+    }
+};
+
+
+/* Tournament tree of losers that yields the next tuple of k runs *
+ * with log(k) comparisons.                                       */
+struct LoserTree {
+
+    std::vector < RunReader >& _readers;
+
+    std::function < bool ( Data*, Data* ) > _before;
+
+    /* losers of internal nodes 1..k-1 */
+    std::vector < size_t > _losers;
+
+    size_t _winner = 0;
+
+
+    LoserTree ( std::vector < RunReader >& readers, std::function < bool ( Data*, Data* ) > before )
+        : _readers ( readers ), _before ( before ) {
+
+        size_t k = readers.size();
+        if ( k == 0 ) return;
+        _losers.resize ( k );
+        std::vector < size_t > winners ( 2 * k );
+        for ( size_t i = 0; i < k; i++ ) {
+            winners [ k + i ] = i;
+        }
+        for ( size_t n = k - 1; n >= 1; n-- ) {
+            size_t a = winners [ 2 * n ];
+            size_t b = winners [ 2 * n + 1 ];
+            winners[n] = isBetter ( a, b ) ? a : b;
+            _losers[n] = isBetter ( a, b ) ? b : a;
+        }
+        _winner = k > 1 ? winners[1] : 0;
+    }
+
+
+    /* exhausted runs lose against all others */
+    bool isBetter ( size_t a, size_t b ) {
+        Data* ta = _readers[a].current();
+        Data* tb = _readers[b].current();
+        if ( ta == nullptr ) return false;
+        if ( tb == nullptr ) return true;
+        return _before ( ta, tb );
+    }
+
+
+    /* returns nullptr when all runs are exhausted */
+    Data* top () {
+        return _readers.empty() ? nullptr : _readers [ _winner ].current();
+    }
+
+
+    void pop () {
+        size_t k = _readers.size();
+        size_t s = _winner;
+        _readers [ s ].next();
+        for ( size_t n = ( s + k ) / 2; n >= 1; n /= 2 ) {
+            if ( isBetter ( _losers[n], s ) ) {
+                std::swap ( _losers[n], s );
+            }
+        }
+        _winner = s;
+    }
+};
+
+
+/* Sort that limits the memory for unsorted input. Each worker thread     *
+ * collects tuples in a buffer, sorts it when the budget is exceeded and  *
+ * spills it as run to a temporary file. At the end, all runs are merged  *
+ * with a loser tree into the result relation.                            *
+ *                                                                        *
+ * The worker threads call the sorter from generated code. Errors of the  *
+ * temporary files are recorded and raised after the threads joined.      */
+struct ExternalSorter {
+
+    /* Tuple buffer of one worker thread */
+    struct RunBuilder {
+
+        ExternalSorter* _sorter;
+
+        std::unique_ptr < Relation > _buffer;
+
+        Relation::AppendIterator _appendIt;
+
+        std::unique_ptr < Data[] > _scratch;
+
+        /* bytes of the tuples in the buffer */
+        size_t _bufferedBytes;
+
+
+        RunBuilder ( ExternalSorter* sorter ) : _sorter ( sorter ) {
+            _scratch = std::make_unique < Data[] > ( sorter->_schema._tupSize );
+            reset();
+        }
+
+
+        void reset () {
+            _buffer = std::make_unique < Relation > ( _sorter->_schema );
+            _appendIt = Relation::AppendIterator ( _buffer.get() );
+            _bufferedBytes = 0;
+        }
+
+
+        static Data* scratch ( RunBuilder* builder ) {
+            return builder->_scratch.get();
+        }
+
+
+        static void add ( RunBuilder* builder ) {
+            builder->add();
+        }
+
+
+        void add () {
+            Data* dst = _appendIt.get();
+            std::memcpy ( dst, _scratch.get(), _sorter->_schema._tupSize );
+            _bufferedBytes += _sorter->_schema._tupSize;
+            if ( _bufferedBytes >= _sorter->_bufferBytes ) {
+                _sorter->addRun ( std::move ( _buffer ), true );
+                reset();
+            }
+        }
+    };
+
+
+    Schema _schema;
+
+    std::vector < OrderRequest >* _orderRequests;
+
+    TupleComparator _compare;
+
+    size_t _numThreads;
+
+    /* maximum size of a run buffer, sorting uses twice the space */
+    size_t _bufferBytes;
+
+    std::vector < std::unique_ptr < RunBuilder > > _builders;
+
+    std::atomic < size_t > _nextBuilder = 0;
+
+    std::mutex _runsMutex;
+
+    std::vector < std::unique_ptr < SortedRun > > _runs;
+
+    /* all threads added their input before flushing the buffers */
+    std::barrier<> _syncInput;
+
+    std::atomic < size_t > _nextFlush = 0;
+
+    /* all threads added their runs before merging */
+    std::barrier<> _syncMerge;
+
+    std::atomic < bool > _mergeFlag = true;
+
+    std::unique_ptr < Relation > _result;
+
+    /* first error of the worker threads */
+    std::atomic < bool > _failed = false;
+    std::string _error;
+
+
+    ExternalSorter ( Schema&                       schema,
+                     std::vector < OrderRequest >* orderRequests,
+                     TupleComparator               compare,
+                     size_t                        numThreads,
+                     size_t                        memoryBytes ) 
+        : _schema ( schema ), _orderRequests ( orderRequests ), _compare ( compare ),
+          _numThreads ( numThreads ), _syncInput ( numThreads ), _syncMerge ( numThreads ) {
+
+        _bufferBytes = std::max ( memoryBytes / ( 2 * numThreads ), DataBlock::Size );
+        reset();
+    }
+
+
+    ~ExternalSorter () {
+        closeRuns();
+    }
+
+
+    /* Empty run buffers and result for the next input */
+    void reset () {
+        closeRuns();
+        _builders.clear();
+        for ( size_t t = 0; t < _numThreads; t++ ) {
+            _builders.push_back ( std::make_unique < RunBuilder > ( this ) );
+        }
+        _nextBuilder = 0;
+        _nextFlush = 0;
+        _mergeFlag = true;
+        _failed = false;
+        _error.clear();
+        _result = std::make_unique < Relation > ( _schema );
+    }
+
+
+    void closeRuns () {
+        for ( auto& run : _runs ) {
+            if ( run->file != nullptr ) {
+                std::fclose ( run->file );
+            }
+        }
+        _runs.clear();
+    }
+
+
+    void fail ( const std::string& message ) {
+        const std::lock_guard < std::mutex > lock ( _runsMutex );
+        if ( !_failed ) {
+            _error = message;
+            _failed = true;
+        }
+    }
+
+
+    /* Called after the worker threads joined */
+    void raiseError () {
+        if ( _failed ) {
+            throw ResqlError ( _error );
+        }
+    }
+
+
+    static RunBuilder* acquireBuilder ( ExternalSorter* sorter ) {
+        return sorter->_builders [ sorter->_nextBuilder.fetch_add ( 1 ) ].get();
+    }
+
+
+    /* Sorts the tuples and adds them as run */
+    void addRun ( std::unique_ptr < Relation > tuples, bool spill ) {
+
+        auto run = std::make_unique < SortedRun > ();
+        run->numTuples = tuples->tupleNum();
+        if ( run->numTuples == 0 || _failed ) return;
+
+        auto sorter = makeSorter ( tuples.get(), _orderRequests, 1, _compare );
+        ParallelSorter::sort ( sorter.get() );
+
+        if ( spill ) {
+            run->file = std::tmpfile();
+            if ( run->file == nullptr ) {
+                fail ( "Could not create temporary file for external sort." );
+                return;
+            }
+            for ( auto& block : tuples->_dataBlocks ) {
+                if ( std::fwrite ( block->begin(), 1, block->_contentSize, run->file ) != block->_contentSize ) {
+                    std::fclose ( run->file );
+                    fail ( "Failed to write sorted run to temporary file." );
+                    return;
+                }
+            }
+        }
+        else {
+            run->relation = std::move ( tuples );
+        }
+
+        const std::lock_guard < std::mutex > lock ( _runsMutex );
+        _runs.push_back ( std::move ( run ) );
+    }
+
+
+    /* Called by all threads after adding the input. The threads sort *
+     * the remaining buffers and the first thread merges all runs.    */
+    static void finish ( ExternalSorter* sorter ) {
+
+        sorter->_syncInput.arrive_and_wait();
+        size_t b;
+        while ( ( b = sorter->_nextFlush.fetch_add ( 1 ) ) < sorter->_builders.size() ) {
+            sorter->addRun ( std::move ( sorter->_builders[b]->_buffer ), false );
+        }
+        sorter->_syncMerge.arrive_and_wait();
+
+        bool expected = true;
+        if ( sorter->_mergeFlag.compare_exchange_strong ( expected, false ) ) {
+            sorter->merge();
+        }
+    }
+
+
+    void merge () {
+
+        if ( _failed ) {
+            closeRuns();
+            _builders.clear();
+            return;
+        }
+        const size_t chunkBytes = 1 << 16;
+        size_t tupSize = _schema._tupSize;
+        std::vector < RunReader > readers;
+        readers.reserve ( _runs.size() );
+        for ( auto& run : _runs ) {
+            readers.emplace_back ( run.get(), tupSize, chunkBytes );
+        }
+
+        std::function < bool ( Data*, Data* ) > before;
+        if ( _compare != nullptr ) {
+            before = _compare;
+        }
+        else {
+            std::vector < OrderRequest >* requests = _orderRequests;
+            before = [requests] ( Data* a, Data* b ) { return isOrderedBefore ( a, b, *requests ); };
+        }
+
+        LoserTree tree ( readers, before );
+        Relation::AppendIterator appendIt ( _result.get() );
+        Data* tuple;
+        while ( ( tuple = tree.top() ) != nullptr ) {
+            std::memcpy ( appendIt.get(), tuple, tupSize );
+            tree.pop();
+        }
+        for ( auto& reader : readers ) {
+            if ( reader._failed ) {
+                fail ( "Failed to read sorted run from temporary file." );
+            }
+        }
+
+        closeRuns();
+        _builders.clear();
+    }
+};
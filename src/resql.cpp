@@ -132,6 +132,8 @@ int main ( int argc, char** argv ) {
         ( "p,port",        "Port for client/server", 
             cxxopts::value<std::uint16_t>()->default_value ( "4000" ) )
         ( "i,interactive", "Start command line (default)" )
+        ( "c,code-cache",  "Directory for machine code that is reused across restarts", 
+            cxxopts::value<std::string>() )
         ( "h,help",        "Print usage" )
     ;
     auto opt = options.parse ( argc, argv );
@@ -150,6 +152,9 @@ int main ( int argc, char** argv ) {
     if ( mode == INTERACTIVE || mode == SERVER ) {
         Database db;
         DBConfig config;
+        if ( opt.count ( "code-cache" ) ) {
+            config.codeCacheDirectory = opt ["code-cache"].as<std::string>();
+        }
         if ( mode == SERVER ) {
             std::uint16_t port = opt ["port"].as<std::uint16_t>();
             runServer ( db, config, port );
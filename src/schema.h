@@ -168,6 +168,15 @@ public:
         return res;
     }
     
+    /**
+     * @brief Removes the last num attributes from the schema.
+     * The tuple width is kept, so the removed attributes remain as padding.
+     */
+    void dropTrailingAttributes ( size_t num ) {
+        _attribs.resize ( _attribs.size() - num );
+        _nElems = _attribs.size();
+    }
+
     /**
      * @brief Prints a schema with its attribute names.
      */
@@ -0,0 +1,369 @@
+/**
+ * @file
+ * Table and column statistics for cardinality estimation.
+ */
+#pragma once
+
+#include <cmath>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include "expressions.h"
+
+
+/* HyperLogLog sketch for the number of distinct values of a column */
+struct HyperLogLog {
+
+    static constexpr int IndexBits = 12;
+    static constexpr size_t NumRegisters = 1 << IndexBits;
+
+    std::vector < uint8_t > _registers = std::vector < uint8_t > ( NumRegisters, 0 );
+
+
+    /* finalizer of MurmurHash3 */
+    static uint64_t mix ( uint64_t h ) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+
+    void add ( uint64_t hash ) {
+        hash = mix ( hash );
+        size_t idx = hash >> ( 64 - IndexBits );
+        uint64_t rest = hash << IndexBits;
+        uint8_t rank = ( rest == 0 ) ? ( 64 - IndexBits + 1 ) : __builtin_clzll ( rest ) + 1;
+        _registers [ idx ] = std::max ( _registers [ idx ], rank );
+    }
+
+
+    /* Harmonic mean of the registers with linear counting for small sets */
+    double estimate () const {
+        double m = NumRegisters;
+        double sum = 0.0;
+        size_t zeros = 0;
+        for ( uint8_t r : _registers ) {
+            sum += std::ldexp ( 1.0, -r );
+            zeros += ( r == 0 );
+        }
+        double alpha = 0.7213 / ( 1.0 + 1.079 / m );
+        double est = alpha * m * m / sum;
+        if ( est <= 2.5 * m && zeros > 0 ) {
+            est = m * std::log ( m / zeros );
+        }
+        return est;
+    }
+};
+
+
+/* Equi-depth histogram. The same number of values lies between each *
+ * pair of consecutive bounds. The first and last bound are the       *
+ * minimum and maximum value.                                         */
+struct Histogram {
+
+    static constexpr size_t NumBuckets = 64;
+
+    std::vector < double > _bounds;
+
+
+    void build ( std::vector < double >& values ) {
+        _bounds.clear();
+        if ( values.empty() ) return;
+        std::sort ( values.begin(), values.end() );
+        size_t last = values.size() - 1;
+        for ( size_t i = 0; i <= NumBuckets; i++ ) {
+            _bounds.push_back ( values [ i * last / NumBuckets ] );
+        }
+    }
+
+
+    /* Fraction of the values smaller than v, interpolated within buckets */
+    double fractionBelow ( double v ) const {
+        if ( _bounds.empty() ) return 0.5;
+        if ( v <= _bounds.front() ) return 0.0;
+        if ( v > _bounds.back() ) return 1.0;
+        size_t bucket = std::lower_bound ( _bounds.begin(), _bounds.end(), v ) - _bounds.begin();
+        double lo = _bounds [ bucket - 1 ];
+        double hi = _bounds [ bucket ];
+        return ( ( bucket - 1 ) + ( v - lo ) / ( hi - lo ) ) / NumBuckets;
+    }
+};
+
+
+struct ColumnStatistics {
+
+    SqlType    type;
+
+    /* min, max and histogram are only kept for numeric types */
+    bool       isNumeric;
+    SqlValue   min;
+    SqlValue   max;
+    Histogram  histogram;
+
+    /* estimated number of distinct values */
+    double     distinct;
+};
+
+
+struct TableStatistics {
+
+    size_t rowCount = 0;
+
+    std::map < std::string, ColumnStatistics > columns;
+
+
+    ColumnStatistics* column ( const std::string& name ) {
+        auto it = columns.find ( name );
+        return ( it == columns.end() ) ? nullptr : &it->second;
+    }
+};
+
+
+bool isNumericType ( SqlType type ) {
+    return type.tag == SqlType::INT
+        || type.tag == SqlType::BIGINT
+        || type.tag == SqlType::DATE
+        || type.tag == SqlType::DECIMAL
+        || type.tag == SqlType::FLOAT;
+}
+
+
+/* Maps numeric values to doubles in the same order. Dates map *
+ * to approximate day numbers for interpolation.               */
+double numericValue ( SqlValue val, SqlType type ) {
+    switch ( type.tag ) {
+        case SqlType::INT:
+            return val.intData;
+        case SqlType::BIGINT:
+            return val.bigintData;
+        case SqlType::DATE:
+            return ( val.dateData / 10000 ) * 372 + ( val.dateData / 100 % 100 ) * 31 + val.dateData % 100;
+        case SqlType::DECIMAL:
+            return val.decimalData / std::pow ( 10.0, type.decimalSpec().scale );
+        case SqlType::FLOAT:
+            return val.floatData;
+        default:
+            return 0.0;
+    }
+}
+
+
+/* Collects the statistics of one column value by value. The histogram *
+ * is built from a sample with a fixed stride.                         */
+struct ColumnStatisticsBuilder {
+
+    static constexpr size_t MaxSample = 1 << 16;
+
+    ColumnStatistics          _stats;
+    bool                      _stringsByVal;
+    size_t                    _size;
+    HyperLogLog               _sketch;
+    std::vector < double >    _sample;
+    size_t                    _stride;
+    size_t                    _count = 0;
+
+
+    ColumnStatisticsBuilder ( SqlType type, bool stringsByVal, size_t rowCount )
+        : _stringsByVal ( stringsByVal ),
+          _size ( getSizeInTuple ( type, stringsByVal ) ),
+          _stride ( std::max ( rowCount / MaxSample, (size_t) 1 ) ) {
+        _stats.type = type;
+        _stats.isNumeric = isNumericType ( type );
+    }
+
+
+    void add ( Data* field ) {
+
+        if ( !_stats.isNumeric ) {
+            char* chars = _stringsByVal ? (char*) field : *(char**) field;
+            std::string_view str ( chars, _stringsByVal ? strnlen ( chars, _size ) : strlen ( chars ) );
+            _sketch.add ( std::hash < std::string_view > {} ( str ) );
+            return;
+        }
+
+        uint64_t bits = 0;
+        memcpy ( &bits, field, _size );
+        _sketch.add ( bits );
+
+        SqlValue val = ValueMoves::fromAddress ( _stats.type, field );
+        double key = numericValue ( val, _stats.type );
+        if ( _count == 0 || key < numericValue ( _stats.min, _stats.type ) ) {
+            _stats.min = val;
+        }
+        if ( _count == 0 || key > numericValue ( _stats.max, _stats.type ) ) {
+            _stats.max = val;
+        }
+        if ( _count % _stride == 0 ) {
+            _sample.push_back ( key );
+        }
+        _count++;
+    }
+
+
+    ColumnStatistics finish () {
+        _stats.distinct = std::max ( _sketch.estimate(), 1.0 );
+        _stats.histogram.build ( _sample );
+        return _stats;
+    }
+};
+
+
+typedef std::function < ColumnStatistics* ( const std::string& ) > StatisticsLookup;
+
+
+/* Selectivity estimates without statistics */
+const double DefaultEqualitySelectivity = 0.1;
+const double DefaultRangeSelectivity = 0.3;
+
+
+bool isNumericConstant ( Expr* e ) {
+    return e->tag == Expr::CONSTANT && isNumericType ( e->type );
+}
+
+
+/* Comparison of an attribute with a numeric constant, *
+ * normalized to have the attribute on the left side.  */
+struct AttributeComparison {
+    Expr::Tag          tag;
+    std::string        attribute;
+    double             value;
+    ColumnStatistics*  stats;
+};
+
+
+bool getAttributeComparison ( Expr*                c,
+                              StatisticsLookup&    lookup,
+                              AttributeComparison& res ) {
+
+    if ( c->tag != Expr::LT && c->tag != Expr::LE && c->tag != Expr::GT && c->tag != Expr::GE ) {
+        return false;
+    }
+    Expr* a = c->child;
+    Expr* b = c->child->next;
+    res.tag = c->tag;
+    if ( a->tag != Expr::ATTRIBUTE ) {
+        std::swap ( a, b );
+        switch ( c->tag ) {
+            case Expr::LT: res.tag = Expr::GT; break;
+            case Expr::LE: res.tag = Expr::GE; break;
+            case Expr::GT: res.tag = Expr::LT; break;
+            default:       res.tag = Expr::LE; break;
+        }
+    }
+    if ( a->tag != Expr::ATTRIBUTE || !isNumericConstant ( b ) ) {
+        return false;
+    }
+    res.stats = lookup ( a->symbol );
+    if ( res.stats == nullptr || !res.stats->isNumeric ) {
+        return false;
+    }
+    res.attribute = a->symbol;
+    res.value = numericValue ( b->value, b->type );
+    return true;
+}
+
+
+double estimateEqualitySelectivity ( Expr* c, StatisticsLookup& lookup ) {
+    double distinct = 0.0;
+    for ( Expr* e : { c->child, c->child->next } ) {
+        if ( e->tag != Expr::ATTRIBUTE ) continue;
+        ColumnStatistics* stats = lookup ( e->symbol );
+        if ( stats != nullptr ) {
+            distinct = std::max ( distinct, stats->distinct );
+        }
+    }
+    return ( distinct > 0.0 ) ? 1.0 / distinct : DefaultEqualitySelectivity;
+}
+
+
+double estimateSelectivity ( Expr* condition, StatisticsLookup& lookup );
+
+
+/* Conjunctions multiply the selectivities of their terms. Range *
+ * comparisons on the same attribute form one range, which is    *
+ * estimated with the attribute's histogram.                     */
+double estimateConjunctionSelectivity ( std::vector < Expr* > terms, StatisticsLookup& lookup ) {
+
+    std::map < std::string, std::pair < double, double > > ranges;
+    std::map < std::string, ColumnStatistics* > rangeStats;
+    double sel = 1.0;
+
+    while ( !terms.empty() ) {
+        Expr* c = terms.back();
+        terms.pop_back();
+        AttributeComparison cmp;
+        if ( c->tag == Expr::AND ) {
+            terms.push_back ( c->child );
+            terms.push_back ( c->child->next );
+        }
+        else if ( getAttributeComparison ( c, lookup, cmp ) ) {
+            /* fractions of values below the bounds */
+            double below = cmp.stats->histogram.fractionBelow ( cmp.value );
+            double equal = 1.0 / cmp.stats->distinct;
+            auto range = ranges.try_emplace ( cmp.attribute, 0.0, 1.0 ).first;
+            rangeStats [ cmp.attribute ] = cmp.stats;
+            switch ( cmp.tag ) {
+                case Expr::LT: range->second.second = std::min ( range->second.second, below ); break;
+                case Expr::LE: range->second.second = std::min ( range->second.second, below + equal ); break;
+                case Expr::GT: range->second.first  = std::max ( range->second.first,  below + equal ); break;
+                default:       range->second.first  = std::max ( range->second.first,  below ); break;
+            }
+        }
+        else {
+            sel *= estimateSelectivity ( c, lookup );
+        }
+    }
+
+    for ( auto& range : ranges ) {
+        double frac = range.second.second - range.second.first;
+        sel *= std::clamp ( frac, 0.0, 1.0 );
+    }
+    return sel;
+}
+
+
+double estimateConjunctionSelectivity ( Expr* condition, StatisticsLookup& lookup ) {
+    return estimateConjunctionSelectivity ( std::vector < Expr* > { condition }, lookup );
+}
+
+
+/* Estimates the fraction of tuples that satisfy the condition */
+double estimateSelectivity ( Expr* condition, StatisticsLookup& lookup ) {
+
+    switch ( condition->tag ) {
+
+        case Expr::AND:
+            return estimateConjunctionSelectivity ( condition, lookup );
+
+        case Expr::OR: {
+            double a = estimateSelectivity ( condition->child, lookup );
+            double b = estimateSelectivity ( condition->child->next, lookup );
+            return a + b - a * b;
+        }
+
+        case Expr::EQ:
+            return estimateEqualitySelectivity ( condition, lookup );
+
+        case Expr::NEQ:
+            return 1.0 - estimateEqualitySelectivity ( condition, lookup );
+
+        case Expr::LT:
+        case Expr::LE:
+        case Expr::GT:
+        case Expr::GE: {
+            AttributeComparison cmp;
+            if ( getAttributeComparison ( condition, lookup, cmp ) ) {
+                return estimateConjunctionSelectivity ( condition, lookup );
+            }
+            return DefaultRangeSelectivity;
+        }
+
+        default:
+            return DefaultRangeSelectivity;
+    }
+}
@@ -25,6 +25,22 @@ union SqlValue {
 
 
 const SqlValue emptySqlValue = { 0 };
+
+
+/* Values of the parameters of a prepared statement. Compiled code *
+ * reads the values from here, so that they can change between     *
+ * executions. The types are derived when the code is generated.   */
+struct ParameterBlock {
+
+    std::vector < SqlValue >     values;
+    std::vector < SqlType >      types;
+
+    /* storage of string values */
+    std::vector < std::string >  strings;
+
+    ParameterBlock ( size_t num ) 
+        : values ( num, emptySqlValue ), types ( num ), strings ( num ) {}
+};
             
 
 static std::string serializeSqlValue ( SqlValue val, SqlType type ) {
@@ -50,5 +50,10 @@ int main() {
     std::cout << "### PARALLEL ###" << std::endl;  
     testConfig.jit.numThreads = 16;
     runTests();
+    
+    /* test the flounder interpreter */
+    std::cout << "### INTERPRETER ###" << std::endl;  
+    testConfig.jit.forceInterpreter = true;
+    runTests();
     return 0;
 }
@@ -219,6 +219,15 @@ void checkRelations ( std::string   name,
 }
 
 
+/* Runs with a forced interpreter check that no query was compiled */
+void checkInterpreted ( std::string name, JitExecutionReport& report ) {
+    if ( testConfig.jit.forceInterpreter && !report.interpreted ) {
+        std::cout << name << ": query was compiled instead of interpreted" << std::endl;
+        fail_test();
+    }
+}
+
+
 void executeSelectAndCheckRelation ( std::string   name, 
                                      RelOperator*  root, 
                                      Database&     db,
@@ -226,6 +235,7 @@ void executeSelectAndCheckRelation ( std::string   name,
                                      bool          inOrder=false ) {
 
     std::unique_ptr < SelectResult > qres = executeSelectPlan ( root, true, db, testConfig );
+    checkInterpreted ( name, qres->jitReport );
     checkRelations ( name, *qres->relation, reference, inOrder );   
 }
 
@@ -1,4 +1,8 @@
 
+#include <csignal>
+#include <filesystem>
+#include <sys/resource.h>
+
 #include "operators/JitOperators.h"
 #include "expressions.h"
 #include "dbdata.h"
@@ -232,6 +236,59 @@ void testSelectionCombined () {
 }
 
 
+/* Compares the vectorized filter kernels of this build with a *
+ * tuple by tuple evaluation of the same predicates.           */
+void testSimdFilter () {
+
+    std::cout << "Test SIMD FILTER: vectorized and scalar masks match";
+    const int64_t comparisonValues[] = { -1000, 0, 37, 1000 };
+    for ( size_t width : { 4, 8 } ) {
+        for ( size_t step : { width, (size_t) 24 } ) {
+            size_t numTuples = 100;
+            std::vector < Data > data ( numTuples * step );
+            for ( size_t i = 0; i < numTuples; i++ ) {
+                int64_t v = ( (int64_t) i * 7919 ) % 2001 - 1000;
+                if ( width == 4 ) *(int32_t*) &data [ i * step ] = (int32_t) v;
+                else              *(int64_t*) &data [ i * step ] = v;
+            }
+            for ( int c = FilterPredicate::LT; c <= FilterPredicate::NEQ; c++ ) {
+                for ( int64_t value : comparisonValues ) {
+                    SimdFilter filter;
+                    filter.step = step;
+                    filter.predicates.push_back ( { 0, width, (FilterPredicate::Comparison) c, value } );
+                    for ( size_t first : { (size_t) 0, (size_t) 5, (size_t) 64 } ) {
+                        Data* begin = data.data() + first * step;
+                        Data* end = data.data() + data.size();
+                        uint64_t mask = SimdFilter::evaluate ( &filter, begin, end );
+                        uint64_t expected = 0;
+                        for ( size_t i = 0; i < 64 && first + i < numTuples; i++ ) {
+                            Data* tuple = begin + i * step;
+                            int64_t a = ( width == 4 ) ? *(int32_t*) tuple : *(int64_t*) tuple;
+                            bool match = false;
+                            switch ( c ) {
+                                case FilterPredicate::LT:  match = a <  value; break;
+                                case FilterPredicate::LE:  match = a <= value; break;
+                                case FilterPredicate::GT:  match = a >  value; break;
+                                case FilterPredicate::GE:  match = a >= value; break;
+                                case FilterPredicate::EQ:  match = a == value; break;
+                                case FilterPredicate::NEQ: match = a != value; break;
+                            }
+                            expected |= (uint64_t) match << i;
+                        }
+                        if ( mask != expected ) {
+                            std::cout << std::endl << "width " << width << " step " << step 
+                                      << " comparison " << c << " value " << value << " first " << first;
+                            fail_test();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::cout << " OK" << std::endl;
+}
+
+
 struct JoinTestData {
     Database db;
     Relation reference;
@@ -440,6 +497,59 @@ void testNestedLoopsJoin3 () {
 }
 
 
+/* Inputs with wide tuples that span several cache tiles of the *
+ * nested loops join. Threads share the outer tiles.            */
+void testNestedLoopsJoinTiles () {
+
+    Schema schemaR = Schema ( { 
+        { "attributeA", TypeInit::BIGINT() },
+        { "paddingA",   TypeInit::CHAR(120) },
+    } );
+    Schema schemaS = Schema ( { 
+        { "attributeB", TypeInit::BIGINT() },
+        { "paddingB",   TypeInit::CHAR(120) },
+    } );
+    Schema schema = Schema ( { 
+        { "attributeA", TypeInit::BIGINT() },
+        { "paddingA",   TypeInit::CHAR(120) },
+        { "attributeB", TypeInit::BIGINT() },
+        { "paddingB",   TypeInit::CHAR(120) },
+    } );
+
+    /* about 850 tuples fit into one tile */
+    size_t n = 4000;
+    std::vector < std::vector < std::string > > relDataR;
+    std::vector < std::vector < std::string > > relDataS;
+    std::vector < std::vector < std::string > > referenceData;
+    for ( size_t i = 0; i < n; i++ ) {
+        size_t key = ( i * 7 ) % n;
+        relDataR.push_back ( { std::to_string ( i ), "r" + std::to_string ( i ) } );
+        relDataS.push_back ( { std::to_string ( key ), "s" + std::to_string ( key ) } );
+        referenceData.push_back ( { std::to_string ( key ), "r" + std::to_string ( key ),
+                                    std::to_string ( key ), "s" + std::to_string ( key ) } );
+    }
+    Database db;
+    db["R"] = relationFromStrings ( schemaR, relDataR );
+    db["S"] = relationFromStrings ( schemaS, relDataS );
+    Relation reference = relationFromStrings ( schema, referenceData );
+
+    uint16_t numThreads = testConfig.jit.numThreads;
+    for ( uint16_t threads : { 1, 4 } ) {
+        testConfig.jit.numThreads = threads;
+        RelOperator* root = 
+            new MaterializeOp (
+                new NestedLoopsJoinOp ( 
+                    eq ( attr ( "attributeA" ), attr ( "attributeB" ) ),
+                    new ScanOp ( &db["R"] ),
+                    new ScanOp ( &db["S"] )
+                )
+            );
+        executeSelectAndCheckRelation ( "NESTEDLOOPSJOIN_TILES", root, db, reference );
+    }
+    testConfig.jit.numThreads = numThreads;
+}
+
+
 void testHashJoin () {
     
     JoinTestData testData = getJoinData ();
@@ -508,6 +618,164 @@ void testHashJoin2 () {
 }
 
 
+void testMergeJoin () {
+
+    Schema schemaR = Schema ( { 
+        { "r_key", TypeInit::INT() },
+        { "r_num", TypeInit::BIGINT() },
+    } );
+    Schema schemaS = Schema ( { 
+        { "s_key", TypeInit::INT() },
+        { "s_num", TypeInit::BIGINT() },
+    } );
+
+    /* R is clustered by key with duplicates. S is clustered *
+     * except for its last part, which moves the cursor back. */
+    std::vector < std::vector < std::string > > dataR;
+    std::vector < std::vector < std::string > > dataS;
+    for ( size_t i = 0; i < 300; i++ ) {
+        dataR.push_back ( { std::to_string ( i / 3 ), std::to_string ( i ) } );
+    }
+    for ( size_t i = 0; i < 500; i++ ) {
+        size_t key = i < 400 ? i / 2 : ( i * 37 ) % 150;
+        dataS.push_back ( { std::to_string ( key ), std::to_string ( i ) } );
+    }
+    Database db;
+    db["R"] = relationFromStrings ( schemaR, dataR );
+    db["S"] = relationFromStrings ( schemaS, dataS );
+
+    RelOperator* rootNLJ = 
+        new MaterializeOp (
+            new NestedLoopsJoinOp ( 
+                eq ( attr ( "r_key" ), attr ( "s_key" ) ),
+                new ScanOp ( &db["R"] ),
+                new ScanOp ( &db["S"] )
+            )
+        );
+    QueryResult reference = executeSelectPlan ( rootNLJ, true, db );
+
+    RelOperator* rootMJ = 
+        new MaterializeOp (
+            new MergeJoinOp ( 
+                eq ( attr ( "r_key" ), attr ( "s_key" ) ),
+                new ScanOp ( &db["R"] ),
+                new ScanOp ( &db["S"] )
+            )
+        );
+    executeSelectAndCheckRelation ( "MERGEJOINOP", rootMJ, db, *reference.selectResult()->relation );
+}
+
+
+void testBandJoin () {
+
+    Schema schemaR = Schema ( { 
+        { "r_time", TypeInit::BIGINT() },
+        { "r_num",  TypeInit::BIGINT() },
+    } );
+    Schema schemaS = Schema ( { 
+        { "s_start", TypeInit::BIGINT() },
+        { "s_end",   TypeInit::BIGINT() },
+        { "s_num",   TypeInit::BIGINT() },
+    } );
+
+    /* R is unordered with duplicate times, S has *
+     * empty, single and overlapping intervals.   */
+    std::vector < std::vector < std::string > > dataR;
+    std::vector < std::vector < std::string > > dataS;
+    for ( size_t i = 0; i < 300; i++ ) {
+        dataR.push_back ( { std::to_string ( ( i * 37 ) % 200 ), std::to_string ( i ) } );
+    }
+    for ( size_t i = 0; i < 200; i++ ) {
+        size_t start = ( i * 13 ) % 210;
+        dataS.push_back ( { std::to_string ( start ), std::to_string ( start + i % 7 ), std::to_string ( i ) } );
+    }
+    Database db;
+    db["R"] = relationFromStrings ( schemaR, dataR );
+    db["S"] = relationFromStrings ( schemaS, dataS );
+
+    RelOperator* rootNLJ = 
+        new MaterializeOp (
+            new NestedLoopsJoinOp ( 
+                and_ ( ge ( attr ( "r_time" ), attr ( "s_start" ) ),
+                       lt ( attr ( "r_time" ), attr ( "s_end" ) ) ),
+                new ScanOp ( &db["R"] ),
+                new ScanOp ( &db["S"] )
+            )
+        );
+    QueryResult reference = executeSelectPlan ( rootNLJ, true, db );
+
+    RelOperator* rootBJ = 
+        new MaterializeOp (
+            new BandJoinOp ( 
+                ge ( attr ( "r_time" ), attr ( "s_start" ) ),
+                lt ( attr ( "r_time" ), attr ( "s_end" ) ),
+                new ScanOp ( &db["R"] ),
+                new ScanOp ( &db["S"] )
+            )
+        );
+    executeSelectAndCheckRelation ( "BANDJOINOP", rootBJ, db, *reference.selectResult()->relation );
+}
+
+
+void testSemiJoin () {
+
+    Schema schemaR = Schema ( { 
+        { "r_key", TypeInit::INT() },
+        { "r_num", TypeInit::BIGINT() },
+    } );
+    Schema schemaS = Schema ( { 
+        { "s_key", TypeInit::INT() },
+    } );
+
+    /* S contains each third key twice. R tuples pass the *
+     * semi join once and the anti join never for those.  */
+    std::vector < std::vector < std::string > > dataR;
+    std::vector < std::vector < std::string > > dataS;
+    std::vector < std::vector < std::string > > dataSemi;
+    std::vector < std::vector < std::string > > dataAnti;
+    for ( size_t i = 0; i < 300; i++ ) {
+        std::vector < std::string > tuple = { std::to_string ( i % 200 ), std::to_string ( i ) };
+        dataR.push_back ( tuple );
+        if ( i % 200 % 3 == 0 && i % 200 < 150 ) {
+            dataSemi.push_back ( tuple );
+        }
+        else {
+            dataAnti.push_back ( tuple );
+        }
+    }
+    for ( size_t i = 0; i < 100; i++ ) {
+        dataS.push_back ( { std::to_string ( i * 3 % 150 ) } );
+    }
+    Database db;
+    db["R"] = relationFromStrings ( schemaR, dataR );
+    db["S"] = relationFromStrings ( schemaS, dataS );
+
+    RelOperator* rootSemi = 
+        new MaterializeOp (
+            new SemiJoinOp ( 
+                { eq ( attr ( "s_key" ), attr ( "r_key" ) ) },
+                false,
+                new ScanOp ( &db["S"] ),
+                new ScanOp ( &db["R"] )
+            )
+        );
+    Relation referenceSemi = relationFromStrings ( schemaR, dataSemi );
+    executeSelectAndCheckRelation ( "SEMIJOINOP", rootSemi, db, referenceSemi );
+
+    RelOperator* rootAnti = 
+        new MaterializeOp (
+            new SemiJoinOp ( 
+                { eq ( attr ( "s_key" ), attr ( "r_key" ) ) },
+                true,
+                new ScanOp ( &db["S"] ),
+                new ScanOp ( &db["R"] )
+            )
+        );
+    Relation referenceAnti = relationFromStrings ( schemaR, dataAnti );
+    executeSelectAndCheckRelation ( "ANTIJOINOP", rootAnti, db, referenceAnti );
+}
+
+
 void testAggregation () {
     
     Schema schema = Schema ( { 
@@ -831,6 +1099,83 @@ void testAggregation5 () {
 }
 
 
+void testGroupJoin () {
+
+    Schema schemaR = Schema ( {
+        { "attributeA", TypeInit::BIGINT() },
+        { "attributeB", TypeInit::BIGINT() }
+    } );
+    Schema schemaS = Schema ( {
+        { "attributeC", TypeInit::BIGINT() },
+        { "attributeD", TypeInit::BIGINT() }
+    } );
+
+    std::vector < std::vector < std::string > > relDataR = {
+        { "1", "10" },
+        { "2", "20" },
+        { "3", "30" },
+        { "4", "40" }
+    };
+    std::vector < std::vector < std::string > > relDataS = {
+        { "1", "300" },
+        { "2", "400" },
+        { "3", "300" },
+        { "1", "400" },
+        { "2", "300" },
+        { "3", "400" },
+        { "1", "100" }
+    };
+    Database db;
+    db["R"] = relationFromStrings ( schemaR, relDataR );
+    db["S"] = relationFromStrings ( schemaS, relDataS );
+
+    Schema refSchema = Schema ( {
+        { "attributeA",        TypeInit::BIGINT() },
+        { "sum(attributeD)",   TypeInit::BIGINT() },
+        { "count(attributeD)", TypeInit::BIGINT() },
+        { "max(attributeB)",   TypeInit::BIGINT() }
+    } );
+    std::vector < std::vector < std::string > > referenceData = {
+        { "1", "800", "3", "10" },
+        { "2", "700", "2", "20" },
+        { "3", "700", "2", "30" }
+    };
+    Relation reference = relationFromStrings ( refSchema, referenceData );
+
+    RelOperator* root =
+        new MaterializeOp (
+            new GroupJoinOp (
+                /* aggregation, grouping and join expressions */
+                {
+                    sum (
+                        attr ( "attributeD" )
+                    ),
+                    count (
+                        attr ( "attributeD" )
+                    ),
+                    max (
+                        attr ( "attributeB" )
+                    )
+                },
+                {
+                    attr ( "attributeA" )
+                },
+                {
+                    eq (
+                        attr ( "attributeA" ),
+                        attr ( "attributeC" )
+                    )
+                },
+                /* end */
+                new ScanOp ( &db["R"] ),
+                new ScanOp ( &db["S"] )
+            )
+        );
+
+    executeSelectAndCheckRelation ( "GROUPJOIN", root, db, reference );
+}
+
+
 void testOrderBy() {
     
     Schema schema = Schema ( { 
@@ -888,22 +1233,283 @@ void testOrderBy() {
 }
 
 
+void testOrderBy2() {
+    
+    Schema schema = Schema ( { 
+        { "name",  TypeInit::CHAR(12) },
+        { "num",   TypeInit::INT() },
+    } );
+
+    std::vector < std::vector < std::string > > relData = { 
+        { "abcdefghij", "3" },
+        { "abcdefghik", "1" },
+        { "b",          "-2" },
+        { "abcdefghij", "-7" },
+        { "a",          "5" },
+        { "b",          "-9" },
+        { "abcdefghik", "0" },
+        { "a",          "-5" },
+        { "abcdefghij", "3" },
+        { "b",          "4" } 
+    };
+    Database db;
+    db["rel"] = relationFromStrings ( schema, relData );
+
+    std::vector < std::vector < std::string > > referenceData = { 
+        { "b",          "-9" },
+        { "b",          "-2" },
+        { "b",          "4" },
+        { "abcdefghik", "0" },
+        { "abcdefghik", "1" },
+        { "abcdefghij", "-7" },
+        { "abcdefghij", "3" },
+        { "abcdefghij", "3" },
+        { "a",          "-5" },
+        { "a",          "5" } 
+    };
+    Relation reference = relationFromStrings ( schema, referenceData );
+
+    RelOperator* root = 
+        new OrderByOp ( { desc ( attr ( "name" ) ), attr ( "num" ) },
+            new ScanOp ( &db["rel"] )
+        );
+    
+    executeSelectAndCheckRelation ( "ORDERBY2", root, db, reference, true );
+}
+
+void testTopK() {
+    
+    Schema schema = Schema ( { 
+        { "name",  TypeInit::CHAR(12) },
+        { "num",   TypeInit::INT() },
+    } );
+
+    std::vector < std::vector < std::string > > relData = { 
+        { "abcdefghij", "3" },
+        { "abcdefghik", "1" },
+        { "b",          "-2" },
+        { "abcdefghij", "-7" },
+        { "a",          "5" },
+        { "b",          "-9" },
+        { "abcdefghik", "0" },
+        { "a",          "-5" },
+        { "abcdefghij", "3" },
+        { "b",          "4" } 
+    };
+    Database db;
+    db["rel"] = relationFromStrings ( schema, relData );
+
+    std::vector < std::vector < std::string > > referenceData = { 
+        { "b",          "-9" },
+        { "b",          "-2" },
+        { "b",          "4" },
+        { "abcdefghik", "0" }
+    };
+    Relation reference = relationFromStrings ( schema, referenceData );
+
+    RelOperator* root = 
+        new TopKOp ( { desc ( attr ( "name" ) ), attr ( "num" ) }, 4,
+            new ScanOp ( &db["rel"] )
+        );
+    
+    executeSelectAndCheckRelation ( "TOPK", root, db, reference, true );
+}
+
+void testOrderByExternal() {
+    
+    Schema schema = Schema ( { 
+        { "key",   TypeInit::BIGINT() },
+        { "num",   TypeInit::INT() },
+    } );
+
+    /* input exceeds the memory budget of 1 MB */
+    size_t n = 100000;
+    std::vector < std::vector < std::string > > relData;
+    std::vector < std::vector < std::string > > referenceData;
+    for ( size_t i = 0; i < n; i++ ) {
+        size_t key = ( i * 7919 ) % n;
+        relData.push_back ( { std::to_string ( key ), std::to_string ( key % 10 ) } );
+        referenceData.push_back ( { std::to_string ( n - 1 - i ), std::to_string ( ( n - 1 - i ) % 10 ) } );
+    }
+    Database db;
+    db["rel"] = relationFromStrings ( schema, relData );
+    Relation reference = relationFromStrings ( schema, referenceData );
+
+    RelOperator* root = 
+        new OrderByOp ( { desc ( attr ( "key" ) ) },
+            new ScanOp ( &db["rel"] )
+        );
+    
+    testConfig.jit.sortMemoryMB = 1;
+    executeSelectAndCheckRelation ( "ORDERBY_EXTERNAL", root, db, reference, true );
+    testConfig.jit.sortMemoryMB = 0;
+
+    /* Runs that cannot be written fail the query after the worker threads *
+     * joined. The run buffers hold at least one data block, the input is  *
+     * only spilled when the blocks are small or there are many threads.   */
+    size_t numThreads = testConfig.jit.numThreads;
+    size_t bufferBytes = std::max ( ( (size_t) 1 << 20 ) / ( 2 * numThreads ), DataBlock::Size );
+    if ( n * schema._tupSize / numThreads < bufferBytes ) {
+        return;
+    }
+
+    /* The file size limit also applies to the output of the test. The *
+     * query is compiled before and nothing is printed while it runs.  */
+    std::cout << "Test ORDERBY_EXTERNAL_WRITE_ERROR: spilling fails";
+    std::cout.flush();
+    root = 
+        new OrderByOp ( { desc ( attr ( "key" ) ) },
+            new ScanOp ( &db["rel"] )
+        );
+    testConfig.jit.sortMemoryMB = 1;
+    std::unique_ptr < CompiledQuery > query = compileSelectPlan ( root, true, db, testConfig );
+    testConfig.jit.sortMemoryMB = 0;
+    struct rlimit previous;
+    getrlimit ( RLIMIT_FSIZE, &previous );
+    struct rlimit limit = previous;
+    limit.rlim_cur = 4096;
+    auto previousHandler = signal ( SIGXFSZ, SIG_IGN );
+    setrlimit ( RLIMIT_FSIZE, &limit );
+    std::string error;
+    try {
+        executeCompiledQuery ( *query, testConfig );
+    }
+    catch ( ResqlError& err ) {
+        error = err.message();
+    }
+    setrlimit ( RLIMIT_FSIZE, &previous );
+    signal ( SIGXFSZ, previousHandler );
+    if ( error.empty() ) {
+        std::cout << std::endl << "ORDERBY_EXTERNAL_WRITE_ERROR: query did not fail" << std::endl;
+        fail_test();
+    }
+    std::cout << " with '" << error << "' OK" << std::endl;
+}
+
+void testOrderByExpression() {
+    
+    Schema schema = Schema ( { 
+        { "name",  TypeInit::CHAR(4) },
+        { "num",   TypeInit::BIGINT() },
+    } );
+
+    std::vector < std::vector < std::string > > relData = { 
+        { "a", "3" },
+        { "b", "-4" },
+        { "c", "1" },
+        { "d", "-3" },
+        { "e", "0" },
+        { "f", "2" }
+    };
+    Database db;
+    db["rel"] = relationFromStrings ( schema, relData );
+
+    std::vector < std::vector < std::string > > referenceData = { 
+        { "b", "-4" },
+        { "a", "3" },
+        { "d", "-3" },
+        { "f", "2" },
+        { "c", "1" },
+        { "e", "0" }
+    };
+    Relation reference = relationFromStrings ( schema, referenceData );
+    
+    RelOperator* root = 
+        new OrderByOp ( { desc ( mul ( attr ( "num" ), attr ( "num" ) ) ), attr ( "name" ) },
+            new ScanOp ( &db["rel"] )
+        );
+    executeSelectAndCheckRelation ( "ORDERBY_EXPRESSION", root, db, reference, true );
+
+    referenceData.resize ( 3 );
+    Relation referenceTopK = relationFromStrings ( schema, referenceData );
+    root = 
+        new TopKOp ( { desc ( mul ( attr ( "num" ), attr ( "num" ) ) ), attr ( "name" ) }, 3,
+            new ScanOp ( &db["rel"] )
+        );
+    executeSelectAndCheckRelation ( "TOPK_EXPRESSION", root, db, referenceTopK, true );
+}
+
+/* Truncates the files of a code cache or changes a byte near their end */
+void damageCodeCache ( const std::string& directory, bool truncate ) {
+    for ( auto& entry : std::filesystem::directory_iterator ( directory ) ) {
+        size_t size = entry.file_size();
+        if ( truncate ) {
+            std::filesystem::resize_file ( entry.path(), size / 2 );
+            continue;
+        }
+        std::fstream file ( entry.path(), std::ios::in | std::ios::out | std::ios::binary );
+        file.seekg ( size - 9 );
+        char byte = file.get();
+        file.seekp ( size - 9 );
+        file.put ( byte ^ 0x5A );
+    }
+}
+
+
+/* Runs a join with a code cache. The second run loads the *
+ * machine code and patches in its new runtime state. Runs  *
+ * with damaged cache files compile the code again.         */
+void testCodeCache() {
+
+    char directory[] = "/tmp/resqlcodeXXXXXX";
+    if ( mkdtemp ( directory ) == nullptr ) {
+        fail_test();
+    }
+    testConfig.codeCacheDirectory = directory;
+    for ( int run = 0; run < 4; run++ ) {
+        /* damaged files are cache misses and the code is compiled */
+        if ( run >= 2 ) {
+            damageCodeCache ( directory, run == 2 );
+        }
+        JoinTestData testData = getJoinData ();
+        RelOperator* root = 
+            new MaterializeOp (
+                new HashJoinOp ( 
+                    { eq ( attr ( "attributeA" ), attr ( "attributeC" ) ) },
+                    new ScanOp ( &testData.db["R"] ),
+                    new ScanOp ( &testData.db["S"] )
+                )
+            );
+        std::unique_ptr < SelectResult > qres = executeSelectPlan ( root, true, testData.db, testConfig );
+        checkRelations ( "CODECACHE", *qres->relation, testData.reference, false );
+        bool expectCached = ( run == 1 ) && useCodeCache ( testConfig );
+        if ( qres->jitReport.loadedFromCache != expectCached ) {
+            std::cout << "CODECACHE: code was " << ( expectCached ? "not " : "" ) 
+                      << "loaded from the cache" << std::endl;
+            fail_test();
+        }
+    }
+    testConfig.codeCacheDirectory = "";
+    std::filesystem::remove_all ( directory );
+}
+
 void testOperators() {
     testScan();
     testSelectionDecimal();  // lt or gt
     testSelectionDecimal2(); // lt (attr)
     testSelectionDate();     // le and ge
     testSelectionCombined(); // lt and ( lt or lt )
+    testSimdFilter();        // vectorized predicate kernels
     testNestedLoopsJoin();
     testNestedLoopsJoin2();
     testNestedLoopsJoin3();
+    testNestedLoopsJoinTiles(); // inputs that span several tiles
     testHashJoin();
     testHashJoin2();
+    testMergeJoin();
+    testBandJoin();
+    testSemiJoin();
     testAggregation();  // simple grouped aggregation
     testAggregation2(); // multiple group attributes
     testAggregation3(); // aggregation without groups
     testAggregation4(); // grouping without aggregation
     testAggregation5(); // calculated grouping and aggregation inputs
+    testGroupJoin();    // fused join and aggregation on the join key
     testOrderBy();      // basic ordering of bigints
+    testOrderBy2();     // multiple keys, descending strings with long prefixes
+    testTopK();         // order by with limit
+    testOrderByExternal(); // order by with spilled runs
+    testOrderByExpression(); // order by computed keys
+    testCodeCache();    // machine code reused from the code cache
 }
 
@@ -1,7 +1,25 @@
+#include <filesystem>
+
 #include "execute.h"
 #include "planner.h"
 
 
+/* Executes a select statement and compares its result with the reference */
+void executeStatementAndCheckRelation ( std::string  name, 
+                                        std::string  statement, 
+                                        Database&    db, 
+                                        Relation&    reference, 
+                                        bool         inOrder=false ) {
+    QueryResult res = executeStatement ( statement, db, testConfig );
+    if ( res.error || res.tag != Query::SELECT ) {
+        std::cout << name << ": " << res.errorMessage << std::endl;
+        fail_test();
+    }
+    checkInterpreted ( name, res.selectResult()->jitReport );
+    checkRelations ( name, *res.selectResult()->relation, reference, inOrder );
+}
+
+
 void q1 ( Database& db ) {
     Schema schema = Schema ( { 
         { "l_returnflag",   TypeInit::CHAR(1) }, 
@@ -55,6 +73,21 @@ void q6 ( Database& db ) {
 }
 
 
+void q6Prepared ( Database& db ) {
+    Schema schema = Schema ( { 
+        { "revenue",  TypeInit::DECIMAL(19,4) }
+    } );
+    Relation ref = relationFromFile ( schema, "test/reference/q6.tbl", "|" );
+    executeStatement ( "prepare q6 as select sum(l_extendedprice * l_discount) as revenue "
+                       "from lineitem where l_shipdate >= ? and l_shipdate < ? "
+                       "and l_discount between ? and ? and l_quantity < ?", db, testConfig );
+    executeStatement ( "execute q6 ( date '1995-01-01', date '1996-01-01', 0.02, 0.04, 10 )", db, testConfig );
+    QueryResult res = executeStatement ( "execute q6 ( date '1994-01-01', '1995-01-01', 0.05, 0.07, 24 )", 
+                                         db, testConfig );
+    checkRelations ( "TPC-H Q6 prepared", *res.selectResult()->relation, ref, true );
+}
+
+
 void q10 ( Database& db ) {
     Schema schema = Schema ( { 
         { "c_custkey", TypeInit::INT() },
@@ -94,6 +127,437 @@ void q19 ( Database& db ) {
 }
 
 
+/* Writes rows with '|' separated fields for bulk inserts */
+void writeTableFile ( std::string filename, std::vector < std::string > rows ) {
+    std::ofstream f ( filename );
+    for ( auto& row : rows ) {
+        f << row << "|" << std::endl;
+    }
+}
+
+
+/* Executes a statement that has to fail */
+void executeStatementAndExpectError ( std::string  name, 
+                                      std::string  statement, 
+                                      Database&    db ) {
+    std::cout << "Test " << name << ": " << statement << " fails";
+    QueryResult res = executeStatement ( statement, db, testConfig );
+    if ( !res.error ) {
+        fail_test();
+    }
+    std::cout << " with '" << res.errorMessage << "' OK" << std::endl;
+}
+
+
+void executeStatementAndExpectSuccess ( std::string  statement, 
+                                        Database&    db ) {
+    QueryResult res = executeStatement ( statement, db, testConfig );
+    if ( res.error ) {
+        std::cout << statement << ": " << res.errorMessage << std::endl;
+        fail_test();
+    }
+}
+
+
+void checkEstimate ( std::string name, double estimate, double expected, double tolerance ) {
+    std::cout << "Test " << name << ": " << estimate << " should be " << expected 
+              << " +- " << tolerance << " ";
+    if ( std::abs ( estimate - expected ) > tolerance ) {
+        fail_test();
+    }
+    std::cout << " OK" << std::endl;
+}
+
+
+/* Statistics of a table with a known number of distinct values and range */
+void statisticsQueries () {
+    char directory[] = "/tmp/resqlstatsXXXXXX";
+    if ( mkdtemp ( directory ) == nullptr ) {
+        fail_test();
+    }
+    std::string dir = directory;
+
+    HyperLogLog small, large;
+    for ( uint64_t i = 0; i < 100; i++ ) small.add ( i );
+    for ( uint64_t i = 0; i < 100000; i++ ) large.add ( i );
+    checkEstimate ( "HYPERLOGLOG SMALL", small.estimate(), 100, 2 );
+    checkEstimate ( "HYPERLOGLOG LARGE", large.estimate(), 100000, 5000 );
+
+    std::vector < double > values;
+    for ( int i = 0; i < 1000; i++ ) values.push_back ( 999 - i );
+    Histogram histogram;
+    histogram.build ( values );
+    checkEstimate ( "HISTOGRAM MIN", histogram.fractionBelow ( 0 ), 0.0, 0.0 );
+    checkEstimate ( "HISTOGRAM QUARTER", histogram.fractionBelow ( 250 ), 0.25, 0.01 );
+    checkEstimate ( "HISTOGRAM MAX", histogram.fractionBelow ( 1000 ), 1.0, 0.0 );
+
+    /* k has 1000 distinct values from 0 to 999, g has 10 */
+    Database db;
+    std::vector < std::string > rows;
+    for ( int k = 0; k < 1000; k++ ) {
+        rows.push_back ( std::to_string ( k ) + "|" + std::to_string ( k % 10 ) );
+    }
+    writeTableFile ( dir + "/stats.tbl", rows );
+    executeStatement ( "create table stats ( k int, g int )", db, testConfig );
+    executeStatement ( "bulk insert stats from \"" + dir + "/stats.tbl\" with ( fieldterminator=\"|\" )", 
+                       db, testConfig );
+    Relation& rel = db["stats"];
+    rel._statistics = TableStatistics();
+    executeStatement ( "analyze stats", db, testConfig );
+    checkEstimate ( "ANALYZE ROWS", rel._statistics.rowCount, 1000, 0 );
+    ColumnStatistics* k = rel._statistics.column ( "k" );
+    ColumnStatistics* g = rel._statistics.column ( "g" );
+    if ( k == nullptr || g == nullptr ) {
+        std::cout << "ANALYZE: missing column statistics" << std::endl;
+        fail_test();
+    }
+    checkEstimate ( "ANALYZE DISTINCT K", k->distinct, 1000, 20 );
+    checkEstimate ( "ANALYZE DISTINCT G", g->distinct, 10, 0.5 );
+    checkEstimate ( "ANALYZE MIN", k->min.intData, 0, 0 );
+    checkEstimate ( "ANALYZE MAX", k->max.intData, 999, 0 );
+
+    using namespace ExprGen;
+    StatisticsLookup lookup = [&rel] ( const std::string& name ) { 
+        return rel._statistics.column ( name ); 
+    };
+    Expr* range = and_ ( ge ( attr ( "k" ), constant ( "200", SqlType::INT ) ),
+                         lt ( attr ( "k" ), constant ( "400", SqlType::INT ) ) );
+    checkEstimate ( "RANGE SELECTIVITY", estimateSelectivity ( range, lookup ), 0.2, 0.02 );
+    Expr* rangeAndEq = and_ ( and_ ( lt ( constant ( "500", SqlType::INT ), attr ( "k" ) ),
+                                     le ( attr ( "k" ), constant ( "999", SqlType::INT ) ) ),
+                              eq ( attr ( "g" ), constant ( "3", SqlType::INT ) ) );
+    checkEstimate ( "RANGE AND EQUALITY SELECTIVITY", estimateSelectivity ( rangeAndEq, lookup ), 0.05, 0.005 );
+    freeExpr ( range );
+    freeExpr ( rangeAndEq );
+    std::filesystem::remove_all ( dir );
+}
+
+
+/* Number of executions of the cached code of a statement (0: not cached) */
+size_t cachedExecutions ( std::string statement, Database& db ) {
+    auto it = db.compiledQueries.find ( compiledQueryKey ( statement, testConfig ) );
+    return ( it == db.compiledQueries.end() ) ? 0 : it->second->numExecutions;
+}
+
+
+void checkCachedExecutions ( std::string name, std::string statement, Database& db, size_t expected ) {
+    size_t executions = cachedExecutions ( statement, db );
+    std::cout << "Test " << name << ": " << executions << " cached executions should be " << expected << " ";
+    if ( executions != expected ) {
+        fail_test();
+    }
+    std::cout << " OK" << std::endl;
+}
+
+
+/* Select statements are executed again from the cache of compiled *
+ * queries until tables are created, filled or analyzed.            */
+void compiledQueryCacheQueries () {
+    char directory[] = "/tmp/resqlcacheXXXXXX";
+    if ( mkdtemp ( directory ) == nullptr ) {
+        fail_test();
+    }
+    std::string dir = directory;
+    std::vector < std::string > rows;
+    for ( int k = 0; k < 100; k++ ) {
+        rows.push_back ( std::to_string ( k ) + "|" + std::to_string ( k % 10 ) );
+    }
+    writeTableFile ( dir + "/cache.tbl", rows );
+    std::string insert = "bulk insert cache from \"" + dir + "/cache.tbl\" with ( fieldterminator=\"|\" )";
+    std::string select = "select count(*) as c from cache where g = 3";
+
+    Database db;
+    Schema countSchema = Schema ( { { "c", TypeInit::BIGINT() } } );
+    Relation ten = relationFromStrings ( countSchema, { { "10" } } );
+    Relation twenty = relationFromStrings ( countSchema, { { "20" } } );
+    executeStatement ( "create table cache ( k int, g int )", db, testConfig );
+    executeStatement ( insert, db, testConfig );
+
+    executeStatementAndCheckRelation ( "COMPILED QUERY", select, db, ten );
+    checkCachedExecutions ( "COMPILED QUERY CACHED", select, db, 1 );
+    executeStatementAndCheckRelation ( "COMPILED QUERY AGAIN", "select  count(*) as c\nfrom cache where g = 3;", db, ten );
+    checkCachedExecutions ( "COMPILED QUERY HIT", select, db, 2 );
+
+    executeStatement ( "create table other ( a int )", db, testConfig );
+    checkCachedExecutions ( "CREATE TABLE INVALIDATES", select, db, 0 );
+
+    executeStatementAndCheckRelation ( "COMPILED QUERY AFTER CREATE", select, db, ten );
+    executeStatement ( insert, db, testConfig );
+    checkCachedExecutions ( "BULK INSERT INVALIDATES", select, db, 0 );
+    executeStatementAndCheckRelation ( "COMPILED QUERY AFTER INSERT", select, db, twenty );
+
+    executeStatement ( "analyze cache", db, testConfig );
+    checkCachedExecutions ( "ANALYZE INVALIDATES", select, db, 0 );
+    executeStatementAndCheckRelation ( "COMPILED QUERY AFTER ANALYZE", select, db, twenty );
+    checkCachedExecutions ( "COMPILED QUERY CACHED AGAIN", select, db, 1 );
+    std::filesystem::remove_all ( dir );
+}
+
+
+/* Tables that are scanned below op */
+std::set < std::string > scannedTables ( RelOperator* op ) {
+    std::set < std::string > tables;
+    if ( op->tag == RelOperator::SCAN ) {
+        tables.insert ( ((ScanOp*)op)->relationName );
+    }
+    for ( RelOperator* child : op->children ) {
+        std::set < std::string > childTables = scannedTables ( child );
+        tables.insert ( childTables.begin(), childTables.end() );
+    }
+    return tables;
+}
+
+
+/* True when op has a join of exactly the given tables */
+bool hasJoinOfTables ( RelOperator* op, std::set < std::string > tables ) {
+    if ( op->children.size() == 2 && scannedTables ( op ) == tables ) {
+        return true;
+    }
+    for ( RelOperator* child : op->children ) {
+        if ( hasJoinOfTables ( child, tables ) ) return true;
+    }
+    return false;
+}
+
+
+/* The from clause lists the large join first. The enumeration joins *
+ * the selective nation table with customer before joining orders.   */
+void joinOrderQuery ( Database& db ) {
+    std::string statement = "select count(*) as c from customer, orders, nation "
+                            "where c_custkey = o_custkey and c_nationkey = n_nationkey "
+                            "and n_name = 'GERMANY'";
+
+    Query query = parseSql ( statement );
+    buildQuery ( query, db );
+    bool validOrder = hasJoinOfTables ( query.plan, { "CUSTOMER", "NATION" } );
+    query.plan->deletePlan();
+    std::cout << "Test JOIN ORDER: customer and nation are joined first ";
+    if ( !validOrder ) {
+        fail_test();
+    }
+    std::cout << " OK" << std::endl;
+
+    /* 57 german customers have 554 orders */
+    Schema countSchema = Schema ( { { "c", TypeInit::BIGINT() } } );
+    Relation reference = relationFromStrings ( countSchema, { { "554" } } );
+    executeStatementAndCheckRelation ( "JOIN ORDER RESULT", statement, db, reference );
+}
+
+
+/* Collects the hash joins of a plan with the tables of their build side */
+void collectHashJoins ( RelOperator*                                                 op, 
+                        std::vector < std::pair < std::set < std::string >, bool > >&  joins ) {
+    if ( op->tag == RelOperator::HASHJOIN ) {
+        joins.push_back ( { scannedTables ( op->_lChild ), ((HashJoinOp*)op)->_singleMatch } );
+    }
+    for ( RelOperator* child : op->children ) {
+        collectHashJoins ( child, joins );
+    }
+}
+
+
+void keyConstraintQueries () {
+    char directory[] = "/tmp/resqlkeysXXXXXX";
+    if ( mkdtemp ( directory ) == nullptr ) {
+        fail_test();
+    }
+    std::string dir = directory;
+    Database db;
+    Schema countSchema = Schema ( { { "c", TypeInit::BIGINT() } } );
+
+    /* column and table constraints */
+    executeStatementAndExpectSuccess ( "create table keys ( k int primary key, a int, b char(4), unique ( a, b ) )", db );
+    std::vector < std::vector < std::string > > expectedKeys = { { "k" }, { "a", "b" } };
+    std::cout << "Test KEY CONSTRAINTS: parsed keys";
+    if ( db["keys"]._uniqueKeys != expectedKeys ) {
+        fail_test();
+    }
+    std::cout << " OK" << std::endl;
+
+    writeTableFile ( dir + "/keys1.tbl", { "1|1|x", "2|1|y", "3|2|x" } );
+    writeTableFile ( dir + "/keys2.tbl", { "4|3|x", "2|4|x" } );
+    writeTableFile ( dir + "/keys3.tbl", { "5|5|x", "6|5|x" } );
+    writeTableFile ( dir + "/keys4.tbl", { "4|3|x", "5|5|x" } );
+    std::string with = "\" with ( fieldterminator=\"|\" )";
+    executeStatementAndExpectSuccess ( "bulk insert keys from \"" + dir + "/keys1.tbl" + with, db );
+
+    /* duplicate of an existing key and duplicate within the inserted tuples */
+    executeStatementAndExpectError ( "PRIMARY KEY VIOLATION", 
+        "bulk insert keys from \"" + dir + "/keys2.tbl" + with, db );
+    executeStatementAndExpectError ( "UNIQUE VIOLATION", 
+        "bulk insert keys from \"" + dir + "/keys3.tbl" + with, db );
+    Relation three = relationFromStrings ( countSchema, { { "3" } } );
+    executeStatementAndCheckRelation ( "KEY VIOLATION ROLLBACK", "select count(*) as c from keys", db, three );
+
+    /* the keys of removed tuples can be inserted again */
+    executeStatementAndExpectSuccess ( "bulk insert keys from \"" + dir + "/keys4.tbl" + with, db );
+    Relation five = relationFromStrings ( countSchema, { { "5" } } );
+    executeStatementAndCheckRelation ( "KEY INSERT AFTER ROLLBACK", "select count(*) as c from keys", db, five );
+    std::filesystem::remove_all ( dir );
+}
+
+
+/* Order by expressions over attributes that the select clause drops. The *
+ * projection passes the attributes through to the sort key computation.  */
+void orderByHiddenKeyQueries () {
+    char directory[] = "/tmp/resqlorderXXXXXX";
+    if ( mkdtemp ( directory ) == nullptr ) {
+        fail_test();
+    }
+    std::string dir = directory;
+    Database db;
+    std::string with = "\" with ( fieldterminator=\"|\" )";
+    executeStatementAndExpectSuccess ( "create table u ( a bigint, b bigint, c bigint )", db );
+    executeStatementAndExpectSuccess ( "create table v ( k bigint, w bigint )", db );
+    writeTableFile ( dir + "/u.tbl", { "1|5|0", "2|1|1", "3|3|3", "4|0|1", "5|2|2" } );
+    writeTableFile ( dir + "/v.tbl", { "1|50", "2|40", "3|30", "4|20", "5|10" } );
+    executeStatementAndExpectSuccess ( "bulk insert u from \"" + dir + "/u.tbl" + with, db );
+    executeStatementAndExpectSuccess ( "bulk insert v from \"" + dir + "/v.tbl" + with, db );
+
+    Schema schema = Schema ( { { "a", TypeInit::BIGINT() } } );
+    Relation ascending = relationFromStrings ( schema, { { "4" }, { "2" }, { "5" }, { "1" }, { "3" } } );
+    executeStatementAndCheckRelation ( "ORDER BY HIDDEN KEY", 
+        "select a from u order by b + c", db, ascending, true );
+    Relation descending = relationFromStrings ( schema, { { "3" }, { "1" }, { "5" }, { "2" }, { "4" } } );
+    executeStatementAndCheckRelation ( "ORDER BY HIDDEN KEY DESC", 
+        "select a from u order by b + c desc", db, descending, true );
+    Relation first = relationFromStrings ( schema, { { "4" }, { "2" } } );
+    executeStatementAndCheckRelation ( "ORDER BY HIDDEN KEY LIMIT", 
+        "select a from u order by b + c limit 2", db, first, true );
+    Relation joined = relationFromStrings ( schema, { { "5" }, { "4" }, { "3" }, { "2" }, { "1" } } );
+    executeStatementAndCheckRelation ( "ORDER BY HIDDEN JOIN KEY", 
+        "select a from u, v where a = k order by w - b", db, joined, true );
+
+    /* attributes below an aggregation are not available */
+    executeStatementAndExpectError ( "ORDER BY UNGROUPED KEY", 
+        "select b, sum(a) as s from u group by b order by c + 1", db );
+    std::filesystem::remove_all ( dir );
+}
+
+
+/* Probes match at most one build tuple when the build key stays unique. *
+ * After nation is joined with supplier its key repeats per supplier.    */
+void singleMatchQuery ( Database& db ) {
+    std::string statement = "select count(*) as c from nation, supplier, customer "
+                            "where n_nationkey = s_nationkey and n_nationkey = c_nationkey "
+                            "and n_name = 'GERMANY'";
+
+    Query query = parseSql ( statement );
+    buildQuery ( query, db );
+    std::vector < std::pair < std::set < std::string >, bool > > joins;
+    collectHashJoins ( query.plan, joins );
+    query.plan->deletePlan();
+    std::cout << "Test SINGLE MATCH: single-match probes only for unique build keys ";
+    bool uniqueBuild = false;
+    bool joinedBuild = false;
+    for ( auto& join : joins ) {
+        if ( join.first == std::set < std::string > { "NATION" } ) {
+            uniqueBuild = join.second;
+        }
+        if ( join.first.size() > 1 ) {
+            joinedBuild = !join.second;
+        }
+    }
+    if ( !uniqueBuild || !joinedBuild ) {
+        fail_test();
+    }
+    std::cout << " OK" << std::endl;
+
+    /* 5 german suppliers and 57 german customers */
+    Schema countSchema = Schema ( { { "c", TypeInit::BIGINT() } } );
+    Relation reference = relationFromStrings ( countSchema, { { "285" } } );
+    executeStatementAndCheckRelation ( "SINGLE MATCH RESULT", statement, db, reference );
+}
+
+
+void semiJoinQueries ( Database& db ) {
+    Schema regionSchema = Schema ( { { "r_name", TypeInit::CHAR(25) } } );
+    Schema nationSchema = Schema ( { { "n_name", TypeInit::CHAR(25) } } );
+    Schema countSchema  = Schema ( { { "c", TypeInit::BIGINT() } } );
+
+    Relation europe = relationFromStrings ( regionSchema, { { "EUROPE" } } );
+    executeStatementAndCheckRelation ( "EXISTS",
+        "select r_name from region where exists "
+        "( select * from nation where n_regionkey = r_regionkey and n_name = 'GERMANY' )", db, europe );
+
+    Relation notEurope = relationFromStrings ( regionSchema, 
+        { { "AFRICA" }, { "AMERICA" }, { "ASIA" }, { "MIDDLE EAST" } } );
+    executeStatementAndCheckRelation ( "NOT EXISTS",
+        "select r_name from region where not exists "
+        "( select * from nation where n_regionkey = r_regionkey and n_name = 'GERMANY' )", db, notEurope );
+
+    Relation asia = relationFromStrings ( nationSchema, 
+        { { "INDIA" }, { "INDONESIA" }, { "JAPAN" }, { "CHINA" }, { "VIETNAM" } } );
+    executeStatementAndCheckRelation ( "IN",
+        "select n_name from nation where n_regionkey in "
+        "( select r_regionkey from region where r_name = 'ASIA' )", db, asia );
+
+    /* 20 of the 100 suppliers are in the 5 nations of america */
+    Relation notAmerica = relationFromStrings ( countSchema, { { "80" } } );
+    executeStatementAndCheckRelation ( "NOT IN",
+        "select count(*) as c from supplier where s_nationkey not in "
+        "( select n_nationkey from nation where n_regionkey = 1 )", db, notAmerica );
+
+    /* subqueries without results keep all tuples */
+    Relation allRegions = relationFromStrings ( regionSchema, 
+        { { "AFRICA" }, { "AMERICA" }, { "ASIA" }, { "EUROPE" }, { "MIDDLE EAST" } } );
+    executeStatementAndCheckRelation ( "NOT IN EMPTY",
+        "select r_name from region where r_regionkey not in "
+        "( select n_regionkey from nation where n_nationkey < 0 )", db, allRegions );
+    executeStatementAndCheckRelation ( "NOT EXISTS EMPTY",
+        "select r_name from region where not exists "
+        "( select * from nation where n_regionkey = r_regionkey and n_nationkey < 0 )", db, allRegions );
+    Relation empty = Relation ( regionSchema );
+    executeStatementAndCheckRelation ( "EXISTS EMPTY",
+        "select r_name from region where exists "
+        "( select * from nation where n_regionkey = r_regionkey and n_nationkey < 0 )", db, empty );
+}
+
+
+/* Compiles a query with several pipelines as one function and as pipeline *
+ * functions that are compiled in the background and compares the results  */
+void pipelinedCompilationQuery ( Database& db ) {
+    std::string statement = 
+        "select c_mktsegment, count(*) as c, sum(o_totalprice) as s "
+        "from customer, orders where c_custkey = o_custkey "
+        "group by c_mktsegment order by c_mktsegment";
+
+    DBConfig single = testConfig;
+    single.jit.pipelinedCompilation = false;
+    QueryResult reference = executeStatement ( statement, db, single );
+
+    DBConfig pipelined = testConfig;
+    pipelined.jit.pipelinedCompilation = true;
+    pipelined.jit.tieredExecution = false;
+    pipelined.jit.requireSpareCore = false;
+    QueryResult res = executeStatement ( statement, db, pipelined );
+    if ( reference.error || res.error ) {
+        std::cout << "PIPELINED COMPILATION: " << reference.errorMessage << res.errorMessage << std::endl;
+        fail_test();
+    }
+    bool expectPipelines = startPipelined ( pipelined.jit ) && !pipelined.jit.forceInterpreter;
+    if ( ( res.selectResult()->jitReport.numPipelineFunctions > 1 ) != expectPipelines ) {
+        std::cout << "PIPELINED COMPILATION: query was " << ( expectPipelines ? "not " : "" ) 
+                  << "split into pipelines" << std::endl;
+        fail_test();
+    }
+    checkRelations ( "PIPELINED COMPILATION", *res.selectResult()->relation, 
+                     *reference.selectResult()->relation, true );
+}
+
+
+/* Decimal arguments of execute statements are bound at the scale of the *
+ * parameter when no decimal places are lost and rejected otherwise.     */
+void preparedDecimalQueries ( Database& db ) {
+    executeStatementAndExpectSuccess ( "prepare price as select count(*) as c from orders where o_totalprice < ?", db );
+    executeStatementAndExpectError ( "DECIMAL PARAMETER SCALE", "execute price ( 874.895 )", db );
+    QueryResult literal = executeStatement ( "select count(*) as c from orders where o_totalprice < 1000.50", 
+                                             db, testConfig );
+    executeStatementAndCheckRelation ( "DECIMAL PARAMETER TRAILING ZEROS", "execute price ( 1000.500 )", 
+                                       db, *literal.selectResult()->relation );
+}
+
+
 void testQueries() {
 
     Database db;
@@ -104,9 +568,20 @@ void testQueries() {
      q3 ( db );
      q5 ( db );
      q6 ( db );
+     q6Prepared ( db );
     q10 ( db );
     q12 ( db );
     q19 ( db );
+
+    joinOrderQuery ( db );
+    singleMatchQuery ( db );
+    keyConstraintQueries ();
+    orderByHiddenKeyQueries ();
+    statisticsQueries ();
+    compiledQueryCacheQueries ();
+    semiJoinQueries ( db );
+    pipelinedCompilationQuery ( db );
+    preparedDecimalQueries ( db );
 }
 
 
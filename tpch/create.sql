@@ -14,10 +14,11 @@ create table lineitem (
     l_receiptdate    date, 
     l_shipinstruct   char(25), 
     l_shipmode       char(10), 
-    l_comment        varchar(44)
+    l_comment        varchar(44),
+    primary key ( l_orderkey, l_linenumber )
 );
 create table orders ( 
-    o_orderkey       int,
+    o_orderkey       int primary key,
     o_custkey        int,
     o_orderstatus    char(1),
     o_totalprice     decimal(12,2),
@@ -28,7 +29,7 @@ create table orders (
     o_comment        varchar(79)
 );
 create table customer ( 
-    c_custkey        int,
+    c_custkey        int primary key,
     c_name           varchar(25),
     c_address        varchar(40),
     c_nationkey      int,
@@ -42,10 +43,11 @@ create table partsupp (
     ps_suppkey       int,
     ps_availqty      int,
     ps_supplycost    decimal(12,2),
-    ps_comment       varchar(199)
+    ps_comment       varchar(199),
+    primary key ( ps_partkey, ps_suppkey )
 );
 create table part ( 
-    p_partkey        int,
+    p_partkey        int primary key,
     p_name           char(55),
     p_mfgr           char(55),
     p_brand          char(10),
@@ -56,7 +58,7 @@ create table part (
     p_comment        varchar(23)
 );
 create table supplier ( 
-    s_suppkey        int,
+    s_suppkey        int primary key,
     s_name           char(25),
     s_address        varchar(40),
     s_nationkey      int,
@@ -65,13 +67,13 @@ create table supplier (
     s_comment        varchar(101)
 );
 create table nation (
-    n_nationkey      int,
+    n_nationkey      int primary key,
     n_name           char(25),
     n_regionkey      int,
     n_comment        varchar(152)
 );
 create table region (
-    r_regionkey      int,
+    r_regionkey      int primary key,
     r_name           char(25),
     r_comment        varchar(152)
 );